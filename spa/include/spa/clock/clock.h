@@ -109,6 +109,11 @@ struct spa_clock {
 	 * \param ticks result number of ticks. There are \a rate ticks per second.
 	 * \param monotonic_time the time of the monotonic clock when \a ticks was
 	 *        obtained.
+	 *
+	 * Clocks of devices can filter \a monotonic_time to remove the jitter
+	 * of their wakeups. The real rate of the clock against the monotonic
+	 * clock is then the difference in \a ticks between two snapshots divided
+	 * by the difference in \a monotonic_time.
 	 */
 	int (*get_time) (struct spa_clock *clock,
 			 int32_t *rate,
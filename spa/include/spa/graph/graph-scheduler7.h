@@ -0,0 +1,333 @@
+/* Simple Plugin API
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __SPA_GRAPH_SCHEDULER7_H__
+#define __SPA_GRAPH_SCHEDULER7_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <spa/graph/graph.h>
+
+/*
+ * Sorted graph scheduler
+ *
+ * The nodes of the graph are kept in topological order, linked with their
+ * ready_link. The order is rebuilt when the graph generation changes.
+ *
+ * need_input and have_output do the same port bookkeeping as the default
+ * scheduler but, instead of recursing into the peer node, they only mark the
+ * peer as pending. A cycle is then completed with flat sweeps over the order:
+ * forward for nodes that need process_input, backward for nodes that need
+ * process_output. Nodes that are linked to the graph but not added to it are
+ * kept in a separate queue.
+ */
+
+#define SPA_GRAPH_PENDING_IN	(1 << 0)	/**< node needs process_input */
+#define SPA_GRAPH_PENDING_OUT	(1 << 1)	/**< node needs process_output */
+
+struct spa_graph_sorted {
+	struct spa_graph *graph;
+	uint32_t generation;			/**< graph generation of order */
+	struct spa_list order;			/**< nodes in topological order */
+	struct spa_list external;		/**< pending nodes outside the graph */
+	uint32_t n_nodes;			/**< number of nodes in order */
+	struct spa_graph_node *first_in;	/**< first node with PENDING_IN */
+	struct spa_graph_node *last_out;	/**< last node with PENDING_OUT */
+	uint32_t n_pending;			/**< number of pending flags */
+	bool running;
+};
+
+static inline void spa_graph_sorted_init(struct spa_graph_sorted *data,
+					 struct spa_graph *graph)
+{
+	data->graph = graph;
+	data->generation = graph->generation - 1;
+	spa_list_init(&data->order);
+	spa_list_init(&data->external);
+	data->n_nodes = 0;
+	data->first_in = NULL;
+	data->last_out = NULL;
+	data->n_pending = 0;
+	data->running = false;
+}
+
+static inline void spa_graph_sorted_sort(struct spa_graph_sorted *data)
+{
+	struct spa_graph *graph = data->graph;
+	struct spa_graph_node *n, *t;
+	struct spa_graph_port *p, *pp;
+	struct spa_list *l;
+	uint32_t order = 0;
+
+	spa_list_init(&data->order);
+
+	/* count the incoming links of each node */
+	spa_list_for_each(n, &graph->nodes, link) {
+		n->pending = 0;
+		n->order = SPA_ID_INVALID;
+	}
+	spa_list_for_each(n, &graph->nodes, link) {
+		spa_list_for_each(p, &n->ports[SPA_DIRECTION_OUTPUT], link) {
+			if ((pp = p->peer) == NULL || (t = pp->node) == NULL || t->graph != graph)
+				continue;
+			t->pending++;
+		}
+	}
+	/* start with the nodes without input links and append the peers once
+	 * all their input links are resolved */
+	spa_list_for_each(n, &graph->nodes, link) {
+		if (n->pending == 0) {
+			n->order = order++;
+			spa_list_append(&data->order, &n->ready_link);
+		}
+	}
+	for (l = data->order.next; l != &data->order; l = l->next) {
+		n = SPA_CONTAINER_OF(l, struct spa_graph_node, ready_link);
+
+		spa_list_for_each(p, &n->ports[SPA_DIRECTION_OUTPUT], link) {
+			if ((pp = p->peer) == NULL || (t = pp->node) == NULL || t->graph != graph)
+				continue;
+			if (t->order == SPA_ID_INVALID && --t->pending == 0) {
+				t->order = order++;
+				spa_list_append(&data->order, &t->ready_link);
+			}
+		}
+	}
+	/* nodes in a cycle go last, in graph order */
+	spa_list_for_each(n, &graph->nodes, link) {
+		if (n->order == SPA_ID_INVALID) {
+			spa_debug("node %p is in a cycle", n);
+			n->order = order++;
+			spa_list_append(&data->order, &n->ready_link);
+		}
+		n->pending = 0;
+		n->n_deps[SPA_DIRECTION_INPUT] = n->n_deps[SPA_DIRECTION_OUTPUT] = 0;
+	}
+	/* count the links that follow the order, links that go back are only
+	 * part of a cycle */
+	spa_list_for_each(n, &graph->nodes, link) {
+		spa_list_for_each(p, &n->ports[SPA_DIRECTION_OUTPUT], link) {
+			if ((pp = p->peer) == NULL || (t = pp->node) == NULL || t->graph != graph)
+				continue;
+			if (t->order > n->order) {
+				n->n_deps[SPA_DIRECTION_OUTPUT]++;
+				t->n_deps[SPA_DIRECTION_INPUT]++;
+			}
+		}
+	}
+	data->n_nodes = order;
+	data->generation = graph->generation;
+
+	spa_debug("graph %p sorted %d nodes, generation %d", graph, order, data->generation);
+}
+
+static inline void spa_graph_sorted_mark(struct spa_graph_sorted *data,
+					 struct spa_graph_node *node, uint32_t flag)
+{
+	if (node->pending & flag)
+		return;
+
+	if (node->graph != data->graph) {
+		if (node->pending == 0)
+			spa_list_append(&data->external, &node->ready_link);
+	}
+	else if (flag == SPA_GRAPH_PENDING_IN) {
+		if (data->first_in == NULL || node->order < data->first_in->order)
+			data->first_in = node;
+	}
+	else {
+		if (data->last_out == NULL || node->order > data->last_out->order)
+			data->last_out = node;
+	}
+	node->pending |= flag;
+	data->n_pending++;
+}
+
+static inline void spa_graph_sorted_pull(struct spa_graph_sorted *data,
+					 struct spa_graph_node *node)
+{
+	struct spa_graph_port *p;
+
+	spa_debug("node %p pull", node);
+
+	node->required[SPA_DIRECTION_INPUT] = 0;
+	spa_list_for_each(p, &node->ports[SPA_DIRECTION_INPUT], link) {
+		if (p->io->status == SPA_STATUS_NEED_BUFFER)
+			node->required[SPA_DIRECTION_INPUT]++;
+	}
+	node->ready[SPA_DIRECTION_INPUT] = 0;
+	spa_list_for_each(p, &node->ports[SPA_DIRECTION_INPUT], link) {
+		struct spa_graph_port *pport;
+		struct spa_graph_node *pnode;
+		uint32_t prequired, pready;
+
+		if ((pport = p->peer) == NULL || (pport->flags & SPA_GRAPH_PORT_FLAG_DISABLED))
+			continue;
+
+		pnode = pport->node;
+
+		if (pport->io->status == SPA_STATUS_NEED_BUFFER)
+			pnode->ready[SPA_DIRECTION_OUTPUT]++;
+
+		pready = pnode->ready[SPA_DIRECTION_OUTPUT];
+		prequired = pnode->required[SPA_DIRECTION_OUTPUT];
+
+		if (prequired > 0 && pready >= prequired)
+			spa_graph_sorted_mark(data, pnode, SPA_GRAPH_PENDING_OUT);
+	}
+}
+
+static inline void spa_graph_sorted_push(struct spa_graph_sorted *data,
+					 struct spa_graph_node *node)
+{
+	struct spa_graph_port *p;
+
+	spa_debug("node %p push", node);
+
+	node->required[SPA_DIRECTION_OUTPUT] = 0;
+	spa_list_for_each(p, &node->ports[SPA_DIRECTION_OUTPUT], link) {
+		if (p->io->status == SPA_STATUS_HAVE_BUFFER) {
+			if (!(p->flags & SPA_PORT_INFO_FLAG_OPTIONAL))
+				node->required[SPA_DIRECTION_OUTPUT]++;
+		}
+	}
+	node->ready[SPA_DIRECTION_OUTPUT] = 0;
+	spa_list_for_each(p, &node->ports[SPA_DIRECTION_OUTPUT], link) {
+		struct spa_graph_port *pport;
+		struct spa_graph_node *pnode;
+		uint32_t prequired, pready;
+
+		if ((pport = p->peer) == NULL || (pport->flags & SPA_GRAPH_PORT_FLAG_DISABLED))
+			continue;
+
+		pnode = pport->node;
+
+		if (pport->io->status == SPA_STATUS_HAVE_BUFFER)
+			pnode->ready[SPA_DIRECTION_INPUT]++;
+
+		pready = pnode->ready[SPA_DIRECTION_INPUT];
+		prequired = pnode->required[SPA_DIRECTION_INPUT];
+
+		if (prequired > 0 && pready >= prequired)
+			spa_graph_sorted_mark(data, pnode, SPA_GRAPH_PENDING_IN);
+	}
+}
+
+static inline void spa_graph_sorted_process(struct spa_graph_sorted *data,
+					    struct spa_graph_node *node, uint32_t flag)
+{
+	node->pending &= ~flag;
+	data->n_pending--;
+
+	if (flag == SPA_GRAPH_PENDING_IN)
+		node->state = spa_node_process_input(node->implementation);
+	else
+		node->state = spa_node_process_output(node->implementation);
+
+	spa_debug("node %p processed %d %d", node, flag, node->state);
+
+	if (node->state == SPA_STATUS_HAVE_BUFFER)
+		spa_graph_sorted_push(data, node);
+	else if (node->state == SPA_STATUS_NEED_BUFFER)
+		spa_graph_sorted_pull(data, node);
+}
+
+static inline void spa_graph_sorted_run(struct spa_graph_sorted *data)
+{
+	struct spa_graph_node *n;
+	struct spa_list *l;
+
+	data->running = true;
+
+	while (data->n_pending > 0) {
+		/* push data downstream */
+		if ((n = data->first_in) != NULL) {
+			data->first_in = NULL;
+			for (l = &n->ready_link; l != &data->order; l = l->next) {
+				n = SPA_CONTAINER_OF(l, struct spa_graph_node, ready_link);
+				if (n->pending & SPA_GRAPH_PENDING_IN)
+					spa_graph_sorted_process(data, n, SPA_GRAPH_PENDING_IN);
+			}
+		}
+		/* pull data from upstream */
+		if ((n = data->last_out) != NULL) {
+			data->last_out = NULL;
+			for (l = &n->ready_link; l != &data->order; l = l->prev) {
+				n = SPA_CONTAINER_OF(l, struct spa_graph_node, ready_link);
+				if (n->pending & SPA_GRAPH_PENDING_OUT)
+					spa_graph_sorted_process(data, n, SPA_GRAPH_PENDING_OUT);
+			}
+		}
+		while (!spa_list_is_empty(&data->external)) {
+			n = spa_list_first(&data->external, struct spa_graph_node, ready_link);
+			spa_list_remove(&n->ready_link);
+			n->ready_link.next = NULL;
+
+			if (n->pending & SPA_GRAPH_PENDING_IN)
+				spa_graph_sorted_process(data, n, SPA_GRAPH_PENDING_IN);
+			if (n->pending & SPA_GRAPH_PENDING_OUT)
+				spa_graph_sorted_process(data, n, SPA_GRAPH_PENDING_OUT);
+		}
+	}
+	data->running = false;
+}
+
+static inline int spa_graph_impl_sorted_need_input(void *data, struct spa_graph_node *node)
+{
+	struct spa_graph_sorted *d = data;
+
+	if (!d->running && d->generation != d->graph->generation)
+		spa_graph_sorted_sort(d);
+
+	spa_graph_sorted_pull(d, node);
+
+	if (!d->running)
+		spa_graph_sorted_run(d);
+
+	return 0;
+}
+
+static inline int spa_graph_impl_sorted_have_output(void *data, struct spa_graph_node *node)
+{
+	struct spa_graph_sorted *d = data;
+
+	if (!d->running && d->generation != d->graph->generation)
+		spa_graph_sorted_sort(d);
+
+	spa_graph_sorted_push(d, node);
+
+	if (!d->running)
+		spa_graph_sorted_run(d);
+
+	return 0;
+}
+
+static const struct spa_graph_callbacks spa_graph_impl_sorted = {
+	SPA_VERSION_GRAPH_CALLBACKS,
+	.need_input = spa_graph_impl_sorted_need_input,
+	.have_output = spa_graph_impl_sorted_have_output,
+};
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* __SPA_GRAPH_SCHEDULER7_H__ */
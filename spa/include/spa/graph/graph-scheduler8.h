@@ -0,0 +1,504 @@
+/* Simple Plugin API
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __SPA_GRAPH_SCHEDULER8_H__
+#define __SPA_GRAPH_SCHEDULER8_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <sched.h>
+
+#include <spa/graph/graph.h>
+#include <spa/graph/graph-scheduler7.h>
+
+/*
+ * Parallel graph scheduler
+ *
+ * Uses the order of the sorted scheduler. Each sweep gives every node a
+ * dependency counter with the number of links from nodes that come earlier
+ * in the sweep. Nodes without dependencies are queued, a worker that
+ * finishes a node decrements the counters of the peers and queues the ones
+ * that reach 0. Nodes that are not pending are only passed through, so
+ * independent branches of the graph run on different workers.
+ *
+ * Each worker has a work-stealing queue, the owner pushes and pops at the
+ * bottom, idle workers steal from the top of the other queues.
+ *
+ * Worker 0 is the thread that started the cycle. It wakes up the other
+ * workers, helps processing nodes and waits until all nodes are done before
+ * it returns, the trigger node of the cycle is always joined.
+ */
+
+#define SPA_GRAPH_QUEUE_SIZE	1024		/**< max nodes in a parallel graph */
+#define SPA_GRAPH_SPIN_COUNT	128		/**< spins of an idle worker before it yields */
+
+/** Tell the CPU that we are spinning */
+static inline void spa_graph_cpu_relax(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+	__asm__ __volatile__("yield");
+#else
+	__asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+struct spa_graph_queue {
+	int64_t top;
+	int64_t bottom;
+	struct spa_graph_node *items[SPA_GRAPH_QUEUE_SIZE];
+};
+
+static inline void spa_graph_queue_init(struct spa_graph_queue *queue)
+{
+	queue->top = queue->bottom = 0;
+}
+
+/** push a node on the bottom of the queue, only called by the owner */
+static inline void spa_graph_queue_push(struct spa_graph_queue *queue,
+					struct spa_graph_node *node)
+{
+	int64_t b = __atomic_load_n(&queue->bottom, __ATOMIC_RELAXED);
+
+	__atomic_store_n(&queue->items[b & (SPA_GRAPH_QUEUE_SIZE - 1)], node, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	__atomic_store_n(&queue->bottom, b + 1, __ATOMIC_RELAXED);
+}
+
+/** pop a node from the bottom of the queue, only called by the owner */
+static inline struct spa_graph_node *spa_graph_queue_pop(struct spa_graph_queue *queue)
+{
+	struct spa_graph_node *node;
+	int64_t b, t;
+
+	b = __atomic_load_n(&queue->bottom, __ATOMIC_RELAXED) - 1;
+	__atomic_store_n(&queue->bottom, b, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	t = __atomic_load_n(&queue->top, __ATOMIC_RELAXED);
+
+	if (t > b) {
+		__atomic_store_n(&queue->bottom, b + 1, __ATOMIC_RELAXED);
+		return NULL;
+	}
+	node = __atomic_load_n(&queue->items[b & (SPA_GRAPH_QUEUE_SIZE - 1)], __ATOMIC_RELAXED);
+	if (t == b) {
+		/* last item, race against thieves */
+		if (!__atomic_compare_exchange_n(&queue->top, &t, t + 1, false,
+						 __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+			node = NULL;
+		__atomic_store_n(&queue->bottom, b + 1, __ATOMIC_RELAXED);
+	}
+	return node;
+}
+
+/** steal a node from the top of the queue, called by other workers */
+static inline struct spa_graph_node *spa_graph_queue_steal(struct spa_graph_queue *queue)
+{
+	struct spa_graph_node *node;
+	int64_t b, t;
+
+	t = __atomic_load_n(&queue->top, __ATOMIC_ACQUIRE);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	b = __atomic_load_n(&queue->bottom, __ATOMIC_ACQUIRE);
+
+	if (t >= b)
+		return NULL;
+
+	node = __atomic_load_n(&queue->items[t & (SPA_GRAPH_QUEUE_SIZE - 1)], __ATOMIC_RELAXED);
+	if (!__atomic_compare_exchange_n(&queue->top, &t, t + 1, false,
+					 __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+		return NULL;
+
+	return node;
+}
+
+struct spa_graph_parallel;
+
+struct spa_graph_worker {
+	struct spa_graph_parallel *parallel;
+	uint32_t id;
+	struct spa_graph_queue queue;
+};
+
+struct spa_graph_parallel_callbacks {
+#define SPA_VERSION_GRAPH_PARALLEL_CALLBACKS	0
+	uint32_t version;
+
+	/** wake up the workers, they should call spa_graph_parallel_work() */
+	void (*wakeup) (void *data);
+};
+
+struct spa_graph_parallel {
+	struct spa_graph_sorted sorted;
+	struct spa_graph_worker *workers;	/**< the workers, 0 is the caller */
+	uint32_t n_workers;
+	const struct spa_graph_parallel_callbacks *callbacks;
+	void *callbacks_data;
+
+	uint32_t flag;				/**< pending flag of the current sweep */
+	int32_t remaining;			/**< nodes left in the current sweep */
+	bool woken;				/**< workers woken for current sweep */
+	int lock;				/**< protects the external queue */
+};
+
+static inline void spa_graph_parallel_init(struct spa_graph_parallel *data,
+					   struct spa_graph *graph,
+					   struct spa_graph_worker *workers,
+					   uint32_t n_workers,
+					   const struct spa_graph_parallel_callbacks *callbacks,
+					   void *callbacks_data)
+{
+	uint32_t i;
+
+	spa_graph_sorted_init(&data->sorted, graph);
+	data->workers = workers;
+	data->n_workers = n_workers;
+	data->callbacks = callbacks;
+	data->callbacks_data = callbacks_data;
+	data->flag = 0;
+	data->remaining = 0;
+	data->woken = false;
+	data->lock = 0;
+
+	for (i = 0; i < n_workers; i++) {
+		workers[i].parallel = data;
+		workers[i].id = i;
+		spa_graph_queue_init(&workers[i].queue);
+	}
+}
+
+static inline void spa_graph_parallel_mark(struct spa_graph_parallel *data,
+					   struct spa_graph_node *node, uint32_t flag)
+{
+	struct spa_graph_sorted *s = &data->sorted;
+	struct spa_graph_node *cur;
+	uint32_t old;
+
+	old = __atomic_fetch_or(&node->pending, flag, __ATOMIC_ACQ_REL);
+	if (old & flag)
+		return;
+
+	if (node->graph != s->graph) {
+		if (old == 0) {
+			while (__atomic_test_and_set(&data->lock, __ATOMIC_ACQUIRE))
+				sched_yield();
+			spa_list_append(&s->external, &node->ready_link);
+			__atomic_clear(&data->lock, __ATOMIC_RELEASE);
+		}
+	}
+	else if (flag == data->flag && __atomic_load_n(&node->deps, __ATOMIC_ACQUIRE) > 0) {
+		/* will be processed later in the current sweep */
+	}
+	else if (flag == SPA_GRAPH_PENDING_IN) {
+		cur = __atomic_load_n(&s->first_in, __ATOMIC_ACQUIRE);
+		while (cur == NULL || node->order < cur->order) {
+			if (__atomic_compare_exchange_n(&s->first_in, &cur, node, false,
+							__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+				break;
+		}
+	}
+	else {
+		cur = __atomic_load_n(&s->last_out, __ATOMIC_ACQUIRE);
+		while (cur == NULL || node->order > cur->order) {
+			if (__atomic_compare_exchange_n(&s->last_out, &cur, node, false,
+							__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+				break;
+		}
+	}
+	__atomic_add_fetch(&s->n_pending, 1, __ATOMIC_ACQ_REL);
+}
+
+static inline void spa_graph_parallel_pull(struct spa_graph_parallel *data,
+					   struct spa_graph_node *node)
+{
+	struct spa_graph_port *p;
+
+	spa_debug("node %p pull", node);
+
+	node->required[SPA_DIRECTION_INPUT] = 0;
+	spa_list_for_each(p, &node->ports[SPA_DIRECTION_INPUT], link) {
+		if (p->io->status == SPA_STATUS_NEED_BUFFER)
+			node->required[SPA_DIRECTION_INPUT]++;
+	}
+	__atomic_store_n(&node->ready[SPA_DIRECTION_INPUT], 0, __ATOMIC_RELEASE);
+	spa_list_for_each(p, &node->ports[SPA_DIRECTION_INPUT], link) {
+		struct spa_graph_port *pport;
+		struct spa_graph_node *pnode;
+		uint32_t prequired, pready;
+
+		if ((pport = p->peer) == NULL || (pport->flags & SPA_GRAPH_PORT_FLAG_DISABLED))
+			continue;
+
+		pnode = pport->node;
+
+		if (pport->io->status == SPA_STATUS_NEED_BUFFER)
+			pready = __atomic_add_fetch(&pnode->ready[SPA_DIRECTION_OUTPUT], 1,
+						    __ATOMIC_ACQ_REL);
+		else
+			pready = __atomic_load_n(&pnode->ready[SPA_DIRECTION_OUTPUT],
+						 __ATOMIC_ACQUIRE);
+
+		prequired = pnode->required[SPA_DIRECTION_OUTPUT];
+
+		if (prequired > 0 && pready >= prequired)
+			spa_graph_parallel_mark(data, pnode, SPA_GRAPH_PENDING_OUT);
+	}
+}
+
+static inline void spa_graph_parallel_push(struct spa_graph_parallel *data,
+					   struct spa_graph_node *node)
+{
+	struct spa_graph_port *p;
+
+	spa_debug("node %p push", node);
+
+	node->required[SPA_DIRECTION_OUTPUT] = 0;
+	spa_list_for_each(p, &node->ports[SPA_DIRECTION_OUTPUT], link) {
+		if (p->io->status == SPA_STATUS_HAVE_BUFFER) {
+			if (!(p->flags & SPA_PORT_INFO_FLAG_OPTIONAL))
+				node->required[SPA_DIRECTION_OUTPUT]++;
+		}
+	}
+	__atomic_store_n(&node->ready[SPA_DIRECTION_OUTPUT], 0, __ATOMIC_RELEASE);
+	spa_list_for_each(p, &node->ports[SPA_DIRECTION_OUTPUT], link) {
+		struct spa_graph_port *pport;
+		struct spa_graph_node *pnode;
+		uint32_t prequired, pready;
+
+		if ((pport = p->peer) == NULL || (pport->flags & SPA_GRAPH_PORT_FLAG_DISABLED))
+			continue;
+
+		pnode = pport->node;
+
+		if (pport->io->status == SPA_STATUS_HAVE_BUFFER)
+			pready = __atomic_add_fetch(&pnode->ready[SPA_DIRECTION_INPUT], 1,
+						    __ATOMIC_ACQ_REL);
+		else
+			pready = __atomic_load_n(&pnode->ready[SPA_DIRECTION_INPUT],
+						 __ATOMIC_ACQUIRE);
+
+		prequired = pnode->required[SPA_DIRECTION_INPUT];
+
+		if (prequired > 0 && pready >= prequired)
+			spa_graph_parallel_mark(data, pnode, SPA_GRAPH_PENDING_IN);
+	}
+}
+
+static inline void spa_graph_parallel_process(struct spa_graph_parallel *data,
+					      struct spa_graph_node *node, uint32_t flag)
+{
+	__atomic_fetch_and(&node->pending, ~flag, __ATOMIC_ACQ_REL);
+	__atomic_sub_fetch(&data->sorted.n_pending, 1, __ATOMIC_ACQ_REL);
+
+	if (flag == SPA_GRAPH_PENDING_IN)
+		node->state = spa_node_process_input(node->implementation);
+	else
+		node->state = spa_node_process_output(node->implementation);
+
+	spa_debug("node %p processed %d %d", node, flag, node->state);
+
+	if (node->state == SPA_STATUS_HAVE_BUFFER)
+		spa_graph_parallel_push(data, node);
+	else if (node->state == SPA_STATUS_NEED_BUFFER)
+		spa_graph_parallel_pull(data, node);
+}
+
+/* wake up the other workers once there is more than one node to process */
+static inline void spa_graph_parallel_wakeup(struct spa_graph_parallel *data)
+{
+	if (data->n_workers < 2 ||
+	    __atomic_load_n(&data->woken, __ATOMIC_ACQUIRE) ||
+	    __atomic_load_n(&data->sorted.n_pending, __ATOMIC_ACQUIRE) < 2)
+		return;
+
+	if (!__atomic_exchange_n(&data->woken, true, __ATOMIC_ACQ_REL))
+		data->callbacks->wakeup(data->callbacks_data);
+}
+
+/* run a node of the current sweep and queue the peers that have no more
+ * dependencies */
+static inline void spa_graph_parallel_execute(struct spa_graph_parallel *data,
+					      struct spa_graph_worker *worker,
+					      struct spa_graph_node *node)
+{
+	struct spa_graph *graph = data->sorted.graph;
+	uint32_t flag = data->flag;
+	enum spa_direction dir;
+	struct spa_graph_port *p, *pp;
+	struct spa_graph_node *t;
+
+	if (__atomic_load_n(&node->pending, __ATOMIC_ACQUIRE) & flag) {
+		spa_graph_parallel_process(data, node, flag);
+		spa_graph_parallel_wakeup(data);
+	}
+
+	dir = flag == SPA_GRAPH_PENDING_IN ? SPA_DIRECTION_OUTPUT : SPA_DIRECTION_INPUT;
+
+	spa_list_for_each(p, &node->ports[dir], link) {
+		if ((pp = p->peer) == NULL || (t = pp->node) == NULL || t->graph != graph)
+			continue;
+		if (dir == SPA_DIRECTION_OUTPUT ? t->order <= node->order : t->order >= node->order)
+			continue;
+		if (__atomic_sub_fetch(&t->deps, 1, __ATOMIC_ACQ_REL) == 0)
+			spa_graph_queue_push(&worker->queue, t);
+	}
+	__atomic_sub_fetch(&data->remaining, 1, __ATOMIC_RELEASE);
+}
+
+/** Help processing the current sweep
+ *
+ * \param data the scheduler
+ * \param id the id of the worker
+ *
+ * Called by a worker after it was woken up. Returns when all nodes of the
+ * sweep are done.
+ */
+static inline void spa_graph_parallel_work(struct spa_graph_parallel *data, uint32_t id)
+{
+	struct spa_graph_worker *worker = &data->workers[id];
+	struct spa_graph_node *node;
+	uint32_t i, spins = 0;
+
+	while (__atomic_load_n(&data->remaining, __ATOMIC_ACQUIRE) > 0) {
+		node = spa_graph_queue_pop(&worker->queue);
+		for (i = 1; node == NULL && i < data->n_workers; i++)
+			node = spa_graph_queue_steal(&data->workers[(id + i) % data->n_workers].queue);
+
+		if (node) {
+			spa_graph_parallel_execute(data, worker, node);
+			spins = 0;
+		}
+		else if (++spins < SPA_GRAPH_SPIN_COUNT) {
+			spa_graph_cpu_relax();
+		}
+		else {
+			/* the other nodes are still running, let them have the CPU */
+			sched_yield();
+			spins = 0;
+		}
+	}
+}
+
+static inline void spa_graph_parallel_sweep(struct spa_graph_parallel *data, uint32_t flag)
+{
+	struct spa_graph_sorted *s = &data->sorted;
+	struct spa_graph_worker *worker = &data->workers[0];
+	enum spa_direction dir;
+	struct spa_graph_node *n;
+
+	dir = flag == SPA_GRAPH_PENDING_IN ? SPA_DIRECTION_INPUT : SPA_DIRECTION_OUTPUT;
+
+	data->flag = flag;
+	spa_list_for_each(n, &s->order, ready_link) {
+		n->deps = n->n_deps[dir];
+		if (n->deps == 0)
+			spa_graph_queue_push(&worker->queue, n);
+	}
+	__atomic_store_n(&data->woken, false, __ATOMIC_RELEASE);
+	__atomic_store_n(&data->remaining, s->n_nodes, __ATOMIC_RELEASE);
+
+	spa_graph_parallel_wakeup(data);
+	spa_graph_parallel_work(data, 0);
+
+	data->flag = 0;
+}
+
+static inline void spa_graph_parallel_run(struct spa_graph_parallel *data)
+{
+	struct spa_graph_sorted *s = &data->sorted;
+	struct spa_graph_node *n;
+
+	s->running = true;
+
+	while (__atomic_load_n(&s->n_pending, __ATOMIC_ACQUIRE) > 0) {
+		if (__atomic_exchange_n(&s->first_in, NULL, __ATOMIC_ACQ_REL) != NULL)
+			spa_graph_parallel_sweep(data, SPA_GRAPH_PENDING_IN);
+
+		if (__atomic_exchange_n(&s->last_out, NULL, __ATOMIC_ACQ_REL) != NULL)
+			spa_graph_parallel_sweep(data, SPA_GRAPH_PENDING_OUT);
+
+		while (!spa_list_is_empty(&s->external)) {
+			n = spa_list_first(&s->external, struct spa_graph_node, ready_link);
+			spa_list_remove(&n->ready_link);
+			n->ready_link.next = NULL;
+
+			if (n->pending & SPA_GRAPH_PENDING_IN)
+				spa_graph_parallel_process(data, n, SPA_GRAPH_PENDING_IN);
+			if (n->pending & SPA_GRAPH_PENDING_OUT)
+				spa_graph_parallel_process(data, n, SPA_GRAPH_PENDING_OUT);
+		}
+	}
+	s->running = false;
+}
+
+static inline int spa_graph_impl_parallel_need_input(void *data, struct spa_graph_node *node)
+{
+	struct spa_graph_parallel *d = data;
+	struct spa_graph_sorted *s = &d->sorted;
+
+	if (!s->running && s->generation != s->graph->generation) {
+		spa_graph_sorted_sort(s);
+		if (s->n_nodes > SPA_GRAPH_QUEUE_SIZE)
+			spa_debug("graph %p too many nodes for parallel scheduling", s->graph);
+	}
+
+	if (s->n_nodes > SPA_GRAPH_QUEUE_SIZE)
+		return spa_graph_impl_sorted_need_input(s, node);
+
+	spa_graph_parallel_pull(d, node);
+
+	if (!s->running)
+		spa_graph_parallel_run(d);
+
+	return 0;
+}
+
+static inline int spa_graph_impl_parallel_have_output(void *data, struct spa_graph_node *node)
+{
+	struct spa_graph_parallel *d = data;
+	struct spa_graph_sorted *s = &d->sorted;
+
+	if (!s->running && s->generation != s->graph->generation)
+		spa_graph_sorted_sort(s);
+
+	if (s->n_nodes > SPA_GRAPH_QUEUE_SIZE)
+		return spa_graph_impl_sorted_have_output(s, node);
+
+	spa_graph_parallel_push(d, node);
+
+	if (!s->running)
+		spa_graph_parallel_run(d);
+
+	return 0;
+}
+
+static const struct spa_graph_callbacks spa_graph_impl_parallel = {
+	SPA_VERSION_GRAPH_CALLBACKS,
+	.need_input = spa_graph_impl_parallel_need_input,
+	.have_output = spa_graph_impl_parallel_have_output,
+};
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* __SPA_GRAPH_SCHEDULER8_H__ */
@@ -49,6 +49,7 @@ struct spa_graph {
 	struct spa_list nodes;
 	const struct spa_graph_callbacks *callbacks;
 	void *callbacks_data;
+	uint32_t generation;		/**< incremented when nodes or ports change */
 };
 
 #define spa_graph_need_input(g,n)	((g)->callbacks->need_input((g)->callbacks_data, (n)))
@@ -65,6 +66,11 @@ struct spa_graph_node {
 	uint32_t required[2];		/**< required number of ports */
 	uint32_t ready[2];		/**< number of ports with data */
 	int state;			/**< state of the node */
+	uint32_t order;			/**< position in the scheduler order */
+	uint32_t pending;		/**< scheduler pending flags */
+	uint32_t n_deps[2];		/**< number of links from earlier and to
+					  *  later nodes in the scheduler order */
+	uint32_t deps;			/**< scheduler dependency counter */
 	struct spa_node *implementation;/**< node implementation */
 	void *scheduler_data;		/**< scheduler private data */
 };
@@ -84,6 +90,13 @@ struct spa_graph_port {
 static inline void spa_graph_init(struct spa_graph *graph)
 {
 	spa_list_init(&graph->nodes);
+	graph->generation = 0;
+}
+
+static inline void spa_graph_node_changed(struct spa_graph_node *node)
+{
+	if (node->graph)
+		node->graph->generation++;
 }
 
 static inline void
@@ -100,7 +113,12 @@ spa_graph_node_init(struct spa_graph_node *node)
 {
 	spa_list_init(&node->ports[SPA_DIRECTION_INPUT]);
 	spa_list_init(&node->ports[SPA_DIRECTION_OUTPUT]);
+	node->graph = NULL;
 	node->flags = 0;
+	node->order = 0;
+	node->pending = 0;
+	node->n_deps[SPA_DIRECTION_INPUT] = node->n_deps[SPA_DIRECTION_OUTPUT] = 0;
+	node->deps = 0;
 	node->required[SPA_DIRECTION_INPUT] = node->ready[SPA_DIRECTION_INPUT] = 0;
 	node->required[SPA_DIRECTION_OUTPUT] = node->ready[SPA_DIRECTION_OUTPUT] = 0;
 	spa_debug("node %p init", node);
@@ -121,6 +139,7 @@ spa_graph_node_add(struct spa_graph *graph,
 	node->state = SPA_STATUS_OK;
 	node->ready_link.next = NULL;
 	spa_list_append(&graph->nodes, &node->link);
+	graph->generation++;
 	spa_debug("node %p add", node);
 }
 
@@ -147,6 +166,7 @@ spa_graph_port_add(struct spa_graph_node *node,
 	spa_list_append(&node->ports[port->direction], &port->link);
 	if (!(port->flags & SPA_PORT_INFO_FLAG_OPTIONAL))
 		node->required[port->direction]++;
+	spa_graph_node_changed(node);
 }
 
 static inline void spa_graph_node_remove(struct spa_graph_node *node)
@@ -155,6 +175,8 @@ static inline void spa_graph_node_remove(struct spa_graph_node *node)
 	spa_list_remove(&node->link);
 	if (node->ready_link.next)
 		spa_list_remove(&node->ready_link);
+	node->ready_link.next = NULL;
+	spa_graph_node_changed(node);
 }
 
 static inline void spa_graph_port_remove(struct spa_graph_port *port)
@@ -165,6 +187,7 @@ static inline void spa_graph_port_remove(struct spa_graph_port *port)
 	    port->node->required[port->direction] > 0) {
 		port->node->required[port->direction]--;
 	}
+	spa_graph_node_changed(port->node);
 }
 
 static inline void
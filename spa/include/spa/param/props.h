@@ -41,6 +41,7 @@ extern "C" {
 
 #define SPA_TYPE_PROPS__minLatency	SPA_TYPE_PROPS_BASE "minLatency"
 #define SPA_TYPE_PROPS__maxLatency	SPA_TYPE_PROPS_BASE "maxLatency"
+#define SPA_TYPE_PROPS__quantum		SPA_TYPE_PROPS_BASE "quantum"
 #define SPA_TYPE_PROPS__periods		SPA_TYPE_PROPS_BASE "periods"
 #define SPA_TYPE_PROPS__periodSize	SPA_TYPE_PROPS_BASE "periodSize"
 #define SPA_TYPE_PROPS__periodEvent	SPA_TYPE_PROPS_BASE "periodEvent"
@@ -50,7 +51,10 @@ extern "C" {
 #define SPA_TYPE_PROPS__frequency	SPA_TYPE_PROPS_BASE "frequency"
 #define SPA_TYPE_PROPS__volume		SPA_TYPE_PROPS_BASE "volume"
 #define SPA_TYPE_PROPS__mute		SPA_TYPE_PROPS_BASE "mute"
+#define SPA_TYPE_PROPS__channelVolumes	SPA_TYPE_PROPS_BASE "channelVolumes"
 #define SPA_TYPE_PROPS__patternType	SPA_TYPE_PROPS_BASE "patternType"
+#define SPA_TYPE_PROPS__quality		SPA_TYPE_PROPS_BASE "quality"
+#define SPA_TYPE_PROPS__rate		SPA_TYPE_PROPS_BASE "rate"
 
 #define SPA_TYPE_PROPS__brightness	SPA_TYPE_PROPS_BASE "brightness"
 #define SPA_TYPE_PROPS__contrast	SPA_TYPE_PROPS_BASE "contrast"
@@ -0,0 +1,220 @@
+/* Spa
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __SPA_POD_TEMPLATE_H__
+#define __SPA_POD_TEMPLATE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <spa/pod/builder.h>
+#include <spa/pod/iter.h>
+
+/** A POD template describes the properties of an object once. The
+ * properties can then be written from and parsed into a structure
+ * without interpreting a format string.
+ *
+ * Only properties with a fixed size value and without range are
+ * supported: bool, id, int, long, float, double, rectangle and
+ * fraction. Bool values are stored as a bool in the structure.
+ */
+
+#define SPA_POD_TEMPLATE_MAX_FIELDS	16
+
+/** A property in a template */
+struct spa_pod_template_field {
+	uint32_t key;		/**< the property key */
+	uint32_t type;		/**< the SPA_POD_TYPE_ of the value */
+	uint32_t offset;	/**< offset of the value in the structure */
+};
+
+#define SPA_POD_TEMPLATE_FIELD(key,type,struct_type,member)	\
+	(struct spa_pod_template_field){ key, type, offsetof(struct_type, member) }
+
+struct spa_pod_template {
+	uint32_t n_fields;
+	struct {
+		struct spa_pod_template_field field;
+		uint32_t size;		/**< size of the value */
+		uint32_t pod_offset;	/**< offset of the value in data */
+	} fields[SPA_POD_TEMPLATE_MAX_FIELDS];
+	uint32_t size;			/**< size of the props in data */
+	/* a property header of 24 bytes and a value of at most 8 bytes */
+	uint64_t data[SPA_POD_TEMPLATE_MAX_FIELDS * 4];
+};
+
+static inline uint32_t spa_pod_template_value_size(uint32_t type)
+{
+	switch (type) {
+	case SPA_POD_TYPE_BOOL:
+	case SPA_POD_TYPE_ID:
+	case SPA_POD_TYPE_INT:
+	case SPA_POD_TYPE_FLOAT:
+		return 4;
+	case SPA_POD_TYPE_LONG:
+	case SPA_POD_TYPE_DOUBLE:
+		return 8;
+	case SPA_POD_TYPE_RECTANGLE:
+		return sizeof(struct spa_rectangle);
+	case SPA_POD_TYPE_FRACTION:
+		return sizeof(struct spa_fraction);
+	default:
+		return 0;
+	}
+}
+
+/** Make the template for \a n_fields properties
+ * \return 0 on success or -EINVAL when a field is not supported */
+static inline int
+spa_pod_template_init(struct spa_pod_template *tmpl,
+		      const struct spa_pod_template_field *fields, uint32_t n_fields)
+{
+	uint32_t i, size;
+	uint8_t *data = (uint8_t *) tmpl->data;
+
+	if (n_fields > SPA_POD_TEMPLATE_MAX_FIELDS)
+		return -EINVAL;
+
+	memset(tmpl, 0, sizeof(*tmpl));
+
+	for (i = 0; i < n_fields; i++) {
+		struct spa_pod_prop *prop = (struct spa_pod_prop *) &data[tmpl->size];
+
+		if ((size = spa_pod_template_value_size(fields[i].type)) == 0)
+			return -EINVAL;
+
+		*prop = SPA_POD_PROP_INIT(sizeof(struct spa_pod_prop_body) + size,
+					  fields[i].key, SPA_POD_PROP_RANGE_NONE,
+					  size, fields[i].type);
+
+		tmpl->fields[i].field = fields[i];
+		tmpl->fields[i].size = size;
+		tmpl->fields[i].pod_offset = tmpl->size + sizeof(struct spa_pod_prop);
+		tmpl->size += SPA_ROUND_UP_N(sizeof(struct spa_pod_prop) + size, 8);
+	}
+	tmpl->n_fields = n_fields;
+
+	return 0;
+}
+
+/** Write the properties of the template with the values from \a data.
+ * The builder should be in an object, see spa_pod_builder_push_object().
+ * \return 0 on success or -ENOSPC when the builder is full */
+static inline int
+spa_pod_template_write(struct spa_pod_builder *builder,
+		       const struct spa_pod_template *tmpl, const void *data)
+{
+	uint8_t *dst;
+	uint32_t i;
+
+	dst = (uint8_t *) spa_pod_builder_deref(builder,
+			spa_pod_builder_raw(builder, tmpl->data, tmpl->size));
+	if (dst == NULL)
+		return -ENOSPC;
+
+	for (i = 0; i < tmpl->n_fields; i++) {
+		const void *src = SPA_MEMBER(data, tmpl->fields[i].field.offset, void);
+		void *val = dst + tmpl->fields[i].pod_offset;
+
+		if (tmpl->fields[i].field.type == SPA_POD_TYPE_BOOL)
+			*(int32_t *) val = *(const bool *) src ? 1 : 0;
+		else
+			memcpy(val, src, tmpl->fields[i].size);
+	}
+	return 0;
+}
+
+/** Build an object with the properties of the template
+ * \return the object or NULL when the builder is full */
+static inline struct spa_pod *
+spa_pod_template_build(struct spa_pod_builder *builder, uint32_t id, uint32_t type,
+		       const struct spa_pod_template *tmpl, const void *data)
+{
+	struct spa_pod *pod;
+	int res;
+
+	spa_pod_builder_push_object(builder, id, type);
+	res = spa_pod_template_write(builder, tmpl, data);
+	pod = (struct spa_pod *) spa_pod_builder_pop(builder);
+
+	return res < 0 ? NULL : pod;
+}
+
+/** Parse the properties of \a object into \a data. Properties that are
+ * not in the template, that are unset or have a different type are
+ * skipped.
+ * \return the number of values that were parsed */
+static inline int
+spa_pod_template_parse(const struct spa_pod_template *tmpl,
+		       const struct spa_pod *object, void *data)
+{
+	const struct spa_pod_object *obj = (const struct spa_pod_object *) object;
+	struct spa_pod *pod;
+	uint32_t i, next = 0;
+	int count = 0;
+
+	if (SPA_POD_TYPE(object) != SPA_POD_TYPE_OBJECT || tmpl->n_fields == 0)
+		return 0;
+
+	SPA_POD_OBJECT_FOREACH(obj, pod) {
+		struct spa_pod_prop *prop = (struct spa_pod_prop *) pod;
+		const void *val;
+		void *dst;
+
+		if (pod->type != SPA_POD_TYPE_PROP ||
+		    (prop->body.flags & SPA_POD_PROP_FLAG_UNSET))
+			continue;
+
+		/* the properties are usually in the order of the template */
+		for (i = 0; i < tmpl->n_fields; i++) {
+			if (tmpl->fields[next].field.key == prop->body.key)
+				break;
+			if (++next == tmpl->n_fields)
+				next = 0;
+		}
+		if (i == tmpl->n_fields ||
+		    prop->body.value.type != tmpl->fields[next].field.type ||
+		    prop->body.value.size < tmpl->fields[next].size)
+			continue;
+
+		val = SPA_POD_BODY_CONST(&prop->body.value);
+		dst = SPA_MEMBER(data, tmpl->fields[next].field.offset, void);
+
+		if (tmpl->fields[next].field.type == SPA_POD_TYPE_BOOL)
+			*(bool *) dst = *(const int32_t *) val != 0;
+		else
+			memcpy(dst, val, tmpl->fields[next].size);
+
+		count++;
+		if (++next == tmpl->n_fields)
+			next = 0;
+	}
+	return count;
+}
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* __SPA_POD_TEMPLATE_H__ */
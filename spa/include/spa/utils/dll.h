@@ -0,0 +1,126 @@
+/* Simple Plugin API
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __SPA_DLL_H__
+#define __SPA_DLL_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <math.h>
+
+#include <spa/utils/defs.h>
+
+/** The loop bandwidth in Hz to lock quickly after a start */
+#define SPA_DLL_BW_MAX		0.128
+/** The loop bandwidth in Hz to track a locked device */
+#define SPA_DLL_BW_MIN		0.016
+
+/**
+ * A delay-locked loop.
+ *
+ * The loop relates the ticks of a device to the monotonic clock. It
+ * filters the jitter of the wakeups out of the measured times and
+ * estimates the real rate of the device.
+ */
+struct spa_dll {
+	double bw;		/*< the bandwidth of the loop in Hz */
+	double period;		/*< the estimated nanoseconds per tick */
+	double time;		/*< the filtered time of \a ticks in nanoseconds */
+	int64_t ticks;		/*< the ticks of the last update */
+	bool locked;		/*< if the loop had a first measurement */
+};
+
+/**
+ * Initialize a spa_dll for a device with \a rate nominal ticks per second
+ *
+ * \param dll a spa_dll
+ * \param bw the bandwidth of the loop in Hz
+ * \param rate the nominal rate of the device
+ */
+static inline void spa_dll_init(struct spa_dll *dll, double bw, int32_t rate)
+{
+	dll->bw = bw;
+	dll->period = (double) SPA_NSEC_PER_SEC / rate;
+	dll->time = 0.0;
+	dll->ticks = 0;
+	dll->locked = false;
+}
+
+/** Change the bandwidth of \a dll, the estimates are kept */
+static inline void spa_dll_set_bw(struct spa_dll *dll, double bw)
+{
+	dll->bw = bw;
+}
+
+/**
+ * Update \a dll with a measurement.
+ *
+ * \param dll a spa_dll
+ * \param ticks the ticks of the device at \a time
+ * \param time the monotonic time in nanoseconds
+ * \return the filtered time of \a ticks
+ */
+static inline int64_t spa_dll_update(struct spa_dll *dll, int64_t ticks, int64_t time)
+{
+	double dn, pred, err, omega;
+
+	dn = ticks - dll->ticks;
+
+	if (!dll->locked || dn < 0) {
+		dll->time = time;
+		dll->ticks = ticks;
+		dll->locked = true;
+		return time;
+	}
+	if (dn == 0)
+		return (int64_t) dll->time;
+
+	pred = dll->time + dn * dll->period;
+	err = time - pred;
+
+	/* a jump of more than the elapsed time is a restart of the device */
+	if (fabs(err) > dn * dll->period) {
+		dll->time = time;
+		dll->ticks = ticks;
+		return time;
+	}
+
+	/* a critically damped second order loop, the coefficients depend
+	 * on the time between the updates */
+	omega = 2.0 * M_PI * dll->bw * dn * dll->period / SPA_NSEC_PER_SEC;
+	dll->time = pred + M_SQRT2 * omega * err;
+	dll->period += omega * omega * err / dn;
+	dll->ticks = ticks;
+
+	return (int64_t) dll->time;
+}
+
+/** Get the estimated number of ticks per second of the device */
+static inline double spa_dll_get_rate(struct spa_dll *dll)
+{
+	return SPA_NSEC_PER_SEC / dll->period;
+}
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* __SPA_DLL_H__ */
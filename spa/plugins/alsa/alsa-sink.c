@@ -40,6 +40,7 @@ static void reset_props(struct props *props)
 	strncpy(props->device, default_device, 64);
 	props->min_latency = default_min_latency;
 	props->max_latency = default_max_latency;
+	props->quantum = 0;
 }
 
 static int impl_node_enum_params(struct spa_node *node,
@@ -115,6 +116,14 @@ static int impl_node_enum_params(struct spa_node *node,
 				":", t->param.propType, "ir", p->max_latency,
 					SPA_POD_PROP_MIN_MAX(1, INT32_MAX));
 			break;
+		case 5:
+			param = spa_pod_builder_object(&b,
+				id, t->param.PropInfo,
+				":", t->param.propId,   "I", t->prop_quantum,
+				":", t->param.propName, "s", "The frames per cycle, 0 for the default",
+				":", t->param.propType, "ir", p->quantum,
+					SPA_POD_PROP_MIN_MAX(0, INT32_MAX));
+			break;
 		default:
 			return 0;
 		}
@@ -130,7 +139,8 @@ static int impl_node_enum_params(struct spa_node *node,
 				":", t->prop_device_name, "S-r", p->device_name, sizeof(p->device_name),
 				":", t->prop_card_name,   "S-r", p->card_name, sizeof(p->card_name),
 				":", t->prop_min_latency, "i",   p->min_latency,
-				":", t->prop_max_latency, "i",   p->max_latency);
+				":", t->prop_max_latency, "i",   p->max_latency,
+				":", t->prop_quantum,     "i",   p->quantum);
 			break;
 		default:
 			return 0;
@@ -161,14 +171,16 @@ static int impl_node_set_param(struct spa_node *node, uint32_t id, uint32_t flag
 	if (id == t->param.idProps) {
 		struct props *p = &this->props;
 
-		if (param == NULL) {
+		if (param == NULL)
 			reset_props(p);
-			return 0;
-		}
-		spa_pod_object_parse(param,
-			":", t->prop_device,      "?S", p->device, sizeof(p->device),
-			":", t->prop_min_latency, "?i", &p->min_latency,
-			":", t->prop_max_latency, "?i", &p->max_latency, NULL);
+		else
+			spa_pod_object_parse(param,
+				":", t->prop_device,      "?S", p->device, sizeof(p->device),
+				":", t->prop_min_latency, "?i", &p->min_latency,
+				":", t->prop_max_latency, "?i", &p->max_latency,
+				":", t->prop_quantum,     "?i", &p->quantum, NULL);
+
+		return spa_alsa_update_quantum(this);
 	}
 	else
 		return -ENOENT;
@@ -637,6 +649,50 @@ static const struct spa_node impl_node = {
 	impl_node_process_output,
 };
 
+static int impl_clock_enum_params(struct spa_clock *clock, uint32_t id, uint32_t *index,
+				  struct spa_pod **param,
+				  struct spa_pod_builder *builder)
+{
+	return -ENOTSUP;
+}
+
+static int impl_clock_set_param(struct spa_clock *clock,
+				uint32_t id, uint32_t flags,
+				const struct spa_pod *param)
+{
+	return -ENOTSUP;
+}
+
+static int impl_clock_get_time(struct spa_clock *clock,
+			       int32_t *rate,
+			       int64_t *ticks,
+			       int64_t *monotonic_time)
+{
+	struct state *this;
+
+	spa_return_val_if_fail(clock != NULL, -EINVAL);
+
+	this = SPA_CONTAINER_OF(clock, struct state, clock);
+
+	if (rate)
+		*rate = this->rate;
+	if (ticks)
+		*ticks = this->last_ticks;
+	if (monotonic_time)
+		*monotonic_time = this->dll_monotonic;
+
+	return 0;
+}
+
+static const struct spa_clock impl_clock = {
+	SPA_VERSION_CLOCK,
+	NULL,
+	SPA_CLOCK_STATE_STOPPED,
+	impl_clock_enum_params,
+	impl_clock_set_param,
+	impl_clock_get_time,
+};
+
 static int impl_get_interface(struct spa_handle *handle, uint32_t interface_id, void **interface)
 {
 	struct state *this;
@@ -648,6 +704,8 @@ static int impl_get_interface(struct spa_handle *handle, uint32_t interface_id,
 
 	if (interface_id == this->type.node)
 		*interface = &this->node;
+	else if (interface_id == this->type.clock)
+		*interface = &this->clock;
 	else
 		return -ENOENT;
 
@@ -699,6 +757,7 @@ impl_init(const struct spa_handle_factory *factory,
 	init_type(&this->type, this->map);
 
 	this->node = impl_node;
+	this->clock = impl_clock;
 	this->stream = SND_PCM_STREAM_PLAYBACK;
 	reset_props(&this->props);
 
@@ -720,6 +779,7 @@ impl_init(const struct spa_handle_factory *factory,
 
 static const struct spa_interface_info impl_interfaces[] = {
 	{SPA_TYPE__Node,},
+	{SPA_TYPE__Clock,},
 };
 
 static int
@@ -732,6 +792,7 @@ impl_enum_interface_info(const struct spa_handle_factory *factory,
 
 	switch (*index) {
 	case 0:
+	case 1:
 		*info = &impl_interfaces[*index];
 		break;
 	default:
@@ -39,6 +39,7 @@ static void reset_props(struct props *props)
 {
 	strncpy(props->device, default_device, 64);
 	props->min_latency = default_min_latency;
+	props->quantum = 0;
 }
 
 static int impl_node_enum_params(struct spa_node *node,
@@ -107,6 +108,14 @@ static int impl_node_enum_params(struct spa_node *node,
 				":", t->param.propType, "ir", p->min_latency,
 					SPA_POD_PROP_MIN_MAX(1, INT32_MAX));
 			break;
+		case 4:
+			param = spa_pod_builder_object(&b,
+				id, t->param.PropInfo,
+				":", t->param.propId, "I", t->prop_quantum,
+				":", t->param.propName, "s", "The frames per cycle, 0 for the default",
+				":", t->param.propType, "ir", p->quantum,
+					SPA_POD_PROP_MIN_MAX(0, INT32_MAX));
+			break;
 		default:
 			return 0;
 		}
@@ -119,7 +128,8 @@ static int impl_node_enum_params(struct spa_node *node,
 				":", t->prop_device,      "S",   p->device, sizeof(p->device),
 				":", t->prop_device_name, "S-r", p->device_name, sizeof(p->device_name),
 				":", t->prop_card_name,   "S-r", p->card_name, sizeof(p->card_name),
-				":", t->prop_min_latency, "i",   p->min_latency);
+				":", t->prop_min_latency, "i",   p->min_latency,
+				":", t->prop_quantum,     "i",   p->quantum);
 			break;
 		default:
 			return 0;
@@ -150,13 +160,15 @@ static int impl_node_set_param(struct spa_node *node, uint32_t id, uint32_t flag
 	if (id == t->param.idProps) {
 		struct props *p = &this->props;
 
-		if (param == NULL) {
+		if (param == NULL)
 			reset_props(p);
-			return 0;
-		}
-		spa_pod_object_parse(param,
-			":", t->prop_device,      "?S", p->device, sizeof(p->device),
-			":", t->prop_min_latency, "?i", &p->min_latency, NULL);
+		else
+			spa_pod_object_parse(param,
+				":", t->prop_device,      "?S", p->device, sizeof(p->device),
+				":", t->prop_min_latency, "?i", &p->min_latency,
+				":", t->prop_quantum,     "?i", &p->quantum, NULL);
+
+		return spa_alsa_update_quantum(this);
 	}
 	else
 		return -ENOENT;
@@ -678,11 +690,11 @@ static int impl_clock_get_time(struct spa_clock *clock,
 	this = SPA_CONTAINER_OF(clock, struct state, clock);
 
 	if (rate)
-		*rate = SPA_USEC_PER_SEC;
+		*rate = this->rate;
 	if (ticks)
 		*ticks = this->last_ticks;
 	if (monotonic_time)
-		*monotonic_time = this->last_monotonic;
+		*monotonic_time = this->dll_monotonic;
 
 	return 0;
 }
@@ -13,6 +13,9 @@
 
 #include "alsa-utils.h"
 
+/* the smallest number of frames per cycle of a source */
+#define MIN_QUANTUM	32
+
 #define CHECK(s,msg) if ((err = (s)) < 0) { spa_log_error(state->log, msg ": %s", snd_strerror(err)); return err; }
 
 static int spa_alsa_open(struct state *state)
@@ -345,7 +348,7 @@ static inline void try_pull(struct state *state, snd_pcm_uframes_t frames,
 		io->status = SPA_STATUS_NEED_BUFFER;
 		if (state->range) {
 			state->range->offset = state->sample_count * state->frame_size;
-			state->range->min_size = state->threshold * state->frame_size;
+			state->range->min_size = state->quantum * state->frame_size;
 			state->range->max_size = frames * state->frame_size;
 		}
 		state->callbacks->need_input(state->callbacks_data);
@@ -359,7 +362,7 @@ pull_frames(struct state *state,
 	    snd_pcm_uframes_t frames,
 	    bool do_pull)
 {
-	snd_pcm_uframes_t total_frames = 0, to_write = SPA_MIN(frames, state->props.max_latency);
+	snd_pcm_uframes_t total_frames = 0, to_write = SPA_MIN(frames, state->quantum);
 	bool underrun = false;
 
 	try_pull(state, frames, 0, do_pull);
@@ -499,6 +502,19 @@ static int alsa_try_resume(struct state *state)
 	return res;
 }
 
+/* filter the device position through the dll, after the first seconds
+ * the bandwidth is lowered to follow only the drift of the device */
+static void update_dll(struct state *state)
+{
+	state->dll_monotonic = spa_dll_update(&state->dll, state->last_ticks,
+					      state->last_monotonic);
+
+	if (state->dll.bw == SPA_DLL_BW_MAX && state->last_ticks - state->dll_start > 8 * state->rate) {
+		spa_dll_set_bw(&state->dll, SPA_DLL_BW_MIN);
+		spa_log_debug(state->log, "alsa %p: rate %f", state, spa_dll_get_rate(&state->dll));
+	}
+}
+
 static void alsa_on_playback_timeout_event(struct spa_source *source)
 {
 	uint64_t exp;
@@ -531,6 +547,8 @@ static void alsa_on_playback_timeout_event(struct spa_source *source)
 
 	state->last_ticks = state->sample_count - state->filled;
 	state->last_monotonic = (int64_t) state->now.tv_sec * SPA_NSEC_PER_SEC + (int64_t) state->now.tv_nsec;
+	if (state->alsa_started)
+		update_dll(state);
 
 	spa_log_trace(state->log, "timeout %ld %d %ld %ld %ld", state->filled, state->threshold,
 		      state->sample_count, state->now.tv_sec, state->now.tv_nsec);
@@ -616,6 +634,7 @@ static void alsa_on_capture_timeout_event(struct spa_source *source)
 
 	state->last_ticks = state->sample_count + avail;
 	state->last_monotonic = (int64_t) htstamp.tv_sec * SPA_NSEC_PER_SEC + (int64_t) htstamp.tv_nsec;
+	update_dll(state);
 
 	spa_log_trace(state->log, "timeout %ld %d %ld %ld %ld", avail, state->threshold,
 		      state->sample_count, htstamp.tv_sec, htstamp.tv_nsec);
@@ -658,6 +677,48 @@ static void alsa_on_capture_timeout_event(struct spa_source *source)
 	timerfd_settime(state->timerfd, TFD_TIMER_ABSTIME, &ts, NULL);
 }
 
+/* Playback writes a quantum in each cycle and wakes up when only one quantum
+ * is left in the device, so the latency follows the quantum. Capture wakes up
+ * when a quantum can be read. Without requests the sink uses max_latency and
+ * the source min_latency, like before. */
+static void set_quantum(struct state *state)
+{
+	struct props *p = &state->props;
+
+	if (state->stream == SND_PCM_STREAM_PLAYBACK) {
+		state->quantum = p->quantum ?
+			SPA_CLAMP(p->quantum, MIN_QUANTUM, p->max_latency) : p->max_latency;
+		state->threshold = state->quantum;
+	} else {
+		state->quantum = p->quantum ?
+			SPA_CLAMP(p->quantum, MIN_QUANTUM, p->min_latency) : p->min_latency;
+		state->threshold = state->quantum;
+	}
+	spa_log_debug(state->log, "alsa %p: quantum %d threshold %d", state,
+		      state->quantum, state->threshold);
+}
+
+static int do_update_quantum(struct spa_loop *loop,
+			     bool async,
+			     uint32_t seq,
+			     const void *data,
+			     size_t size,
+			     void *user_data)
+{
+	struct state *state = user_data;
+	set_quantum(state);
+	return 0;
+}
+
+/* the next wakeup uses the new quantum, the PCM keeps running */
+int spa_alsa_update_quantum(struct state *state)
+{
+	if (!state->started)
+		return 0;
+
+	return spa_loop_invoke(state->data_loop, do_update_quantum, 0, NULL, 0, true, state);
+}
+
 int spa_alsa_start(struct state *state, bool xrun_recover)
 {
 	int err;
@@ -688,7 +749,10 @@ int spa_alsa_start(struct state *state, bool xrun_recover)
 	state->source.rmask = 0;
 	spa_loop_add_source(state->data_loop, &state->source);
 
-	state->threshold = state->props.min_latency;
+	set_quantum(state);
+	spa_dll_init(&state->dll, SPA_DLL_BW_MAX, state->rate);
+	state->dll_start = state->sample_count;
+	state->dll_monotonic = 0;
 
 	if (state->stream == SND_PCM_STREAM_PLAYBACK) {
 		state->alsa_started = false;
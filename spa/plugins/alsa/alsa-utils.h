@@ -32,6 +32,7 @@ extern "C" {
 #include <spa/support/loop.h>
 #include <spa/support/log.h>
 #include <spa/utils/list.h>
+#include <spa/utils/dll.h>
 
 #include <spa/clock/clock.h>
 #include <spa/node/node.h>
@@ -46,6 +47,7 @@ struct props {
 	char card_name[128];
 	uint32_t min_latency;
 	uint32_t max_latency;
+	uint32_t quantum;	/* requested frames per cycle, 0 for the default */
 };
 
 #define MAX_BUFFERS 32
@@ -67,6 +69,7 @@ struct type {
 	uint32_t prop_card_name;
 	uint32_t prop_min_latency;
 	uint32_t prop_max_latency;
+	uint32_t prop_quantum;
 	struct spa_type_io io;
 	struct spa_type_param param;
 	struct spa_type_meta meta;
@@ -93,6 +96,7 @@ static inline void init_type(struct type *type, struct spa_type_map *map)
 	type->prop_card_name = spa_type_map_get_id(map, SPA_TYPE_PROPS__cardName);
 	type->prop_min_latency = spa_type_map_get_id(map, SPA_TYPE_PROPS__minLatency);
 	type->prop_max_latency = spa_type_map_get_id(map, SPA_TYPE_PROPS__maxLatency);
+	type->prop_quantum = spa_type_map_get_id(map, SPA_TYPE_PROPS__quantum);
 
 	spa_type_io_map(map, &type->io);
 	spa_type_param_map(map, &type->param);
@@ -160,6 +164,7 @@ struct state {
 	int timerfd;
 	bool alsa_started;
 	int threshold;
+	int quantum;
 
 	snd_htimestamp_t now;
 	int64_t sample_count;
@@ -167,6 +172,10 @@ struct state {
 	int64_t last_ticks;
 	int64_t last_monotonic;
 
+	struct spa_dll dll;		/* relates the device ticks to the monotonic clock */
+	int64_t dll_monotonic;		/* the filtered time of last_ticks */
+	int64_t dll_start;		/* the sample_count when the dll started */
+
 	uint64_t underrun;
 };
 
@@ -179,6 +188,8 @@ spa_alsa_enum_format(struct state *state,
 
 int spa_alsa_set_format(struct state *state, struct spa_audio_info *info, uint32_t flags);
 
+int spa_alsa_update_quantum(struct state *state);
+
 int spa_alsa_start(struct state *state, bool xrun_recover);
 int spa_alsa_pause(struct state *state, bool xrun_recover);
 int spa_alsa_close(struct state *state);
@@ -0,0 +1,319 @@
+/* Spa
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include <math.h>
+
+#include <emmintrin.h>
+
+#include "fmt-ops.h"
+
+/* The results are the same as the scalar versions in fmt-ops.c. Mono and
+ * stereo use full vector loads and stores, other channel counts gather and
+ * scatter 4 frames of a channel. */
+
+#define F32_CLAMP(v)	SPA_MIN(SPA_MAX(v, -1.0f), 1.0f)
+
+static inline __m128 clamp_ps(__m128 v)
+{
+	return _mm_min_ps(_mm_max_ps(v, _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+}
+
+static void
+s16_to_f32_sse2(void *dst[], const void *src[], int n_channels, int n_frames)
+{
+	const int16_t *s = src[0];
+	const __m128 scale = _mm_set1_ps(1.0f / S16_SCALE);
+	__m128i in, lo, hi;
+	__m128 flo, fhi;
+	int i = 0, j;
+
+	if (n_channels == 1) {
+		float *d = dst[0];
+
+		for (; i + 8 <= n_frames; i += 8) {
+			in = _mm_loadu_si128((const __m128i *) &s[i]);
+			lo = _mm_srai_epi32(_mm_unpacklo_epi16(in, in), 16);
+			hi = _mm_srai_epi32(_mm_unpackhi_epi16(in, in), 16);
+			_mm_storeu_ps(&d[i], _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+			_mm_storeu_ps(&d[i + 4], _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+		}
+	}
+	else if (n_channels == 2) {
+		float *l = dst[0], *r = dst[1];
+
+		for (; i + 4 <= n_frames; i += 4) {
+			in = _mm_loadu_si128((const __m128i *) &s[i * 2]);
+			lo = _mm_srai_epi32(_mm_unpacklo_epi16(in, in), 16);
+			hi = _mm_srai_epi32(_mm_unpackhi_epi16(in, in), 16);
+			flo = _mm_mul_ps(_mm_cvtepi32_ps(lo), scale);
+			fhi = _mm_mul_ps(_mm_cvtepi32_ps(hi), scale);
+			_mm_storeu_ps(&l[i], _mm_shuffle_ps(flo, fhi, _MM_SHUFFLE(2, 0, 2, 0)));
+			_mm_storeu_ps(&r[i], _mm_shuffle_ps(flo, fhi, _MM_SHUFFLE(3, 1, 3, 1)));
+		}
+	}
+	else {
+		for (; i + 4 <= n_frames; i += 4) {
+			for (j = 0; j < n_channels; j++) {
+				const int16_t *sj = &s[i * n_channels + j];
+
+				in = _mm_setr_epi32(sj[0], sj[n_channels],
+						sj[2 * n_channels], sj[3 * n_channels]);
+				_mm_storeu_ps(&((float *) dst[j])[i],
+						_mm_mul_ps(_mm_cvtepi32_ps(in), scale));
+			}
+		}
+	}
+	for (; i < n_frames; i++) {
+		for (j = 0; j < n_channels; j++)
+			((float *) dst[j])[i] = s[i * n_channels + j] * (1.0f / S16_SCALE);
+	}
+}
+
+/* S24_32 and S32, S32 is shifted to 24 bits first */
+static inline void
+s32_to_f32_shift_sse2(void *dst[], const void *src[], int n_channels, int n_frames, int shift)
+{
+	const int32_t *s = src[0];
+	const __m128 scale = _mm_set1_ps(1.0f / S24_SCALE);
+	const __m128i count = _mm_cvtsi32_si128(shift);
+	__m128i in;
+	__m128 flo, fhi;
+	int i = 0, j;
+
+	if (n_channels == 1) {
+		float *d = dst[0];
+
+		for (; i + 4 <= n_frames; i += 4) {
+			in = _mm_sra_epi32(_mm_loadu_si128((const __m128i *) &s[i]), count);
+			_mm_storeu_ps(&d[i], _mm_mul_ps(_mm_cvtepi32_ps(in), scale));
+		}
+	}
+	else if (n_channels == 2) {
+		float *l = dst[0], *r = dst[1];
+
+		for (; i + 4 <= n_frames; i += 4) {
+			in = _mm_sra_epi32(_mm_loadu_si128((const __m128i *) &s[i * 2]), count);
+			flo = _mm_mul_ps(_mm_cvtepi32_ps(in), scale);
+			in = _mm_sra_epi32(_mm_loadu_si128((const __m128i *) &s[i * 2 + 4]), count);
+			fhi = _mm_mul_ps(_mm_cvtepi32_ps(in), scale);
+			_mm_storeu_ps(&l[i], _mm_shuffle_ps(flo, fhi, _MM_SHUFFLE(2, 0, 2, 0)));
+			_mm_storeu_ps(&r[i], _mm_shuffle_ps(flo, fhi, _MM_SHUFFLE(3, 1, 3, 1)));
+		}
+	}
+	else {
+		for (; i + 4 <= n_frames; i += 4) {
+			for (j = 0; j < n_channels; j++) {
+				const int32_t *sj = &s[i * n_channels + j];
+
+				in = _mm_setr_epi32(sj[0], sj[n_channels],
+						sj[2 * n_channels], sj[3 * n_channels]);
+				in = _mm_sra_epi32(in, count);
+				_mm_storeu_ps(&((float *) dst[j])[i],
+						_mm_mul_ps(_mm_cvtepi32_ps(in), scale));
+			}
+		}
+	}
+	for (; i < n_frames; i++) {
+		for (j = 0; j < n_channels; j++)
+			((float *) dst[j])[i] = (s[i * n_channels + j] >> shift) * (1.0f / S24_SCALE);
+	}
+}
+
+static void
+s24_32_to_f32_sse2(void *dst[], const void *src[], int n_channels, int n_frames)
+{
+	s32_to_f32_shift_sse2(dst, src, n_channels, n_frames, 0);
+}
+
+static void
+s32_to_f32_sse2(void *dst[], const void *src[], int n_channels, int n_frames)
+{
+	s32_to_f32_shift_sse2(dst, src, n_channels, n_frames, 8);
+}
+
+static void
+deinterleave_f32_sse2(void *dst[], const void *src[], int n_channels, int n_frames)
+{
+	const float *s = src[0];
+	__m128 lo, hi;
+	int i = 0, j;
+
+	if (n_channels == 1) {
+		memcpy(dst[0], s, n_frames * sizeof(float));
+		return;
+	}
+	else if (n_channels == 2) {
+		float *l = dst[0], *r = dst[1];
+
+		for (; i + 4 <= n_frames; i += 4) {
+			lo = _mm_loadu_ps(&s[i * 2]);
+			hi = _mm_loadu_ps(&s[i * 2 + 4]);
+			_mm_storeu_ps(&l[i], _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+			_mm_storeu_ps(&r[i], _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+		}
+	}
+	for (; i < n_frames; i++) {
+		for (j = 0; j < n_channels; j++)
+			((float *) dst[j])[i] = s[i * n_channels + j];
+	}
+}
+
+/* 4 frames of channel j as rounded integers of scale */
+static inline __m128i
+f32_to_s32_4_sse2(const void *src[], int j, int i, __m128 scale)
+{
+	__m128 in = _mm_loadu_ps(&((const float *) src[j])[i]);
+	return _mm_cvtps_epi32(_mm_mul_ps(clamp_ps(in), scale));
+}
+
+static void
+f32_to_s16_sse2(void *dst[], const void *src[], int n_channels, int n_frames)
+{
+	int16_t *d = dst[0];
+	const __m128 scale = _mm_set1_ps(S16_SCALE);
+	__m128i lo, hi;
+	__m128 l, r;
+	int32_t t[4];
+	int i = 0, j, k;
+
+	if (n_channels == 1) {
+		for (; i + 8 <= n_frames; i += 8) {
+			lo = f32_to_s32_4_sse2(src, 0, i, scale);
+			hi = f32_to_s32_4_sse2(src, 0, i + 4, scale);
+			_mm_storeu_si128((__m128i *) &d[i], _mm_packs_epi32(lo, hi));
+		}
+	}
+	else if (n_channels == 2) {
+		for (; i + 4 <= n_frames; i += 4) {
+			l = clamp_ps(_mm_loadu_ps(&((const float *) src[0])[i]));
+			r = clamp_ps(_mm_loadu_ps(&((const float *) src[1])[i]));
+			lo = _mm_cvtps_epi32(_mm_mul_ps(_mm_unpacklo_ps(l, r), scale));
+			hi = _mm_cvtps_epi32(_mm_mul_ps(_mm_unpackhi_ps(l, r), scale));
+			_mm_storeu_si128((__m128i *) &d[i * 2], _mm_packs_epi32(lo, hi));
+		}
+	}
+	else {
+		for (; i + 4 <= n_frames; i += 4) {
+			for (j = 0; j < n_channels; j++) {
+				_mm_storeu_si128((__m128i *) t, f32_to_s32_4_sse2(src, j, i, scale));
+				for (k = 0; k < 4; k++)
+					d[(i + k) * n_channels + j] = t[k];
+			}
+		}
+	}
+	for (; i < n_frames; i++) {
+		for (j = 0; j < n_channels; j++)
+			d[i * n_channels + j] = lrintf(F32_CLAMP(((const float *) src[j])[i]) * S16_SCALE);
+	}
+}
+
+/* S24_32 and S32, S32 is shifted from 24 bits */
+static inline void
+f32_to_s32_shift_sse2(void *dst[], const void *src[], int n_channels, int n_frames, int shift)
+{
+	int32_t *d = dst[0];
+	const __m128 scale = _mm_set1_ps(S24_SCALE);
+	const __m128i count = _mm_cvtsi32_si128(shift);
+	__m128i out;
+	__m128 l, r;
+	int32_t t[4];
+	int i = 0, j, k;
+
+	if (n_channels == 1) {
+		for (; i + 4 <= n_frames; i += 4) {
+			out = f32_to_s32_4_sse2(src, 0, i, scale);
+			_mm_storeu_si128((__m128i *) &d[i], _mm_sll_epi32(out, count));
+		}
+	}
+	else if (n_channels == 2) {
+		for (; i + 4 <= n_frames; i += 4) {
+			l = clamp_ps(_mm_loadu_ps(&((const float *) src[0])[i]));
+			r = clamp_ps(_mm_loadu_ps(&((const float *) src[1])[i]));
+			out = _mm_cvtps_epi32(_mm_mul_ps(_mm_unpacklo_ps(l, r), scale));
+			_mm_storeu_si128((__m128i *) &d[i * 2], _mm_sll_epi32(out, count));
+			out = _mm_cvtps_epi32(_mm_mul_ps(_mm_unpackhi_ps(l, r), scale));
+			_mm_storeu_si128((__m128i *) &d[i * 2 + 4], _mm_sll_epi32(out, count));
+		}
+	}
+	else {
+		for (; i + 4 <= n_frames; i += 4) {
+			for (j = 0; j < n_channels; j++) {
+				out = _mm_sll_epi32(f32_to_s32_4_sse2(src, j, i, scale), count);
+				_mm_storeu_si128((__m128i *) t, out);
+				for (k = 0; k < 4; k++)
+					d[(i + k) * n_channels + j] = t[k];
+			}
+		}
+	}
+	for (; i < n_frames; i++) {
+		for (j = 0; j < n_channels; j++)
+			d[i * n_channels + j] = (int32_t)
+				lrintf(F32_CLAMP(((const float *) src[j])[i]) * S24_SCALE) << shift;
+	}
+}
+
+static void
+f32_to_s24_32_sse2(void *dst[], const void *src[], int n_channels, int n_frames)
+{
+	f32_to_s32_shift_sse2(dst, src, n_channels, n_frames, 0);
+}
+
+static void
+f32_to_s32_sse2(void *dst[], const void *src[], int n_channels, int n_frames)
+{
+	f32_to_s32_shift_sse2(dst, src, n_channels, n_frames, 8);
+}
+
+static void
+interleave_f32_sse2(void *dst[], const void *src[], int n_channels, int n_frames)
+{
+	float *d = dst[0];
+	__m128 l, r;
+	int i = 0, j;
+
+	if (n_channels == 1) {
+		memcpy(d, src[0], n_frames * sizeof(float));
+		return;
+	}
+	else if (n_channels == 2) {
+		for (; i + 4 <= n_frames; i += 4) {
+			l = _mm_loadu_ps(&((const float *) src[0])[i]);
+			r = _mm_loadu_ps(&((const float *) src[1])[i]);
+			_mm_storeu_ps(&d[i * 2], _mm_unpacklo_ps(l, r));
+			_mm_storeu_ps(&d[i * 2 + 4], _mm_unpackhi_ps(l, r));
+		}
+	}
+	for (; i < n_frames; i++) {
+		for (j = 0; j < n_channels; j++)
+			d[i * n_channels + j] = ((const float *) src[j])[i];
+	}
+}
+
+void spa_audioconvert_get_ops_sse2(struct spa_audioconvert_ops *ops)
+{
+	ops->to_f32[CONV_FMT_S16] = s16_to_f32_sse2;
+	ops->to_f32[CONV_FMT_S24_32] = s24_32_to_f32_sse2;
+	ops->to_f32[CONV_FMT_S32] = s32_to_f32_sse2;
+	ops->to_f32[CONV_FMT_F32] = deinterleave_f32_sse2;
+	ops->from_f32[CONV_FMT_S16] = f32_to_s16_sse2;
+	ops->from_f32[CONV_FMT_S24_32] = f32_to_s24_32_sse2;
+	ops->from_f32[CONV_FMT_S32] = f32_to_s32_sse2;
+	ops->from_f32[CONV_FMT_F32] = interleave_f32_sse2;
+}
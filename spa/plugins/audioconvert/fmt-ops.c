@@ -0,0 +1,218 @@
+/* Spa
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include <endian.h>
+#include <math.h>
+
+#include "fmt-ops.h"
+
+const int spa_audioconvert_fmt_sizes[CONV_FMT_MAX] = {
+	[CONV_FMT_S16] = sizeof(int16_t),
+	[CONV_FMT_S24] = 3,
+	[CONV_FMT_S24_32] = sizeof(int32_t),
+	[CONV_FMT_S32] = sizeof(int32_t),
+	[CONV_FMT_F32] = sizeof(float),
+};
+
+/* NaN is clamped to -1.0, like the min and max of the vector versions */
+#define F32_CLAMP(v)	SPA_MIN(SPA_MAX(v, -1.0f), 1.0f)
+
+static inline int32_t read_s24(const uint8_t *s)
+{
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+	return (int32_t) (((uint32_t) s[0] << 8) | ((uint32_t) s[1] << 16) | ((uint32_t) s[2] << 24)) >> 8;
+#else
+	return (int32_t) (((uint32_t) s[2] << 8) | ((uint32_t) s[1] << 16) | ((uint32_t) s[0] << 24)) >> 8;
+#endif
+}
+
+static inline void write_s24(uint8_t *d, int32_t v)
+{
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+	d[0] = v;
+	d[1] = v >> 8;
+	d[2] = v >> 16;
+#else
+	d[0] = v >> 16;
+	d[1] = v >> 8;
+	d[2] = v;
+#endif
+}
+
+static void
+s16_to_f32(void *dst[], const void *src[], int n_channels, int n_frames)
+{
+	const int16_t *s = src[0];
+	int i, j;
+
+	for (i = 0; i < n_frames; i++) {
+		for (j = 0; j < n_channels; j++)
+			((float *) dst[j])[i] = *s++ * (1.0f / S16_SCALE);
+	}
+}
+
+static void
+s24_to_f32(void *dst[], const void *src[], int n_channels, int n_frames)
+{
+	const uint8_t *s = src[0];
+	int i, j;
+
+	for (i = 0; i < n_frames; i++) {
+		for (j = 0; j < n_channels; j++) {
+			((float *) dst[j])[i] = read_s24(s) * (1.0f / S24_SCALE);
+			s += 3;
+		}
+	}
+}
+
+static void
+s24_32_to_f32(void *dst[], const void *src[], int n_channels, int n_frames)
+{
+	const int32_t *s = src[0];
+	int i, j;
+
+	for (i = 0; i < n_frames; i++) {
+		for (j = 0; j < n_channels; j++)
+			((float *) dst[j])[i] = *s++ * (1.0f / S24_SCALE);
+	}
+}
+
+static void
+s32_to_f32(void *dst[], const void *src[], int n_channels, int n_frames)
+{
+	const int32_t *s = src[0];
+	int i, j;
+
+	for (i = 0; i < n_frames; i++) {
+		for (j = 0; j < n_channels; j++)
+			((float *) dst[j])[i] = (*s++ >> 8) * (1.0f / S24_SCALE);
+	}
+}
+
+static void
+deinterleave_f32(void *dst[], const void *src[], int n_channels, int n_frames)
+{
+	const float *s = src[0];
+	int i, j;
+
+	if (n_channels == 1) {
+		memcpy(dst[0], s, n_frames * sizeof(float));
+		return;
+	}
+	for (i = 0; i < n_frames; i++) {
+		for (j = 0; j < n_channels; j++)
+			((float *) dst[j])[i] = *s++;
+	}
+}
+
+static void
+f32_to_s16(void *dst[], const void *src[], int n_channels, int n_frames)
+{
+	int16_t *d = dst[0];
+	int i, j;
+
+	for (i = 0; i < n_frames; i++) {
+		for (j = 0; j < n_channels; j++)
+			*d++ = lrintf(F32_CLAMP(((const float *) src[j])[i]) * S16_SCALE);
+	}
+}
+
+static void
+f32_to_s24(void *dst[], const void *src[], int n_channels, int n_frames)
+{
+	uint8_t *d = dst[0];
+	int i, j;
+
+	for (i = 0; i < n_frames; i++) {
+		for (j = 0; j < n_channels; j++) {
+			write_s24(d, lrintf(F32_CLAMP(((const float *) src[j])[i]) * S24_SCALE));
+			d += 3;
+		}
+	}
+}
+
+static void
+f32_to_s24_32(void *dst[], const void *src[], int n_channels, int n_frames)
+{
+	int32_t *d = dst[0];
+	int i, j;
+
+	for (i = 0; i < n_frames; i++) {
+		for (j = 0; j < n_channels; j++)
+			*d++ = lrintf(F32_CLAMP(((const float *) src[j])[i]) * S24_SCALE);
+	}
+}
+
+static void
+f32_to_s32(void *dst[], const void *src[], int n_channels, int n_frames)
+{
+	int32_t *d = dst[0];
+	int i, j;
+
+	for (i = 0; i < n_frames; i++) {
+		for (j = 0; j < n_channels; j++)
+			*d++ = (int32_t) lrintf(F32_CLAMP(((const float *) src[j])[i]) * S24_SCALE) << 8;
+	}
+}
+
+static void
+interleave_f32(void *dst[], const void *src[], int n_channels, int n_frames)
+{
+	float *d = dst[0];
+	int i, j;
+
+	if (n_channels == 1) {
+		memcpy(d, src[0], n_frames * sizeof(float));
+		return;
+	}
+	for (i = 0; i < n_frames; i++) {
+		for (j = 0; j < n_channels; j++)
+			*d++ = ((const float *) src[j])[i];
+	}
+}
+
+void spa_audioconvert_get_ops_c(struct spa_audioconvert_ops *ops)
+{
+	ops->to_f32[CONV_FMT_S16] = s16_to_f32;
+	ops->to_f32[CONV_FMT_S24] = s24_to_f32;
+	ops->to_f32[CONV_FMT_S24_32] = s24_32_to_f32;
+	ops->to_f32[CONV_FMT_S32] = s32_to_f32;
+	ops->to_f32[CONV_FMT_F32] = deinterleave_f32;
+	ops->from_f32[CONV_FMT_S16] = f32_to_s16;
+	ops->from_f32[CONV_FMT_S24] = f32_to_s24;
+	ops->from_f32[CONV_FMT_S24_32] = f32_to_s24_32;
+	ops->from_f32[CONV_FMT_S32] = f32_to_s32;
+	ops->from_f32[CONV_FMT_F32] = interleave_f32;
+}
+
+void spa_audioconvert_get_ops_flags(struct spa_audioconvert_ops *ops, uint32_t cpu_flags)
+{
+	spa_audioconvert_get_ops_c(ops);
+
+#if defined (HAVE_SSE2)
+	if (cpu_flags & SPA_CPU_FLAG_SSE2)
+		spa_audioconvert_get_ops_sse2(ops);
+#endif
+}
+
+void spa_audioconvert_get_ops(struct spa_audioconvert_ops *ops)
+{
+	spa_audioconvert_get_ops_flags(ops, spa_cpu_get_flags());
+}
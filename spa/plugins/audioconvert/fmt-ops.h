@@ -0,0 +1,73 @@
+/* Spa
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include <string.h>
+#include <stdio.h>
+
+#include <spa/utils/defs.h>
+#include <spa/utils/cpu.h>
+
+/* Convert n_frames frames of n_channels channels between the sample formats
+ * and 32 bits float in [-1.0, 1.0].
+ *
+ * to_f32 reads one interleaved buffer from src[0] and writes the channels
+ * to the planes in dst[0] .. dst[n_channels - 1]. from_f32 reads the planes
+ * in src[0] .. src[n_channels - 1] and writes them interleaved to dst[0].
+ * With one channel both are a plain conversion, interleaved and planar
+ * data of the same layout are converted as one channel.
+ *
+ * Integer formats are scaled with their maximum value, float values are
+ * clamped and rounded to nearest. S32 has the resolution of S24, the low
+ * bits are 0. */
+typedef void (*convert_func_t) (void *dst[], const void *src[], int n_channels, int n_frames);
+
+enum {
+	CONV_FMT_S16,
+	CONV_FMT_S24,		/* packed 3 bytes, native endian */
+	CONV_FMT_S24_32,	/* 24 bits in the low bits of 32 bits */
+	CONV_FMT_S32,
+	CONV_FMT_F32,
+	CONV_FMT_MAX,
+};
+
+#define S16_SCALE	32767.0f
+#define S24_SCALE	8388607.0f
+
+/** the size of a sample of the formats */
+extern const int spa_audioconvert_fmt_sizes[CONV_FMT_MAX];
+
+struct spa_audioconvert_ops {
+	convert_func_t to_f32[CONV_FMT_MAX];
+	convert_func_t from_f32[CONV_FMT_MAX];
+};
+
+/** get the scalar reference functions */
+void spa_audioconvert_get_ops_c(struct spa_audioconvert_ops *ops);
+
+#if defined (HAVE_SSE2)
+void spa_audioconvert_get_ops_sse2(struct spa_audioconvert_ops *ops);
+#endif
+
+/** get the fastest functions for the given SPA_CPU_FLAG_*, the functions
+ * without a vector version are the scalar ones */
+void spa_audioconvert_get_ops_flags(struct spa_audioconvert_ops *ops, uint32_t cpu_flags);
+
+/** get the fastest functions for this CPU */
+void spa_audioconvert_get_ops(struct spa_audioconvert_ops *ops);
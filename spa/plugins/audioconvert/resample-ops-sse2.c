@@ -0,0 +1,77 @@
+/* Spa
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include <emmintrin.h>
+
+#include "resample-ops.h"
+
+/* The sums are made in the same order as inner_product_c() so that the
+ * results are the same. The taps are aligned. */
+
+static inline float hsum_ps(__m128 sum0, __m128 sum1)
+{
+	__m128 a = _mm_add_ps(sum0, sum1);
+
+	a = _mm_add_ps(a, _mm_movehl_ps(a, a));
+	a = _mm_add_ss(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 1, 1, 1)));
+	return _mm_cvtss_f32(a);
+}
+
+static void
+inner_product_sse2(float *d, const float *s, const float *taps, uint32_t n_taps)
+{
+	__m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps();
+	uint32_t i;
+
+	for (i = 0; i < n_taps; i += 8) {
+		sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(&s[i]), _mm_load_ps(&taps[i])));
+		sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(&s[i + 4]), _mm_load_ps(&taps[i + 4])));
+	}
+	*d = hsum_ps(sum0, sum1);
+}
+
+static void
+inner_product_ip_sse2(float *d, const float *s, const float *taps0, const float *taps1,
+		      float x, uint32_t n_taps)
+{
+	__m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps();
+	__m128 sum2 = _mm_setzero_ps(), sum3 = _mm_setzero_ps();
+	__m128 lo, hi;
+	uint32_t i;
+	float t0, t1;
+
+	for (i = 0; i < n_taps; i += 8) {
+		lo = _mm_loadu_ps(&s[i]);
+		hi = _mm_loadu_ps(&s[i + 4]);
+		sum0 = _mm_add_ps(sum0, _mm_mul_ps(lo, _mm_load_ps(&taps0[i])));
+		sum1 = _mm_add_ps(sum1, _mm_mul_ps(hi, _mm_load_ps(&taps0[i + 4])));
+		sum2 = _mm_add_ps(sum2, _mm_mul_ps(lo, _mm_load_ps(&taps1[i])));
+		sum3 = _mm_add_ps(sum3, _mm_mul_ps(hi, _mm_load_ps(&taps1[i + 4])));
+	}
+	t0 = hsum_ps(sum0, sum1);
+	t1 = hsum_ps(sum2, sum3);
+	*d = t0 + x * (t1 - t0);
+}
+
+void spa_resample_get_ops_sse2(struct spa_resample_ops *ops)
+{
+	ops->inner_product = inner_product_sse2;
+	ops->inner_product_ip = inner_product_ip_sse2;
+}
@@ -0,0 +1,282 @@
+/* Spa
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "resample-ops.h"
+
+/* phases of the exact filter, more are interpolated from this many */
+#define MAX_PHASES	1024
+#define INTER_PHASES	256
+/* input samples in the history after the taps */
+#define HISTORY_SIZE	8192
+
+static const struct quality {
+	uint32_t n_taps;
+	double cutoff;
+} quality_table[] = {
+	{ 8, 0.70, },
+	{ 16, 0.80, },
+	{ 24, 0.86, },
+	{ 32, 0.90, },
+	{ 48, 0.92, },
+	{ 64, 0.94, },
+	{ 96, 0.95, },
+};
+
+static void
+inner_product_c(float *d, const float *s, const float *taps, uint32_t n_taps)
+{
+	float sum[8] = { 0.0f, }, a[4];
+	uint32_t i, j;
+
+	/* sum in the order of the vector versions */
+	for (i = 0; i < n_taps; i += 8) {
+		for (j = 0; j < 8; j++)
+			sum[j] += s[i + j] * taps[i + j];
+	}
+	for (j = 0; j < 4; j++)
+		a[j] = sum[j] + sum[j + 4];
+	*d = (a[0] + a[2]) + (a[1] + a[3]);
+}
+
+static void
+inner_product_ip_c(float *d, const float *s, const float *taps0, const float *taps1,
+		   float x, uint32_t n_taps)
+{
+	float sum0, sum1;
+
+	inner_product_c(&sum0, s, taps0, n_taps);
+	inner_product_c(&sum1, s, taps1, n_taps);
+	*d = sum0 + x * (sum1 - sum0);
+}
+
+void spa_resample_get_ops_c(struct spa_resample_ops *ops)
+{
+	ops->inner_product = inner_product_c;
+	ops->inner_product_ip = inner_product_ip_c;
+}
+
+static uint32_t gcd(uint32_t a, uint32_t b)
+{
+	while (b != 0) {
+		uint32_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+static inline double sinc(double x)
+{
+	if (x == 0.0)
+		return 1.0;
+	x *= M_PI;
+	return sin(x) / x;
+}
+
+/* Blackman-Harris window of width n_taps, x is the distance to the center */
+static inline double window(double x, uint32_t n_taps)
+{
+	x = 2.0 * M_PI * x / n_taps;
+	return 0.35875 + 0.48829 * cos(x) + 0.14128 * cos(2.0 * x) + 0.01168 * cos(3.0 * x);
+}
+
+/* row p is the filter for an output between the input samples at
+ * n_taps / 2 - 1 and n_taps / 2, p / n_phases after the first */
+static void build_filter(float *filter, uint32_t n_taps, uint32_t n_phases, double cutoff)
+{
+	uint32_t p, t, center = n_taps / 2 - 1;
+
+	for (p = 0; p <= n_phases; p++) {
+		float *row = &filter[p * n_taps];
+		double x, sum = 0.0;
+
+		for (t = 0; t < n_taps; t++) {
+			x = (double) t - center - (double) p / n_phases;
+			row[t] = cutoff * sinc(x * cutoff) * window(x, n_taps);
+			sum += row[t];
+		}
+		/* unity gain for DC in all phases */
+		for (t = 0; t < n_taps; t++)
+			row[t] /= sum;
+	}
+}
+
+int spa_resample_init(struct spa_resample *r, uint32_t cpu_flags)
+{
+	const struct quality *q;
+	uint32_t c, div, in_rate, out_rate, filter_size;
+	double cutoff;
+	void *data;
+
+	if (r->channels == 0 || r->i_rate == 0 || r->o_rate == 0)
+		return -EINVAL;
+
+	r->quality = SPA_CLAMP(r->quality, RESAMPLE_QUALITY_MIN, RESAMPLE_QUALITY_MAX);
+	q = &quality_table[r->quality];
+
+	div = gcd(r->i_rate, r->o_rate);
+	in_rate = r->i_rate / div;
+	out_rate = r->o_rate / div;
+
+	/* lower the cutoff and use more taps when downsampling */
+	cutoff = q->cutoff;
+	r->n_taps = q->n_taps;
+	if (in_rate > out_rate) {
+		cutoff = cutoff * out_rate / in_rate;
+		r->n_taps = SPA_ROUND_UP_N((uint32_t) ceil(q->n_taps * (double) in_rate / out_rate), 8);
+	}
+
+	if (out_rate <= MAX_PHASES) {
+		r->n_phases = out_rate;
+		r->in_phases = in_rate;
+	} else {
+		r->n_phases = INTER_PHASES;
+		r->in_phases = 0;
+	}
+
+	filter_size = SPA_ROUND_UP_N((r->n_phases + 1) * r->n_taps * sizeof(float), 16);
+	r->hist_size = r->n_taps + HISTORY_SIZE;
+
+	if (posix_memalign(&data, 16, filter_size +
+			   r->channels * (sizeof(float *) + r->hist_size * sizeof(float))) != 0)
+		return -ENOMEM;
+
+	r->data = data;
+	r->filter = data;
+	r->history = SPA_MEMBER(r->filter, filter_size, float *);
+	for (c = 0; c < r->channels; c++)
+		r->history[c] = SPA_MEMBER(&r->history[r->channels],
+					   c * r->hist_size * sizeof(float), float);
+
+	build_filter(r->filter, r->n_taps, r->n_phases, cutoff);
+
+	spa_resample_get_ops_c(&r->ops);
+#if defined (HAVE_SSE2)
+	if (cpu_flags & SPA_CPU_FLAG_SSE2)
+		spa_resample_get_ops_sse2(&r->ops);
+#endif
+
+	spa_resample_update_rate(r, 1.0);
+	spa_resample_reset(r);
+
+	return 0;
+}
+
+void spa_resample_free(struct spa_resample *r)
+{
+	free(r->data);
+	r->data = NULL;
+}
+
+void spa_resample_update_rate(struct spa_resample *r, double rate)
+{
+	r->rate = rate;
+
+	if (r->in_phases != 0 && rate == 1.0)
+		r->phase_inc = r->in_phases;
+	else
+		r->phase_inc = (double) r->i_rate * r->n_phases / r->o_rate * rate;
+}
+
+void spa_resample_reset(struct spa_resample *r)
+{
+	uint32_t c;
+
+	/* start with silence in the taps before the first sample */
+	r->hist_len = r->n_taps / 2 - 1;
+	for (c = 0; c < r->channels; c++)
+		memset(r->history[c], 0, r->hist_len * sizeof(float));
+	r->index = 0;
+	r->phase = 0.0;
+}
+
+uint32_t spa_resample_delay(struct spa_resample *r)
+{
+	return r->n_taps / 2;
+}
+
+void spa_resample_process(struct spa_resample *r,
+			  const void *src[], uint32_t *in_len,
+			  void *dst[], uint32_t *out_len)
+{
+	uint32_t c, n, consumed = 0, produced = 0, row, drop;
+	uint32_t n_taps = r->n_taps, n_phases = r->n_phases, index = r->index;
+	double phase = r->phase, phase_inc = r->phase_inc;
+	float x;
+
+	while (true) {
+		/* append as much input as fits */
+		n = SPA_MIN(*in_len - consumed, r->hist_size - r->hist_len);
+		for (c = 0; c < r->channels; c++)
+			memcpy(&r->history[c][r->hist_len],
+			       (const float *) src[c] + consumed, n * sizeof(float));
+		r->hist_len += n;
+		consumed += n;
+
+		for (; produced < *out_len && index + n_taps <= r->hist_len; produced++) {
+			row = (uint32_t) phase;
+			x = phase - row;
+
+			if (x == 0.0f) {
+				const float *taps = &r->filter[row * n_taps];
+
+				for (c = 0; c < r->channels; c++)
+					r->ops.inner_product((float *) dst[c] + produced,
+							&r->history[c][index], taps, n_taps);
+			} else {
+				const float *taps0 = &r->filter[row * n_taps];
+				const float *taps1 = taps0 + n_taps;
+
+				for (c = 0; c < r->channels; c++)
+					r->ops.inner_product_ip((float *) dst[c] + produced,
+							&r->history[c][index], taps0, taps1,
+							x, n_taps);
+			}
+
+			phase += phase_inc;
+			while (phase >= n_phases) {
+				phase -= n_phases;
+				index++;
+			}
+		}
+
+		/* remove the history that is not needed anymore */
+		drop = SPA_MIN(index, r->hist_len);
+		if (drop > 0) {
+			for (c = 0; c < r->channels; c++)
+				memmove(r->history[c], &r->history[c][drop],
+					(r->hist_len - drop) * sizeof(float));
+			r->hist_len -= drop;
+			index -= drop;
+		}
+
+		if (consumed == *in_len || produced == *out_len)
+			break;
+	}
+	r->index = index;
+	r->phase = phase;
+
+	*in_len = consumed;
+	*out_len = produced;
+}
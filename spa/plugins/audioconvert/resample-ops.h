@@ -0,0 +1,98 @@
+/* Spa
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include <string.h>
+#include <stdio.h>
+
+#include <spa/utils/defs.h>
+#include <spa/utils/cpu.h>
+
+/* A windowed sinc resampler for float planes. The filter is precomputed
+ * for every phase of the ratio of the rates. When the ratio needs too many
+ * phases or the rate is adjusted, the output is interpolated between the
+ * two nearest phases. */
+
+#define RESAMPLE_QUALITY_MIN		0
+#define RESAMPLE_QUALITY_MAX		6
+#define RESAMPLE_QUALITY_DEFAULT	4
+
+/* sum of s[i] * taps[i], n_taps is a multiple of 8 */
+typedef void (*inner_product_func_t) (float *d, const float *s,
+				      const float *taps, uint32_t n_taps);
+/* the inner product interpolated between taps0 and taps1 with x */
+typedef void (*inner_product_ip_func_t) (float *d, const float *s,
+					 const float *taps0, const float *taps1,
+					 float x, uint32_t n_taps);
+
+struct spa_resample_ops {
+	inner_product_func_t inner_product;
+	inner_product_ip_func_t inner_product_ip;
+};
+
+struct spa_resample {
+	uint32_t channels;
+	uint32_t i_rate;
+	uint32_t o_rate;
+	int quality;
+	double rate;		/**< adjustment of the ratio, for drift compensation */
+
+	struct spa_resample_ops ops;
+
+	uint32_t n_taps;
+	uint32_t n_phases;
+	uint32_t in_phases;	/**< phases per output sample when rate is 1.0 */
+	double phase_inc;	/**< phases per output sample */
+	double phase;		/**< phase of the next output sample */
+	uint32_t index;		/**< first history sample of the next output sample */
+	uint32_t hist_len;	/**< samples in the history */
+	uint32_t hist_size;
+	float *filter;		/**< n_phases + 1 rows of n_taps */
+	float **history;	/**< the input of the channels */
+	void *data;
+};
+
+void spa_resample_get_ops_c(struct spa_resample_ops *ops);
+#if defined (HAVE_SSE2)
+void spa_resample_get_ops_sse2(struct spa_resample_ops *ops);
+#endif
+
+/** initialize the resampler for channels, i_rate, o_rate and quality
+ * with the fastest functions for cpu_flags.
+ * \return 0 on success, < 0 on error */
+int spa_resample_init(struct spa_resample *r, uint32_t cpu_flags);
+
+void spa_resample_free(struct spa_resample *r);
+
+/** adjust the ratio of the rates with \a rate */
+void spa_resample_update_rate(struct spa_resample *r, double rate);
+
+/** forget the history */
+void spa_resample_reset(struct spa_resample *r);
+
+/** the delay of the output in input samples */
+uint32_t spa_resample_delay(struct spa_resample *r);
+
+/** resample the planes in src to the planes in dst. in_len has the
+ * available input samples and returns the consumed ones, out_len has
+ * the space in dst and returns the produced samples. Input that does not
+ * make output yet is kept until the next call. */
+void spa_resample_process(struct spa_resample *r,
+			  const void *src[], uint32_t *in_len,
+			  void *dst[], uint32_t *out_len);
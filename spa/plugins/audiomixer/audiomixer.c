@@ -149,11 +149,10 @@ struct impl {
 	struct spa_audio_info format;
 	uint32_t bpf;
 
-	mix_clear_func_t clear;
-	mix_func_t copy;
-	mix_func_t add;
-	mix_scale_func_t copy_scale;
-	mix_scale_func_t add_scale;
+	mix_n_func_t mix_n;
+	struct port *mix_ports[MAX_PORTS];
+	const void *mix_src[MAX_PORTS];
+	double mix_scale[MAX_PORTS];
 
 	bool started;
 };
@@ -617,19 +616,11 @@ static int port_set_format(struct spa_node *node,
 				return -EINVAL;
 		} else {
 			if (info.info.raw.format == t->audio_format.S16) {
-				this->clear = this->ops.clear[FMT_S16];
-				this->copy = this->ops.copy[FMT_S16];
-				this->add = this->ops.add[FMT_S16];
-				this->copy_scale = this->ops.copy_scale[FMT_S16];
-				this->add_scale = this->ops.add_scale[FMT_S16];
+				this->mix_n = this->ops.mix_n[FMT_S16];
 				this->bpf = sizeof(int16_t) * info.info.raw.channels;
 			}
 			else if (info.info.raw.format == t->audio_format.F32) {
-				this->clear = this->ops.clear[FMT_F32];
-				this->copy = this->ops.copy[FMT_F32];
-				this->add = this->ops.add[FMT_F32];
-				this->copy_scale = this->ops.copy_scale[FMT_F32];
-				this->add_scale = this->ops.add_scale[FMT_F32];
+				this->mix_n = this->ops.mix_n[FMT_F32];
 				this->bpf = sizeof(float) * info.info.raw.channels;
 			}
 			else
@@ -816,78 +807,49 @@ impl_node_port_send_command(struct spa_node *node,
 	return -ENOTSUP;
 }
 
-static inline void
-add_port_data(struct impl *this, void *out, size_t outsize, struct port *port, int layer)
+static inline void *
+get_port_data(struct port *port, uint32_t *avail)
 {
-	size_t insize;
-	struct buffer *b;
-	uint32_t index, offset, len1, len2, maxsize;
-	struct spa_data *d;
-	void *data;
-	double volume = *port->io_volume;
-	bool mute = *port->io_mute;
-
-	b = spa_list_first(&port->queue, struct buffer, link);
-
-	d = b->outbuf->datas;
+	struct buffer *b = spa_list_first(&port->queue, struct buffer, link);
+	struct spa_data *d = b->outbuf->datas;
+	uint32_t maxsize, insize, offset;
 
 	maxsize = d[0].maxsize;
-	data = d[0].data;
-
 	insize = SPA_MIN(d[0].chunk->size, maxsize);
-	outsize = SPA_MIN(outsize, insize);
+	offset = (d[0].chunk->offset + (insize - port->queued_bytes)) % maxsize;
 
-	index = d[0].chunk->offset + (insize - port->queued_bytes);
-	offset = index % maxsize;
-
-	len1 = SPA_MIN(outsize, maxsize - offset);
-	len2 = outsize - len1;
-
-	if (volume < 0.001 || mute) {
-		/* silence, for the first layer clear, otherwise do nothing */
-		if (layer == 0) {
-			this->clear(out, len1);
-			if (len2 > 0)
-				this->clear(out + len1, len2);
-		}
-	}
-	else if (volume < 0.999 || volume > 1.001) {
-		mix_scale_func_t mix = layer == 0 ? this->copy_scale : this->add_scale;
+	*avail = SPA_MIN(port->queued_bytes, maxsize - offset);
 
-		mix(out, SPA_MEMBER(data, offset, void), volume, len1);
-		if (len2 > 0)
-			mix(out + len1, data, volume, len2);
-	}
-	else {
-		mix_func_t mix = layer == 0 ? this->copy : this->add;
+	return SPA_MEMBER(d[0].data, offset, void);
+}
 
-		mix(out, SPA_MEMBER(data, offset, void), len1);
-		if (len2 > 0)
-			mix(out + len1, data, len2);
-	}
+static inline void
+consume_port_data(struct impl *this, struct port *port, size_t n_bytes)
+{
+	struct buffer *b = spa_list_first(&port->queue, struct buffer, link);
 
-	port->queued_bytes -= outsize;
+	port->queued_bytes -= n_bytes;
 
 	if (port->queued_bytes == 0) {
 		spa_log_trace(this->log, NAME " %p: return buffer %d on port %p %zd",
-			      this, b->outbuf->id, port, outsize);
+			      this, b->outbuf->id, port, n_bytes);
 		port->io->buffer_id = b->outbuf->id;
 		spa_list_remove(&b->link);
 		b->outstanding = true;
 	} else {
 		spa_log_trace(this->log, NAME " %p: keeping buffer %d on port %p %zd %zd",
-			      this, b->outbuf->id, port, port->queued_bytes, outsize);
+			      this, b->outbuf->id, port, port->queued_bytes, n_bytes);
 	}
 }
 
 static int mix_output(struct impl *this, size_t n_bytes)
 {
 	struct buffer *outbuf;
-	int i, layer;
+	int i, n_ports, n_src;
 	struct port *outport;
 	struct spa_io_buffers *outio;
 	struct spa_data *od;
-	uint32_t avail, index, maxsize, len1, len2, offset;
+	uint32_t avail, index, maxsize, len, offset, done;
 
 	outport = GET_OUT_PORT(this, 0);
 	outio = outport->io;
@@ -908,14 +870,10 @@ static int mix_output(struct impl *this, size_t n_bytes)
 	index = 0;
 	n_bytes = SPA_MIN(n_bytes, avail);
 
-	offset = index % maxsize;
-	len1 = SPA_MIN(n_bytes, maxsize - offset);
-	len2 = n_bytes - len1;
-
-	spa_log_trace(this->log, NAME " %p: dequeue output buffer %d %zd %d %d %d",
-		      this, outbuf->outbuf->id, n_bytes, offset, len1, len2);
+	spa_log_trace(this->log, NAME " %p: dequeue output buffer %d %zd %d",
+		      this, outbuf->outbuf->id, n_bytes, index);
 
-	for (layer = 0, i = 0; i < this->last_port; i++) {
+	for (n_ports = 0, i = 0; i < this->last_port; i++) {
 		struct port *in_port = GET_IN_PORT(this, i);
 
 		if (in_port->io == NULL || in_port->n_buffers == 0)
@@ -925,11 +883,48 @@ static int mix_output(struct impl *this, size_t n_bytes)
 			spa_log_warn(this->log, NAME " %p: underrun stream %d", this, i);
 			continue;
 		}
+		this->mix_ports[n_ports++] = in_port;
+	}
+
+	/* mix all inputs in one pass over the output, split where the output
+	 * or one of the inputs wraps around */
+	for (done = 0; done < n_bytes; done += len) {
+		offset = (index + done) % maxsize;
+		len = SPA_MIN(n_bytes - done, maxsize - offset);
+
+		for (n_src = 0, i = 0; i < n_ports; i++) {
+			struct port *in_port = this->mix_ports[i];
+			double volume = *in_port->io_volume;
+			bool mute = *in_port->io_mute;
+			const void *data;
+
+			if (in_port->queued_bytes == 0)
+				continue;
+
+			data = get_port_data(in_port, &avail);
+			len = SPA_MIN(len, avail);
+
+			/* silence, nothing to add */
+			if (volume < 0.001 || mute)
+				continue;
+
+			if (volume > 0.999 && volume < 1.001)
+				volume = 1.0;
+
+			this->mix_src[n_src] = data;
+			this->mix_scale[n_src] = volume;
+			n_src++;
+		}
 
-		add_port_data(this, SPA_MEMBER(od[0].data, offset, void), len1, in_port, layer);
-		if (len2 > 0)
-			add_port_data(this, od[0].data, len2, in_port, layer);
-		layer++;
+		this->mix_n(SPA_MEMBER(od[0].data, offset, void),
+			    this->mix_src, this->mix_scale, n_src, len);
+
+		for (i = 0; i < n_ports; i++) {
+			struct port *in_port = this->mix_ports[i];
+
+			if (in_port->queued_bytes > 0)
+				consume_port_data(this, in_port, len);
+		}
 	}
 
 	od[0].chunk->offset = index;
@@ -0,0 +1,239 @@
+/* Spa
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <immintrin.h>
+
+#include "mix-ops.h"
+
+/* Same as the SSE2 versions, with 256 bits registers. The unpack and pack
+ * instructions work per 128 bits lane so the sample order is kept. */
+
+static void
+add_s16_avx2(void *dst, const void *src, int n_bytes)
+{
+	const int16_t *s = src;
+	int16_t *d = dst;
+	int n, n_samples = n_bytes / sizeof(int16_t);
+	int32_t t;
+
+	for (n = 0; n + 16 <= n_samples; n += 16) {
+		__m256i in = _mm256_loadu_si256((const __m256i *) &s[n]);
+		__m256i out = _mm256_loadu_si256((const __m256i *) &d[n]);
+		_mm256_storeu_si256((__m256i *) &d[n], _mm256_adds_epi16(out, in));
+	}
+	for (; n < n_samples; n++) {
+		t = d[n] + s[n];
+		d[n] = SPA_CLAMP(t, INT16_MIN, INT16_MAX);
+	}
+}
+
+static void
+add_f32_avx2(void *dst, const void *src, int n_bytes)
+{
+	const float *s = src;
+	float *d = dst;
+	int n, n_samples = n_bytes / sizeof(float);
+
+	for (n = 0; n + 16 <= n_samples; n += 16) {
+		__m256 in0 = _mm256_loadu_ps(&s[n]);
+		__m256 in1 = _mm256_loadu_ps(&s[n + 8]);
+		__m256 out0 = _mm256_loadu_ps(&d[n]);
+		__m256 out1 = _mm256_loadu_ps(&d[n + 8]);
+		_mm256_storeu_ps(&d[n], _mm256_add_ps(out0, in0));
+		_mm256_storeu_ps(&d[n + 8], _mm256_add_ps(out1, in1));
+	}
+	for (; n < n_samples; n++)
+		d[n] += s[n];
+}
+
+static inline void
+scale_s16_avx2(__m256i in, __m256i v, __m256i *lo, __m256i *hi)
+{
+	__m256i pl = _mm256_mullo_epi16(in, v);
+	__m256i ph = _mm256_mulhi_epi16(in, v);
+	*lo = _mm256_srai_epi32(_mm256_unpacklo_epi16(pl, ph), 11);
+	*hi = _mm256_srai_epi32(_mm256_unpackhi_epi16(pl, ph), 11);
+}
+
+static void
+copy_scale_s16_avx2(void *dst, const void *src, const double scale, int n_bytes)
+{
+	const int16_t *s = src;
+	int16_t *d = dst;
+	int32_t v = scale * (1 << 11), t;
+	int n = 0, n_samples = n_bytes / sizeof(int16_t);
+
+	/* the 16 bits multiply needs the volume to fit in 16 bits */
+	if (v >= INT16_MIN && v <= INT16_MAX) {
+		__m256i vv = _mm256_set1_epi16(v), lo, hi;
+
+		for (; n + 16 <= n_samples; n += 16) {
+			scale_s16_avx2(_mm256_loadu_si256((const __m256i *) &s[n]), vv, &lo, &hi);
+			_mm256_storeu_si256((__m256i *) &d[n], _mm256_packs_epi32(lo, hi));
+		}
+	}
+	for (; n < n_samples; n++) {
+		t = (s[n] * v) >> 11;
+		d[n] = SPA_CLAMP(t, INT16_MIN, INT16_MAX);
+	}
+}
+
+static void
+add_scale_s16_avx2(void *dst, const void *src, const double scale, int n_bytes)
+{
+	const int16_t *s = src;
+	int16_t *d = dst;
+	int32_t v = scale * (1 << 11), t;
+	int n = 0, n_samples = n_bytes / sizeof(int16_t);
+
+	if (v >= INT16_MIN && v <= INT16_MAX) {
+		__m256i vv = _mm256_set1_epi16(v), lo, hi, out;
+
+		for (; n + 16 <= n_samples; n += 16) {
+			scale_s16_avx2(_mm256_loadu_si256((const __m256i *) &s[n]), vv, &lo, &hi);
+			out = _mm256_loadu_si256((const __m256i *) &d[n]);
+			lo = _mm256_add_epi32(lo, _mm256_srai_epi32(_mm256_unpacklo_epi16(out, out), 16));
+			hi = _mm256_add_epi32(hi, _mm256_srai_epi32(_mm256_unpackhi_epi16(out, out), 16));
+			_mm256_storeu_si256((__m256i *) &d[n], _mm256_packs_epi32(lo, hi));
+		}
+	}
+	for (; n < n_samples; n++) {
+		t = d[n] + ((s[n] * v) >> 11);
+		d[n] = SPA_CLAMP(t, INT16_MIN, INT16_MAX);
+	}
+}
+
+static void
+copy_scale_f32_avx2(void *dst, const void *src, const double scale, int n_bytes)
+{
+	const float *s = src;
+	float *d = dst;
+	float v = scale;
+	__m256 vv = _mm256_set1_ps(v);
+	int n, n_samples = n_bytes / sizeof(float);
+
+	for (n = 0; n + 16 <= n_samples; n += 16) {
+		_mm256_storeu_ps(&d[n], _mm256_mul_ps(_mm256_loadu_ps(&s[n]), vv));
+		_mm256_storeu_ps(&d[n + 8], _mm256_mul_ps(_mm256_loadu_ps(&s[n + 8]), vv));
+	}
+	for (; n < n_samples; n++)
+		d[n] = s[n] * v;
+}
+
+static void
+add_scale_f32_avx2(void *dst, const void *src, const double scale, int n_bytes)
+{
+	const float *s = src;
+	float *d = dst;
+	float v = scale;
+	__m256 vv = _mm256_set1_ps(v);
+	int n, n_samples = n_bytes / sizeof(float);
+
+	for (n = 0; n + 16 <= n_samples; n += 16) {
+		__m256 in0 = _mm256_mul_ps(_mm256_loadu_ps(&s[n]), vv);
+		__m256 in1 = _mm256_mul_ps(_mm256_loadu_ps(&s[n + 8]), vv);
+		_mm256_storeu_ps(&d[n], _mm256_add_ps(_mm256_loadu_ps(&d[n]), in0));
+		_mm256_storeu_ps(&d[n + 8], _mm256_add_ps(_mm256_loadu_ps(&d[n + 8]), in1));
+	}
+	for (; n < n_samples; n++)
+		d[n] += s[n] * v;
+}
+
+static void
+mix_n_s16_avx2(void *dst, const void *src[], const double scale[], int n_src, int n_bytes)
+{
+	int16_t *d = dst;
+	int32_t sum[MIX_N_BLOCK] __attribute__ ((aligned (32))), v, t;
+	int i, j, n, o, n_samples = n_bytes / sizeof(int16_t);
+	__m256i lo, hi;
+
+	for (o = 0; o < n_samples; o += n) {
+		n = SPA_MIN(n_samples - o, MIX_N_BLOCK);
+
+		memset(sum, 0, n * sizeof(int32_t));
+		for (i = 0; i < n_src; i++) {
+			const int16_t *s = (const int16_t *) src[i] + o;
+			__m256i vv;
+
+			/* widen first so that the sums stay in sample order and
+			 * the volume has no range limit */
+			v = scale[i] * (1 << 11);
+			vv = _mm256_set1_epi32(v);
+			for (j = 0; j + 16 <= n; j += 16) {
+				lo = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) &s[j]));
+				hi = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) &s[j + 8]));
+				lo = _mm256_srai_epi32(_mm256_mullo_epi32(lo, vv), 11);
+				hi = _mm256_srai_epi32(_mm256_mullo_epi32(hi, vv), 11);
+				lo = _mm256_add_epi32(lo, _mm256_load_si256((__m256i *) &sum[j]));
+				hi = _mm256_add_epi32(hi, _mm256_load_si256((__m256i *) &sum[j + 8]));
+				_mm256_store_si256((__m256i *) &sum[j], lo);
+				_mm256_store_si256((__m256i *) &sum[j + 8], hi);
+			}
+			for (; j < n; j++)
+				sum[j] += (s[j] * v) >> 11;
+		}
+		for (j = 0; j + 16 <= n; j += 16) {
+			lo = _mm256_load_si256((__m256i *) &sum[j]);
+			hi = _mm256_load_si256((__m256i *) &sum[j + 8]);
+			/* the pack works per 128 bits lane, put the samples back in order */
+			_mm256_storeu_si256((__m256i *) &d[o + j],
+					_mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xd8));
+		}
+		for (; j < n; j++) {
+			t = sum[j];
+			d[o + j] = SPA_CLAMP(t, INT16_MIN, INT16_MAX);
+		}
+	}
+}
+
+static void
+mix_n_f32_avx2(void *dst, const void *src[], const double scale[], int n_src, int n_bytes)
+{
+	float *d = dst;
+	int i, n, o, n_samples = n_bytes / sizeof(float);
+
+	for (o = 0; o < n_samples; o += n) {
+		n = SPA_MIN(n_samples - o, MIX_N_BLOCK);
+
+		if (n_src == 0)
+			memset(&d[o], 0, n * sizeof(float));
+		for (i = 0; i < n_src; i++) {
+			const float *s = (const float *) src[i] + o;
+
+			if (i == 0)
+				copy_scale_f32_avx2(&d[o], s, scale[i], n * sizeof(float));
+			else
+				add_scale_f32_avx2(&d[o], s, scale[i], n * sizeof(float));
+		}
+	}
+}
+
+void spa_audiomixer_get_ops_avx2(struct spa_audiomixer_ops *ops)
+{
+	ops->add[FMT_S16] = add_s16_avx2;
+	ops->add[FMT_F32] = add_f32_avx2;
+	ops->copy_scale[FMT_S16] = copy_scale_s16_avx2;
+	ops->copy_scale[FMT_F32] = copy_scale_f32_avx2;
+	ops->add_scale[FMT_S16] = add_scale_s16_avx2;
+	ops->add_scale[FMT_F32] = add_scale_f32_avx2;
+	ops->mix_n[FMT_S16] = mix_n_s16_avx2;
+	ops->mix_n[FMT_F32] = mix_n_f32_avx2;
+}
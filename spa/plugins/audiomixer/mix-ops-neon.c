@@ -0,0 +1,207 @@
+/* Spa
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <arm_neon.h>
+
+#include "mix-ops.h"
+
+/* The results are the same as the scalar versions in mix-ops.c. The s16
+ * volume is applied with 32 bits multiplies so it has no range limit, the
+ * saturating narrow does the clamping. Multiply and add are kept separate
+ * instructions so that float results are not fused. */
+
+static void
+add_s16_neon(void *dst, const void *src, int n_bytes)
+{
+	const int16_t *s = src;
+	int16_t *d = dst;
+	int n, n_samples = n_bytes / sizeof(int16_t);
+	int32_t t;
+
+	for (n = 0; n + 8 <= n_samples; n += 8)
+		vst1q_s16(&d[n], vqaddq_s16(vld1q_s16(&d[n]), vld1q_s16(&s[n])));
+
+	for (; n < n_samples; n++) {
+		t = d[n] + s[n];
+		d[n] = SPA_CLAMP(t, INT16_MIN, INT16_MAX);
+	}
+}
+
+static void
+add_f32_neon(void *dst, const void *src, int n_bytes)
+{
+	const float *s = src;
+	float *d = dst;
+	int n, n_samples = n_bytes / sizeof(float);
+
+	for (n = 0; n + 8 <= n_samples; n += 8) {
+		vst1q_f32(&d[n], vaddq_f32(vld1q_f32(&d[n]), vld1q_f32(&s[n])));
+		vst1q_f32(&d[n + 4], vaddq_f32(vld1q_f32(&d[n + 4]), vld1q_f32(&s[n + 4])));
+	}
+	for (; n < n_samples; n++)
+		d[n] += s[n];
+}
+
+static void
+copy_scale_s16_neon(void *dst, const void *src, const double scale, int n_bytes)
+{
+	const int16_t *s = src;
+	int16_t *d = dst;
+	int32_t v = scale * (1 << 11), t;
+	int n, n_samples = n_bytes / sizeof(int16_t);
+
+	for (n = 0; n + 8 <= n_samples; n += 8) {
+		int16x8_t in = vld1q_s16(&s[n]);
+		int32x4_t lo = vshrq_n_s32(vmulq_n_s32(vmovl_s16(vget_low_s16(in)), v), 11);
+		int32x4_t hi = vshrq_n_s32(vmulq_n_s32(vmovl_s16(vget_high_s16(in)), v), 11);
+		vst1q_s16(&d[n], vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+	}
+	for (; n < n_samples; n++) {
+		t = (s[n] * v) >> 11;
+		d[n] = SPA_CLAMP(t, INT16_MIN, INT16_MAX);
+	}
+}
+
+static void
+add_scale_s16_neon(void *dst, const void *src, const double scale, int n_bytes)
+{
+	const int16_t *s = src;
+	int16_t *d = dst;
+	int32_t v = scale * (1 << 11), t;
+	int n, n_samples = n_bytes / sizeof(int16_t);
+
+	for (n = 0; n + 8 <= n_samples; n += 8) {
+		int16x8_t in = vld1q_s16(&s[n]);
+		int16x8_t out = vld1q_s16(&d[n]);
+		int32x4_t lo = vshrq_n_s32(vmulq_n_s32(vmovl_s16(vget_low_s16(in)), v), 11);
+		int32x4_t hi = vshrq_n_s32(vmulq_n_s32(vmovl_s16(vget_high_s16(in)), v), 11);
+		lo = vaddw_s16(lo, vget_low_s16(out));
+		hi = vaddw_s16(hi, vget_high_s16(out));
+		vst1q_s16(&d[n], vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+	}
+	for (; n < n_samples; n++) {
+		t = d[n] + ((s[n] * v) >> 11);
+		d[n] = SPA_CLAMP(t, INT16_MIN, INT16_MAX);
+	}
+}
+
+static void
+copy_scale_f32_neon(void *dst, const void *src, const double scale, int n_bytes)
+{
+	const float *s = src;
+	float *d = dst;
+	float v = scale;
+	int n, n_samples = n_bytes / sizeof(float);
+
+	for (n = 0; n + 8 <= n_samples; n += 8) {
+		vst1q_f32(&d[n], vmulq_n_f32(vld1q_f32(&s[n]), v));
+		vst1q_f32(&d[n + 4], vmulq_n_f32(vld1q_f32(&s[n + 4]), v));
+	}
+	for (; n < n_samples; n++)
+		d[n] = s[n] * v;
+}
+
+static void
+add_scale_f32_neon(void *dst, const void *src, const double scale, int n_bytes)
+{
+	const float *s = src;
+	float *d = dst;
+	float v = scale;
+	int n, n_samples = n_bytes / sizeof(float);
+
+	for (n = 0; n + 8 <= n_samples; n += 8) {
+		float32x4_t in0 = vmulq_n_f32(vld1q_f32(&s[n]), v);
+		float32x4_t in1 = vmulq_n_f32(vld1q_f32(&s[n + 4]), v);
+		vst1q_f32(&d[n], vaddq_f32(vld1q_f32(&d[n]), in0));
+		vst1q_f32(&d[n + 4], vaddq_f32(vld1q_f32(&d[n + 4]), in1));
+	}
+	for (; n < n_samples; n++)
+		d[n] += s[n] * v;
+}
+
+static void
+mix_n_s16_neon(void *dst, const void *src[], const double scale[], int n_src, int n_bytes)
+{
+	int16_t *d = dst;
+	int32_t sum[MIX_N_BLOCK] __attribute__ ((aligned (16))), v, t;
+	int i, j, n, o, n_samples = n_bytes / sizeof(int16_t);
+
+	for (o = 0; o < n_samples; o += n) {
+		n = SPA_MIN(n_samples - o, MIX_N_BLOCK);
+
+		memset(sum, 0, n * sizeof(int32_t));
+		for (i = 0; i < n_src; i++) {
+			const int16_t *s = (const int16_t *) src[i] + o;
+
+			v = scale[i] * (1 << 11);
+			for (j = 0; j + 8 <= n; j += 8) {
+				int16x8_t in = vld1q_s16(&s[j]);
+				int32x4_t lo = vshrq_n_s32(vmulq_n_s32(vmovl_s16(vget_low_s16(in)), v), 11);
+				int32x4_t hi = vshrq_n_s32(vmulq_n_s32(vmovl_s16(vget_high_s16(in)), v), 11);
+				vst1q_s32(&sum[j], vaddq_s32(vld1q_s32(&sum[j]), lo));
+				vst1q_s32(&sum[j + 4], vaddq_s32(vld1q_s32(&sum[j + 4]), hi));
+			}
+			for (; j < n; j++)
+				sum[j] += (s[j] * v) >> 11;
+		}
+		for (j = 0; j + 8 <= n; j += 8)
+			vst1q_s16(&d[o + j], vcombine_s16(vqmovn_s32(vld1q_s32(&sum[j])),
+							  vqmovn_s32(vld1q_s32(&sum[j + 4]))));
+		for (; j < n; j++) {
+			t = sum[j];
+			d[o + j] = SPA_CLAMP(t, INT16_MIN, INT16_MAX);
+		}
+	}
+}
+
+static void
+mix_n_f32_neon(void *dst, const void *src[], const double scale[], int n_src, int n_bytes)
+{
+	float *d = dst;
+	int i, n, o, n_samples = n_bytes / sizeof(float);
+
+	for (o = 0; o < n_samples; o += n) {
+		n = SPA_MIN(n_samples - o, MIX_N_BLOCK);
+
+		if (n_src == 0)
+			memset(&d[o], 0, n * sizeof(float));
+		for (i = 0; i < n_src; i++) {
+			const float *s = (const float *) src[i] + o;
+
+			if (i == 0)
+				copy_scale_f32_neon(&d[o], s, scale[i], n * sizeof(float));
+			else
+				add_scale_f32_neon(&d[o], s, scale[i], n * sizeof(float));
+		}
+	}
+}
+
+void spa_audiomixer_get_ops_neon(struct spa_audiomixer_ops *ops)
+{
+	ops->add[FMT_S16] = add_s16_neon;
+	ops->add[FMT_F32] = add_f32_neon;
+	ops->copy_scale[FMT_S16] = copy_scale_s16_neon;
+	ops->copy_scale[FMT_F32] = copy_scale_f32_neon;
+	ops->add_scale[FMT_S16] = add_scale_s16_neon;
+	ops->add_scale[FMT_F32] = add_scale_f32_neon;
+	ops->mix_n[FMT_S16] = mix_n_s16_neon;
+	ops->mix_n[FMT_F32] = mix_n_f32_neon;
+}
@@ -0,0 +1,236 @@
+/* Spa
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <emmintrin.h>
+
+#include "mix-ops.h"
+
+/* The results are the same as the scalar versions in mix-ops.c: the
+ * saturating instructions do the clamping and the s16 volume is applied
+ * with 32 bits intermediates and the same shift. */
+
+static void
+add_s16_sse2(void *dst, const void *src, int n_bytes)
+{
+	const int16_t *s = src;
+	int16_t *d = dst;
+	int n, n_samples = n_bytes / sizeof(int16_t);
+	int32_t t;
+
+	for (n = 0; n + 8 <= n_samples; n += 8) {
+		__m128i in = _mm_loadu_si128((const __m128i *) &s[n]);
+		__m128i out = _mm_loadu_si128((const __m128i *) &d[n]);
+		_mm_storeu_si128((__m128i *) &d[n], _mm_adds_epi16(out, in));
+	}
+	for (; n < n_samples; n++) {
+		t = d[n] + s[n];
+		d[n] = SPA_CLAMP(t, INT16_MIN, INT16_MAX);
+	}
+}
+
+static void
+add_f32_sse2(void *dst, const void *src, int n_bytes)
+{
+	const float *s = src;
+	float *d = dst;
+	int n, n_samples = n_bytes / sizeof(float);
+
+	for (n = 0; n + 8 <= n_samples; n += 8) {
+		__m128 in0 = _mm_loadu_ps(&s[n]);
+		__m128 in1 = _mm_loadu_ps(&s[n + 4]);
+		__m128 out0 = _mm_loadu_ps(&d[n]);
+		__m128 out1 = _mm_loadu_ps(&d[n + 4]);
+		_mm_storeu_ps(&d[n], _mm_add_ps(out0, in0));
+		_mm_storeu_ps(&d[n + 4], _mm_add_ps(out1, in1));
+	}
+	for (; n < n_samples; n++)
+		d[n] += s[n];
+}
+
+static inline void
+scale_s16_sse2(__m128i in, __m128i v, __m128i *lo, __m128i *hi)
+{
+	__m128i pl = _mm_mullo_epi16(in, v);
+	__m128i ph = _mm_mulhi_epi16(in, v);
+	*lo = _mm_srai_epi32(_mm_unpacklo_epi16(pl, ph), 11);
+	*hi = _mm_srai_epi32(_mm_unpackhi_epi16(pl, ph), 11);
+}
+
+static void
+copy_scale_s16_sse2(void *dst, const void *src, const double scale, int n_bytes)
+{
+	const int16_t *s = src;
+	int16_t *d = dst;
+	int32_t v = scale * (1 << 11), t;
+	int n = 0, n_samples = n_bytes / sizeof(int16_t);
+
+	/* the 16 bits multiply needs the volume to fit in 16 bits */
+	if (v >= INT16_MIN && v <= INT16_MAX) {
+		__m128i vv = _mm_set1_epi16(v), lo, hi;
+
+		for (; n + 8 <= n_samples; n += 8) {
+			scale_s16_sse2(_mm_loadu_si128((const __m128i *) &s[n]), vv, &lo, &hi);
+			_mm_storeu_si128((__m128i *) &d[n], _mm_packs_epi32(lo, hi));
+		}
+	}
+	for (; n < n_samples; n++) {
+		t = (s[n] * v) >> 11;
+		d[n] = SPA_CLAMP(t, INT16_MIN, INT16_MAX);
+	}
+}
+
+static void
+add_scale_s16_sse2(void *dst, const void *src, const double scale, int n_bytes)
+{
+	const int16_t *s = src;
+	int16_t *d = dst;
+	int32_t v = scale * (1 << 11), t;
+	int n = 0, n_samples = n_bytes / sizeof(int16_t);
+
+	if (v >= INT16_MIN && v <= INT16_MAX) {
+		__m128i vv = _mm_set1_epi16(v), lo, hi, out;
+
+		for (; n + 8 <= n_samples; n += 8) {
+			scale_s16_sse2(_mm_loadu_si128((const __m128i *) &s[n]), vv, &lo, &hi);
+			out = _mm_loadu_si128((const __m128i *) &d[n]);
+			lo = _mm_add_epi32(lo, _mm_srai_epi32(_mm_unpacklo_epi16(out, out), 16));
+			hi = _mm_add_epi32(hi, _mm_srai_epi32(_mm_unpackhi_epi16(out, out), 16));
+			_mm_storeu_si128((__m128i *) &d[n], _mm_packs_epi32(lo, hi));
+		}
+	}
+	for (; n < n_samples; n++) {
+		t = d[n] + ((s[n] * v) >> 11);
+		d[n] = SPA_CLAMP(t, INT16_MIN, INT16_MAX);
+	}
+}
+
+static void
+copy_scale_f32_sse2(void *dst, const void *src, const double scale, int n_bytes)
+{
+	const float *s = src;
+	float *d = dst;
+	float v = scale;
+	__m128 vv = _mm_set1_ps(v);
+	int n, n_samples = n_bytes / sizeof(float);
+
+	for (n = 0; n + 8 <= n_samples; n += 8) {
+		_mm_storeu_ps(&d[n], _mm_mul_ps(_mm_loadu_ps(&s[n]), vv));
+		_mm_storeu_ps(&d[n + 4], _mm_mul_ps(_mm_loadu_ps(&s[n + 4]), vv));
+	}
+	for (; n < n_samples; n++)
+		d[n] = s[n] * v;
+}
+
+static void
+add_scale_f32_sse2(void *dst, const void *src, const double scale, int n_bytes)
+{
+	const float *s = src;
+	float *d = dst;
+	float v = scale;
+	__m128 vv = _mm_set1_ps(v);
+	int n, n_samples = n_bytes / sizeof(float);
+
+	for (n = 0; n + 8 <= n_samples; n += 8) {
+		__m128 in0 = _mm_mul_ps(_mm_loadu_ps(&s[n]), vv);
+		__m128 in1 = _mm_mul_ps(_mm_loadu_ps(&s[n + 4]), vv);
+		_mm_storeu_ps(&d[n], _mm_add_ps(_mm_loadu_ps(&d[n]), in0));
+		_mm_storeu_ps(&d[n + 4], _mm_add_ps(_mm_loadu_ps(&d[n + 4]), in1));
+	}
+	for (; n < n_samples; n++)
+		d[n] += s[n] * v;
+}
+
+static void
+mix_n_s16_sse2(void *dst, const void *src[], const double scale[], int n_src, int n_bytes)
+{
+	int16_t *d = dst;
+	int32_t sum[MIX_N_BLOCK] __attribute__ ((aligned (16))), v, t;
+	int i, j, n, o, n_samples = n_bytes / sizeof(int16_t);
+	__m128i lo, hi;
+
+	for (o = 0; o < n_samples; o += n) {
+		n = SPA_MIN(n_samples - o, MIX_N_BLOCK);
+
+		memset(sum, 0, n * sizeof(int32_t));
+		for (i = 0; i < n_src; i++) {
+			const int16_t *s = (const int16_t *) src[i] + o;
+
+			v = scale[i] * (1 << 11);
+			j = 0;
+			if (v >= INT16_MIN && v <= INT16_MAX) {
+				__m128i vv = _mm_set1_epi16(v);
+
+				for (; j + 8 <= n; j += 8) {
+					scale_s16_sse2(_mm_loadu_si128((const __m128i *) &s[j]), vv, &lo, &hi);
+					lo = _mm_add_epi32(lo, _mm_load_si128((__m128i *) &sum[j]));
+					hi = _mm_add_epi32(hi, _mm_load_si128((__m128i *) &sum[j + 4]));
+					_mm_store_si128((__m128i *) &sum[j], lo);
+					_mm_store_si128((__m128i *) &sum[j + 4], hi);
+				}
+			}
+			for (; j < n; j++)
+				sum[j] += (s[j] * v) >> 11;
+		}
+		for (j = 0; j + 8 <= n; j += 8) {
+			lo = _mm_load_si128((__m128i *) &sum[j]);
+			hi = _mm_load_si128((__m128i *) &sum[j + 4]);
+			_mm_storeu_si128((__m128i *) &d[o + j], _mm_packs_epi32(lo, hi));
+		}
+		for (; j < n; j++) {
+			t = sum[j];
+			d[o + j] = SPA_CLAMP(t, INT16_MIN, INT16_MAX);
+		}
+	}
+}
+
+static void
+mix_n_f32_sse2(void *dst, const void *src[], const double scale[], int n_src, int n_bytes)
+{
+	float *d = dst;
+	int i, n, o, n_samples = n_bytes / sizeof(float);
+
+	for (o = 0; o < n_samples; o += n) {
+		n = SPA_MIN(n_samples - o, MIX_N_BLOCK);
+
+		if (n_src == 0)
+			memset(&d[o], 0, n * sizeof(float));
+		for (i = 0; i < n_src; i++) {
+			const float *s = (const float *) src[i] + o;
+
+			if (i == 0)
+				copy_scale_f32_sse2(&d[o], s, scale[i], n * sizeof(float));
+			else
+				add_scale_f32_sse2(&d[o], s, scale[i], n * sizeof(float));
+		}
+	}
+}
+
+void spa_audiomixer_get_ops_sse2(struct spa_audiomixer_ops *ops)
+{
+	ops->add[FMT_S16] = add_s16_sse2;
+	ops->add[FMT_F32] = add_f32_sse2;
+	ops->copy_scale[FMT_S16] = copy_scale_s16_sse2;
+	ops->copy_scale[FMT_F32] = copy_scale_f32_sse2;
+	ops->add_scale[FMT_S16] = add_scale_s16_sse2;
+	ops->add_scale[FMT_F32] = add_scale_f32_sse2;
+	ops->mix_n[FMT_S16] = mix_n_s16_sse2;
+	ops->mix_n[FMT_F32] = mix_n_f32_sse2;
+}
@@ -255,7 +255,55 @@ add_scale_f32_i(void *dst, int dst_stride, const void *src, int src_stride, cons
 	}
 }
 
-void spa_audiomixer_get_ops(struct spa_audiomixer_ops *ops)
+static void
+mix_n_s16(void *dst, const void *src[], const double scale[], int n_src, int n_bytes)
+{
+	int16_t *d = dst;
+	int32_t sum[MIX_N_BLOCK], v, t;
+	int i, j, n, o, n_samples = n_bytes / sizeof(int16_t);
+
+	for (o = 0; o < n_samples; o += n) {
+		n = SPA_MIN(n_samples - o, MIX_N_BLOCK);
+
+		memset(sum, 0, n * sizeof(int32_t));
+		for (i = 0; i < n_src; i++) {
+			const int16_t *s = (const int16_t *) src[i] + o;
+
+			v = scale[i] * (1 << 11);
+			for (j = 0; j < n; j++)
+				sum[j] += (s[j] * v) >> 11;
+		}
+		for (j = 0; j < n; j++) {
+			t = sum[j];
+			d[o + j] = SPA_CLAMP(t, INT16_MIN, INT16_MAX);
+		}
+	}
+}
+
+static void
+mix_n_f32(void *dst, const void *src[], const double scale[], int n_src, int n_bytes)
+{
+	float *d = dst;
+	int i, n, o, n_samples = n_bytes / sizeof(float);
+
+	for (o = 0; o < n_samples; o += n) {
+		n = SPA_MIN(n_samples - o, MIX_N_BLOCK);
+
+		if (n_src == 0)
+			clear_f32(&d[o], n * sizeof(float));
+		/* the block of dst stays in cache while the sources are added */
+		for (i = 0; i < n_src; i++) {
+			const float *s = (const float *) src[i] + o;
+
+			if (i == 0)
+				copy_scale_f32(&d[o], s, scale[i], n * sizeof(float));
+			else
+				add_scale_f32(&d[o], s, scale[i], n * sizeof(float));
+		}
+	}
+}
+
+void spa_audiomixer_get_ops_c(struct spa_audiomixer_ops *ops)
 {
 	ops->clear[FMT_S16] = clear_s16;
 	ops->clear[FMT_F32] = clear_f32;
@@ -275,4 +323,34 @@ void spa_audiomixer_get_ops(struct spa_audiomixer_ops *ops)
         ops->copy_scale_i[FMT_F32] = copy_scale_f32_i;
         ops->add_scale_i[FMT_S16] = add_scale_s16_i;
         ops->add_scale_i[FMT_F32] = add_scale_f32_i;
+        ops->mix_n[FMT_S16] = mix_n_s16;
+        ops->mix_n[FMT_F32] = mix_n_f32;
+}
+
+uint32_t spa_audiomixer_get_cpu_flags(void)
+{
+	return spa_cpu_get_flags();
+}
+
+void spa_audiomixer_get_ops_flags(struct spa_audiomixer_ops *ops, uint32_t cpu_flags)
+{
+	spa_audiomixer_get_ops_c(ops);
+
+#if defined (HAVE_SSE2)
+	if (cpu_flags & SPA_AUDIOMIXER_CPU_SSE2)
+		spa_audiomixer_get_ops_sse2(ops);
+#endif
+#if defined (HAVE_AVX2)
+	if (cpu_flags & SPA_AUDIOMIXER_CPU_AVX2)
+		spa_audiomixer_get_ops_avx2(ops);
+#endif
+#if defined (HAVE_NEON)
+	if (cpu_flags & SPA_AUDIOMIXER_CPU_NEON)
+		spa_audiomixer_get_ops_neon(ops);
+#endif
+}
+
+void spa_audiomixer_get_ops(struct spa_audiomixer_ops *ops)
+{
+	spa_audiomixer_get_ops_flags(ops, spa_audiomixer_get_cpu_flags());
 }
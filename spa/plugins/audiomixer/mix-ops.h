@@ -21,6 +21,7 @@
 #include <stdio.h>
 
 #include <spa/utils/defs.h>
+#include <spa/utils/cpu.h>
 
 typedef void (*mix_clear_func_t) (void *dst, int n_bytes);
 typedef void (*mix_func_t) (void *dst, const void *src, int n_bytes);
@@ -29,6 +30,13 @@ typedef void (*mix_i_func_t) (void *dst, int dst_stride,
 			      const void *src, int src_stride, int n_bytes);
 typedef void (*mix_scale_i_func_t) (void *dst, int dst_stride,
 				    const void *src, int src_stride, const double scale, int n_bytes);
+/* dst = sum of src[i] * scale[i], in one pass over dst. With n_src 0, dst is
+ * cleared. S16 is summed with 32 bits and clamped once. */
+typedef void (*mix_n_func_t) (void *dst, const void *src[], const double scale[],
+			      int n_src, int n_bytes);
+
+/* samples per block of the mix_n functions, the sums of a block stay in L1 */
+#define MIX_N_BLOCK	256
 
 enum {
 	FMT_S16,
@@ -46,6 +54,32 @@ struct spa_audiomixer_ops {
 	mix_i_func_t add_i[FMT_MAX];
 	mix_scale_i_func_t copy_scale_i[FMT_MAX];
 	mix_scale_i_func_t add_scale_i[FMT_MAX];
+	mix_n_func_t mix_n[FMT_MAX];
 };
 
+#define SPA_AUDIOMIXER_CPU_SSE2	SPA_CPU_FLAG_SSE2
+#define SPA_AUDIOMIXER_CPU_AVX2	SPA_CPU_FLAG_AVX2
+#define SPA_AUDIOMIXER_CPU_NEON	SPA_CPU_FLAG_NEON
+
+/** get the vector instruction sets of the CPU that have kernels */
+uint32_t spa_audiomixer_get_cpu_flags(void);
+
+/** get the scalar reference functions */
+void spa_audiomixer_get_ops_c(struct spa_audiomixer_ops *ops);
+
+#if defined (HAVE_SSE2)
+void spa_audiomixer_get_ops_sse2(struct spa_audiomixer_ops *ops);
+#endif
+#if defined (HAVE_AVX2)
+void spa_audiomixer_get_ops_avx2(struct spa_audiomixer_ops *ops);
+#endif
+#if defined (HAVE_NEON)
+void spa_audiomixer_get_ops_neon(struct spa_audiomixer_ops *ops);
+#endif
+
+/** get the fastest functions for the given cpu flags, the functions without
+ * a vector version are the scalar ones */
+void spa_audiomixer_get_ops_flags(struct spa_audiomixer_ops *ops, uint32_t cpu_flags);
+
+/** get the fastest functions for this CPU */
 void spa_audiomixer_get_ops(struct spa_audiomixer_ops *ops);
@@ -36,6 +36,7 @@
 #include <spa/param/meta.h>
 #include <spa/param/io.h>
 #include <spa/pod/filter.h>
+#include <spa/pod/template.h>
 
 #define NAME "audiotestsrc"
 
@@ -148,6 +149,7 @@ struct impl {
 	struct spa_loop *data_loop;
 
 	struct props props;
+	struct spa_pod_template props_template;
 
 	const struct spa_node_callbacks *callbacks;
 	void *callbacks_data;
@@ -261,12 +263,8 @@ static int impl_node_enum_params(struct spa_node *node,
 
 		switch (*index) {
 		case 0:
-			param = spa_pod_builder_object(&b,
-				id, t->props,
-				":", t->prop_live,   "b", p->live,
-				":", t->prop_wave,   "i", p->wave,
-				":", t->prop_freq,   "d", p->freq,
-				":", t->prop_volume, "d", p->volume);
+			param = spa_pod_template_build(&b, id, t->props,
+				&this->props_template, p);
 			break;
 		default:
 			return 0;
@@ -301,12 +299,7 @@ static int impl_node_set_param(struct spa_node *node, uint32_t id, uint32_t flag
 			reset_props(p);
 			return 0;
 		}
-		spa_pod_object_parse(param,
-			":",t->prop_live,   "?b", &p->live,
-			":",t->prop_wave,   "?i", &p->wave,
-			":",t->prop_freq,   "?d", &p->freq,
-			":",t->prop_volume, "?d", &p->volume,
-			NULL);
+		spa_pod_template_parse(&this->props_template, param, p);
 
 		if (p->live)
 			this->info.flags |= SPA_PORT_INFO_FLAG_LIVE;
@@ -1183,6 +1176,20 @@ impl_init(const struct spa_handle_factory *factory,
 	}
 	init_type(&this->type, this->map);
 
+	{
+		struct spa_pod_template_field fields[] = {
+			SPA_POD_TEMPLATE_FIELD(this->type.prop_live, SPA_POD_TYPE_BOOL,
+					       struct props, live),
+			SPA_POD_TEMPLATE_FIELD(this->type.prop_wave, SPA_POD_TYPE_INT,
+					       struct props, wave),
+			SPA_POD_TEMPLATE_FIELD(this->type.prop_freq, SPA_POD_TYPE_DOUBLE,
+					       struct props, freq),
+			SPA_POD_TEMPLATE_FIELD(this->type.prop_volume, SPA_POD_TYPE_DOUBLE,
+					       struct props, volume),
+		};
+		spa_pod_template_init(&this->props_template, fields, SPA_N_ELEMENTS(fields));
+	}
+
 	this->node = impl_node;
 	this->clock = impl_clock;
 	reset_props(&this->props);
@@ -27,6 +27,8 @@
 #include <sys/timerfd.h>
 #include <sys/eventfd.h>
 #include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 #include <pthread.h>
 
 #include <spa/support/loop.h>
@@ -34,23 +36,29 @@
 #include <spa/support/type-map.h>
 #include <spa/support/plugin.h>
 #include <spa/utils/list.h>
-#include <spa/utils/ringbuffer.h>
 
 #define NAME "loop"
 
 #define DATAS_SIZE (4096 * 8)
+#define ITEM_ALIGN 8
 
 /** \cond */
 
+/* completion of a blocking invoke, lives on the stack of the caller */
+struct invoke_token {
+	int res;
+	uint32_t done;
+};
+
 struct invoke_item {
 	size_t item_size;
 	spa_invoke_func_t func;
 	uint32_t seq;
+	uint32_t ready;			/* set when the producer wrote the item */
 	void *data;
 	size_t size;
-	bool block;
+	struct invoke_token *token;	/* NULL when not blocking */
 	void *user_data;
-	int res;
 };
 
 struct type {
@@ -86,10 +94,14 @@ struct impl {
 	pthread_t thread;
 
 	struct spa_source *wakeup;
-	int ack_fd;
 
-	struct spa_ringbuffer buffer;
-	uint8_t buffer_data[DATAS_SIZE];
+	/* the invoke queue, producers reserve space by moving write_index
+	 * and only the loop thread moves read_index. The unused part of
+	 * buffer_data is kept cleared so that an item is only seen when its
+	 * ready field is set. */
+	uint32_t write_index;
+	uint32_t read_index;
+	uint8_t buffer_data[DATAS_SIZE] __attribute__ ((aligned (ITEM_ALIGN)));
 };
 
 struct source_impl {
@@ -191,6 +203,63 @@ static void loop_remove_source(struct spa_source *source)
 	source->loop = NULL;
 }
 
+static inline void futex_wait(uint32_t *addr, uint32_t val)
+{
+	syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+}
+
+static inline void futex_wake(uint32_t *addr)
+{
+	syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+/* spa_hook_list_call() inserts a cursor in the list, that is not safe when
+ * several threads block in an invoke at the same time, walk the hooks
+ * without modifying the list */
+#define invoke_hooks(impl,method)						\
+({										\
+	struct spa_hook *h;							\
+	spa_list_for_each(h, &(impl)->hooks_list.list, link) {			\
+		const struct spa_loop_control_hooks *cb = h->funcs;		\
+		if (cb && cb->method)						\
+			cb->method(h->data);					\
+	}									\
+})
+
+/* reserve space for an item with size bytes of data. Sets the offset of the
+ * item and the data and returns the index of the item or -EPIPE when the
+ * queue is full */
+static int64_t reserve_item(struct impl *impl, size_t size, uint32_t *item_size,
+			    uint32_t *data_offset)
+{
+	uint32_t idx, offset, l0, need, filled;
+
+	idx = __atomic_load_n(&impl->write_index, __ATOMIC_RELAXED);
+	do {
+		filled = idx - __atomic_load_n(&impl->read_index, __ATOMIC_ACQUIRE);
+		offset = idx & (DATAS_SIZE - 1);
+		l0 = DATAS_SIZE - offset;
+		need = SPA_ROUND_UP_N(sizeof(struct invoke_item) + size, ITEM_ALIGN);
+
+		if (l0 >= need) {
+			*item_size = need;
+			*data_offset = offset + sizeof(struct invoke_item);
+			/* take the rest of the buffer when the next item doesn't fit */
+			if (l0 - need < sizeof(struct invoke_item))
+				*item_size = l0;
+		} else {
+			/* the data goes at the start of the buffer */
+			*item_size = l0 + SPA_ROUND_UP_N(size, ITEM_ALIGN);
+			*data_offset = 0;
+		}
+		if (filled + *item_size > DATAS_SIZE)
+			return -EPIPE;
+
+	} while (!__atomic_compare_exchange_n(&impl->write_index, &idx, idx + *item_size,
+					      true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+	return idx;
+}
+
 static int
 loop_invoke(struct spa_loop *loop,
 	    spa_invoke_func_t func,
@@ -208,57 +277,40 @@ loop_invoke(struct spa_loop *loop,
 	if (in_thread) {
 		res = func(loop, false, seq, data, size, user_data);
 	} else {
-		int32_t filled, avail;
-		uint32_t idx, offset, l0;
+		struct invoke_token token = { 0, 0 };
+		uint32_t item_size, data_offset;
+		int64_t idx;
 
-		filled = spa_ringbuffer_get_write_index(&impl->buffer, &idx);
-		if (filled < 0 || filled > DATAS_SIZE) {
-			spa_log_warn(impl->log, NAME " %p: queue xrun %d", impl, filled);
-			return -EPIPE;
-		}
-		avail = DATAS_SIZE - filled;
-		if (avail < sizeof(struct invoke_item)) {
-			spa_log_warn(impl->log, NAME " %p: queue full %d", impl, avail);
+		if ((idx = reserve_item(impl, size, &item_size, &data_offset)) < 0) {
+			spa_log_warn(impl->log, NAME " %p: queue full", impl);
 			return -EPIPE;
 		}
-		offset = idx & (DATAS_SIZE - 1);
-
-		l0 = DATAS_SIZE - offset;
 
-		item = SPA_MEMBER(impl->buffer_data, offset, struct invoke_item);
+		item = SPA_MEMBER(impl->buffer_data, idx & (DATAS_SIZE - 1), struct invoke_item);
+		item->item_size = item_size;
 		item->func = func;
 		item->seq = seq;
+		item->data = SPA_MEMBER(impl->buffer_data, data_offset, void);
 		item->size = size;
-		item->block = block;
+		item->token = block ? &token : NULL;
 		item->user_data = user_data;
+		if (size > 0)
+			memcpy(item->data, data, size);
 
-		if (l0 > sizeof(struct invoke_item) + size) {
-			item->data = SPA_MEMBER(item, sizeof(struct invoke_item), void);
-			item->item_size = sizeof(struct invoke_item) + size;
-			if (l0 < sizeof(struct invoke_item) + item->item_size)
-				item->item_size = l0;
-		} else {
-			item->data = impl->buffer_data;
-			item->item_size = l0 + size;
-		}
-		memcpy(item->data, data, size);
-
-		spa_ringbuffer_write_update(&impl->buffer, idx + item->item_size);
+		/* publish, the item is complete now */
+		__atomic_store_n(&item->ready, 1, __ATOMIC_RELEASE);
 
 		spa_loop_utils_signal_event(&impl->utils, impl->wakeup);
 
 		if (block) {
-			uint64_t count = 1;
+			invoke_hooks(impl, before);
 
-			spa_loop_control_hook_before(&impl->hooks_list);
+			while (__atomic_load_n(&token.done, __ATOMIC_ACQUIRE) == 0)
+				futex_wait(&token.done, 0);
 
-			if (read(impl->ack_fd, &count, sizeof(uint64_t)) != sizeof(uint64_t))
-				spa_log_warn(impl->log, NAME " %p: failed to read event fd: %s",
-						impl, strerror(errno));
+			invoke_hooks(impl, after);
 
-			spa_loop_control_hook_after(&impl->hooks_list);
-
-			res = item->res;
+			res = token.res;
 		}
 		else {
 			if (seq != SPA_ID_INVALID)
@@ -273,19 +325,42 @@ loop_invoke(struct spa_loop *loop,
 static void wakeup_func(void *data, uint64_t count)
 {
 	struct impl *impl = data;
-	uint32_t index;
-	while (spa_ringbuffer_get_read_index(&impl->buffer, &index) > 0) {
-		struct invoke_item *item =
-		    SPA_MEMBER(impl->buffer_data, index & (DATAS_SIZE - 1), struct invoke_item);
-		item->res = item->func(&impl->loop, true, item->seq, item->data, item->size,
+	uint32_t index, offset, item_size, l0;
+
+	while (true) {
+		struct invoke_item *item;
+		struct invoke_token *token;
+		int res;
+
+		index = impl->read_index;
+		if (index == __atomic_load_n(&impl->write_index, __ATOMIC_ACQUIRE))
+			break;
+
+		offset = index & (DATAS_SIZE - 1);
+		item = SPA_MEMBER(impl->buffer_data, offset, struct invoke_item);
+
+		/* reserved but not written yet, the producer will signal
+		 * the wakeup again when it is done */
+		if (__atomic_load_n(&item->ready, __ATOMIC_ACQUIRE) == 0)
+			break;
+
+		res = item->func(&impl->loop, true, item->seq, item->data, item->size,
 			   item->user_data);
-		spa_ringbuffer_read_update(&impl->buffer, index + item->item_size);
 
-		if (item->block) {
-			uint64_t count = 1;
-			if (write(impl->ack_fd, &count, sizeof(uint64_t)) != sizeof(uint64_t))
-				spa_log_warn(impl->log, NAME " %p: failed to write event fd: %s",
-						impl, strerror(errno));
+		token = item->token;
+		item_size = item->item_size;
+
+		l0 = SPA_MIN(item_size, DATAS_SIZE - offset);
+		memset(item, 0, l0);
+		if (item_size > l0)
+			memset(impl->buffer_data, 0, item_size - l0);
+
+		__atomic_store_n(&impl->read_index, index + item_size, __ATOMIC_RELEASE);
+
+		if (token) {
+			token->res = res;
+			__atomic_store_n(&token->done, 1, __ATOMIC_RELEASE);
+			futex_wake(&token->done);
 		}
 	}
 }
@@ -697,7 +772,6 @@ static int impl_clear(struct spa_handle *handle)
 
 	process_destroy(impl);
 
-	close(impl->ack_fd);
 	close(impl->epoll_fd);
 
 	return 0;
@@ -744,10 +818,10 @@ impl_init(const struct spa_handle_factory *factory,
 	spa_list_init(&impl->destroy_list);
 	spa_hook_list_init(&impl->hooks_list);
 
-	spa_ringbuffer_init(&impl->buffer);
+	impl->write_index = impl->read_index = 0;
+	memset(impl->buffer_data, 0, DATAS_SIZE);
 
 	impl->wakeup = spa_loop_utils_add_event(&impl->utils, wakeup_func, impl);
-	impl->ack_fd = eventfd(0, EFD_SEMAPHORE | EFD_CLOEXEC);
 
 	spa_log_debug(impl->log, NAME " %p: initialized", impl);
 
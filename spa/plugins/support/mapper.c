@@ -18,6 +18,7 @@
  */
 
 #include <stddef.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
@@ -44,14 +45,33 @@ struct array {
 	void *data;
 };
 
+/* strings are stored in chunks that are never moved, the pointers returned
+ * by get_type stay valid */
+#define CHUNK_SIZE	4096
+
+struct chunk {
+	struct chunk *next;
+	size_t size;
+	size_t maxsize;
+	char data[0];
+};
+
+struct entry {
+	const char *type;
+	uint32_t hash;
+};
+
 struct impl {
 	struct spa_handle handle;
 	struct spa_type_map map;
 
 	struct type type;
 
-	struct array types;
-	struct array strings;
+	struct array types;	/* struct entry, indexed by id */
+	struct chunk *chunks;
+
+	uint32_t *index;	/* open addressing hash table of id + 1, 0 is free */
+	uint32_t index_mask;
 };
 
 static inline void * alloc_size(struct array *array, size_t size, size_t extend)
@@ -66,32 +86,107 @@ static inline void * alloc_size(struct array *array, size_t size, size_t extend)
 	return res;
 }
 
+static const char *intern_string(struct impl *impl, const char *type, size_t len)
+{
+	struct chunk *c = impl->chunks;
+	char *p;
+
+	if (c == NULL || c->size + len + 1 > c->maxsize) {
+		size_t maxsize = SPA_MAX(CHUNK_SIZE, len + 1);
+
+		if ((c = malloc(sizeof(struct chunk) + maxsize)) == NULL)
+			return NULL;
+		c->next = impl->chunks;
+		c->size = 0;
+		c->maxsize = maxsize;
+		impl->chunks = c;
+	}
+	p = &c->data[c->size];
+	memcpy(p, type, len + 1);
+	c->size += len + 1;
+
+	return p;
+}
+
+/* FNV-1a, also returns the length of the string */
+static inline uint32_t hash_string(const char *type, size_t *len)
+{
+	const char *p;
+	uint32_t hash = 2166136261u;
+
+	for (p = type; *p; p++)
+		hash = (hash ^ (uint8_t) *p) * 16777619u;
+	*len = p - type;
+
+	return hash;
+}
+
+static int grow_index(struct impl *impl)
+{
+	uint32_t i, j, size = (impl->index_mask + 1) * 2, n_types;
+	struct entry *entries = impl->types.data;
+	uint32_t *index;
+
+	if (size < 256)
+		size = 256;
+	if ((index = calloc(size, sizeof(uint32_t))) == NULL)
+		return -ENOMEM;
+
+	n_types = impl->types.size / sizeof(struct entry);
+	for (i = 0; i < n_types; i++) {
+		for (j = entries[i].hash & (size - 1); index[j]; j = (j + 1) & (size - 1));
+		index[j] = i + 1;
+	}
+	free(impl->index);
+	impl->index = index;
+	impl->index_mask = size - 1;
+
+	return 0;
+}
+
 static uint32_t
 impl_type_map_get_id(struct spa_type_map *map, const char *type)
 {
 	struct impl *impl = SPA_CONTAINER_OF(map, struct impl, map);
-	uint32_t i, len;
-	void *p;
-	off_t o, *off;
+	struct entry *e;
+	uint32_t i, id, hash;
+	size_t len;
 
 	if (type == NULL)
 		return SPA_ID_INVALID;
 
-	for (i = 0; i < impl->types.size / sizeof(off_t); i++) {
-		o = ((off_t *)impl->types.data)[i];
-		if (strcmp(SPA_MEMBER(impl->strings.data, o, char), type) == 0)
-			return i;
+	hash = hash_string(type, &len);
+
+	if (impl->index != NULL) {
+		struct entry *entries = impl->types.data;
+
+		for (i = hash & impl->index_mask; (id = impl->index[i]) != 0;
+		     i = (i + 1) & impl->index_mask) {
+			e = &entries[id - 1];
+			if (e->hash == hash && strcmp(e->type, type) == 0)
+				return id - 1;
+		}
+	}
+
+	id = impl->types.size / sizeof(struct entry);
+
+	/* keep the table at most half full */
+	if (impl->index == NULL || (id + 1) * 2 > impl->index_mask + 1) {
+		if (grow_index(impl) < 0)
+			return SPA_ID_INVALID;
 	}
-	len = strlen(type);
-	p = alloc_size(&impl->strings, len+1, 1024);
-	memcpy(p, type, len + 1);
 
-	off = alloc_size(&impl->types, sizeof(off_t), 128);
-	*off = SPA_PTRDIFF(p, impl->strings.data);
-	i = SPA_PTRDIFF(off, impl->types.data) / sizeof(off_t);
+	e = alloc_size(&impl->types, sizeof(struct entry), 128 * sizeof(struct entry));
+	if ((e->type = intern_string(impl, type, len)) == NULL) {
+		impl->types.size -= sizeof(struct entry);
+		return SPA_ID_INVALID;
+	}
+	e->hash = hash;
 
-	return i;
+	for (i = hash & impl->index_mask; impl->index[i]; i = (i + 1) & impl->index_mask);
+	impl->index[i] = id + 1;
 
+	return id;
 }
 
 static const char *
@@ -99,10 +194,8 @@ impl_type_map_get_type(const struct spa_type_map *map, uint32_t id)
 {
 	struct impl *impl = SPA_CONTAINER_OF(map, struct impl, map);
 
-	if (id < impl->types.size / sizeof(off_t)) {
-		off_t o = ((off_t *)impl->types.data)[id];
-		return SPA_MEMBER(impl->strings.data, o, char);
-	}
+	if (id < impl->types.size / sizeof(struct entry))
+		return ((struct entry *)impl->types.data)[id].type;
 	return NULL;
 }
 
@@ -110,7 +203,7 @@ static size_t
 impl_type_map_get_size(const struct spa_type_map *map)
 {
 	struct impl *impl = SPA_CONTAINER_OF(map, struct impl, map);
-	return impl->types.size / sizeof(off_t);
+	return impl->types.size / sizeof(struct entry);
 }
 
 static const struct spa_type_map impl_type_map = {
@@ -148,8 +241,12 @@ static int impl_clear(struct spa_handle *handle)
 
 	if (impl->types.data)
 		free(impl->types.data);
-	if (impl->strings.data)
-		free(impl->strings.data);
+	free(impl->index);
+	while (impl->chunks) {
+		struct chunk *c = impl->chunks;
+		impl->chunks = c->next;
+		free(c);
+	}
 
 	return 0;
 }
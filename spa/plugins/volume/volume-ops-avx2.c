@@ -0,0 +1,111 @@
+/* Spa
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include <math.h>
+
+#include <immintrin.h>
+
+#include "volume-ops.h"
+
+/* The results are the same as the scalar versions in volume-ops.c: the
+ * values are clamped before the conversion, which rounds to nearest like
+ * lrintf() and lrint(). */
+
+static void
+apply_s16_avx2(void *dst, const void *src, const float *gain, int n_samples)
+{
+	const int16_t *s = src;
+	int16_t *d = dst;
+	const __m256 min = _mm256_set1_ps(INT16_MIN), max = _mm256_set1_ps(INT16_MAX);
+	__m256 flo, fhi;
+	__m256i out;
+	float t;
+	int n;
+
+	for (n = 0; n + 16 <= n_samples; n += 16) {
+		flo = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(
+				_mm_loadu_si128((const __m128i *) &s[n])));
+		fhi = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(
+				_mm_loadu_si128((const __m128i *) &s[n + 8])));
+		flo = _mm256_mul_ps(flo, _mm256_loadu_ps(&gain[n]));
+		fhi = _mm256_mul_ps(fhi, _mm256_loadu_ps(&gain[n + 8]));
+		flo = _mm256_min_ps(_mm256_max_ps(flo, min), max);
+		fhi = _mm256_min_ps(_mm256_max_ps(fhi, min), max);
+		out = _mm256_packs_epi32(_mm256_cvtps_epi32(flo), _mm256_cvtps_epi32(fhi));
+		/* the pack works per 128 bits lane, put the samples back in order */
+		_mm256_storeu_si256((__m256i *) &d[n], _mm256_permute4x64_epi64(out, 0xd8));
+	}
+	for (; n < n_samples; n++) {
+		t = s[n] * gain[n];
+		t = SPA_CLAMP(t, (float) INT16_MIN, (float) INT16_MAX);
+		d[n] = lrintf(t);
+	}
+}
+
+static void
+apply_s32_avx2(void *dst, const void *src, const float *gain, int n_samples)
+{
+	const int32_t *s = src;
+	int32_t *d = dst;
+	const __m256d min = _mm256_set1_pd(INT32_MIN), max = _mm256_set1_pd(INT32_MAX);
+	__m256d lo, hi;
+	double t;
+	int n;
+
+	for (n = 0; n + 8 <= n_samples; n += 8) {
+		lo = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *) &s[n]));
+		hi = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *) &s[n + 4]));
+		lo = _mm256_mul_pd(lo, _mm256_cvtps_pd(_mm_loadu_ps(&gain[n])));
+		hi = _mm256_mul_pd(hi, _mm256_cvtps_pd(_mm_loadu_ps(&gain[n + 4])));
+		lo = _mm256_min_pd(_mm256_max_pd(lo, min), max);
+		hi = _mm256_min_pd(_mm256_max_pd(hi, min), max);
+		_mm_storeu_si128((__m128i *) &d[n], _mm256_cvtpd_epi32(lo));
+		_mm_storeu_si128((__m128i *) &d[n + 4], _mm256_cvtpd_epi32(hi));
+	}
+	for (; n < n_samples; n++) {
+		t = s[n] * (double) gain[n];
+		t = SPA_CLAMP(t, (double) INT32_MIN, (double) INT32_MAX);
+		d[n] = lrint(t);
+	}
+}
+
+static void
+apply_f32_avx2(void *dst, const void *src, const float *gain, int n_samples)
+{
+	const float *s = src;
+	float *d = dst;
+	int n;
+
+	for (n = 0; n + 16 <= n_samples; n += 16) {
+		_mm256_storeu_ps(&d[n], _mm256_mul_ps(_mm256_loadu_ps(&s[n]),
+						      _mm256_loadu_ps(&gain[n])));
+		_mm256_storeu_ps(&d[n + 8], _mm256_mul_ps(_mm256_loadu_ps(&s[n + 8]),
+							  _mm256_loadu_ps(&gain[n + 8])));
+	}
+	for (; n < n_samples; n++)
+		d[n] = s[n] * gain[n];
+}
+
+void spa_volume_get_ops_avx2(struct spa_volume_ops *ops)
+{
+	ops->apply[VOLUME_FMT_S16] = apply_s16_avx2;
+	ops->apply[VOLUME_FMT_S32] = apply_s32_avx2;
+	ops->apply[VOLUME_FMT_F32] = apply_f32_avx2;
+}
@@ -0,0 +1,115 @@
+/* Spa
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include <math.h>
+
+#include <arm_neon.h>
+
+#include "volume-ops.h"
+
+/* The results are the same as the scalar versions in volume-ops.c. The
+ * integer formats need the round to nearest conversion and double vectors
+ * of aarch64, 32 bits ARM only has the float version. */
+
+#if defined (__aarch64__)
+static void
+apply_s16_neon(void *dst, const void *src, const float *gain, int n_samples)
+{
+	const int16_t *s = src;
+	int16_t *d = dst;
+	const float32x4_t min = vdupq_n_f32(INT16_MIN), max = vdupq_n_f32(INT16_MAX);
+	float32x4_t flo, fhi;
+	int16x8_t in;
+	float t;
+	int n;
+
+	for (n = 0; n + 8 <= n_samples; n += 8) {
+		in = vld1q_s16(&s[n]);
+		flo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(in)));
+		fhi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(in)));
+		flo = vmulq_f32(flo, vld1q_f32(&gain[n]));
+		fhi = vmulq_f32(fhi, vld1q_f32(&gain[n + 4]));
+		flo = vminq_f32(vmaxq_f32(flo, min), max);
+		fhi = vminq_f32(vmaxq_f32(fhi, min), max);
+		vst1q_s16(&d[n], vcombine_s16(vmovn_s32(vcvtnq_s32_f32(flo)),
+					      vmovn_s32(vcvtnq_s32_f32(fhi))));
+	}
+	for (; n < n_samples; n++) {
+		t = s[n] * gain[n];
+		t = SPA_CLAMP(t, (float) INT16_MIN, (float) INT16_MAX);
+		d[n] = lrintf(t);
+	}
+}
+
+static void
+apply_s32_neon(void *dst, const void *src, const float *gain, int n_samples)
+{
+	const int32_t *s = src;
+	int32_t *d = dst;
+	const float64x2_t min = vdupq_n_f64(INT32_MIN), max = vdupq_n_f64(INT32_MAX);
+	float64x2_t lo, hi;
+	int32x4_t in;
+	float32x4_t g;
+	double t;
+	int n;
+
+	for (n = 0; n + 4 <= n_samples; n += 4) {
+		in = vld1q_s32(&s[n]);
+		g = vld1q_f32(&gain[n]);
+		lo = vcvtq_f64_s64(vmovl_s32(vget_low_s32(in)));
+		hi = vcvtq_f64_s64(vmovl_s32(vget_high_s32(in)));
+		lo = vmulq_f64(lo, vcvt_f64_f32(vget_low_f32(g)));
+		hi = vmulq_f64(hi, vcvt_f64_f32(vget_high_f32(g)));
+		lo = vminq_f64(vmaxq_f64(lo, min), max);
+		hi = vminq_f64(vmaxq_f64(hi, min), max);
+		vst1q_s32(&d[n], vcombine_s32(vmovn_s64(vcvtnq_s64_f64(lo)),
+					      vmovn_s64(vcvtnq_s64_f64(hi))));
+	}
+	for (; n < n_samples; n++) {
+		t = s[n] * (double) gain[n];
+		t = SPA_CLAMP(t, (double) INT32_MIN, (double) INT32_MAX);
+		d[n] = lrint(t);
+	}
+}
+#endif
+
+static void
+apply_f32_neon(void *dst, const void *src, const float *gain, int n_samples)
+{
+	const float *s = src;
+	float *d = dst;
+	int n;
+
+	for (n = 0; n + 8 <= n_samples; n += 8) {
+		vst1q_f32(&d[n], vmulq_f32(vld1q_f32(&s[n]), vld1q_f32(&gain[n])));
+		vst1q_f32(&d[n + 4], vmulq_f32(vld1q_f32(&s[n + 4]), vld1q_f32(&gain[n + 4])));
+	}
+	for (; n < n_samples; n++)
+		d[n] = s[n] * gain[n];
+}
+
+void spa_volume_get_ops_neon(struct spa_volume_ops *ops)
+{
+#if defined (__aarch64__)
+	ops->apply[VOLUME_FMT_S16] = apply_s16_neon;
+	ops->apply[VOLUME_FMT_S32] = apply_s32_neon;
+#endif
+	ops->apply[VOLUME_FMT_F32] = apply_f32_neon;
+}
@@ -0,0 +1,110 @@
+/* Spa
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include <math.h>
+
+#include <emmintrin.h>
+
+#include "volume-ops.h"
+
+/* The results are the same as the scalar versions in volume-ops.c: the
+ * values are clamped before the conversion, which rounds to nearest like
+ * lrintf() and lrint(). */
+
+static void
+apply_s16_sse2(void *dst, const void *src, const float *gain, int n_samples)
+{
+	const int16_t *s = src;
+	int16_t *d = dst;
+	const __m128 min = _mm_set1_ps(INT16_MIN), max = _mm_set1_ps(INT16_MAX);
+	__m128i in, lo, hi;
+	__m128 flo, fhi;
+	float t;
+	int n;
+
+	for (n = 0; n + 8 <= n_samples; n += 8) {
+		in = _mm_loadu_si128((const __m128i *) &s[n]);
+		lo = _mm_srai_epi32(_mm_unpacklo_epi16(in, in), 16);
+		hi = _mm_srai_epi32(_mm_unpackhi_epi16(in, in), 16);
+		flo = _mm_mul_ps(_mm_cvtepi32_ps(lo), _mm_loadu_ps(&gain[n]));
+		fhi = _mm_mul_ps(_mm_cvtepi32_ps(hi), _mm_loadu_ps(&gain[n + 4]));
+		flo = _mm_min_ps(_mm_max_ps(flo, min), max);
+		fhi = _mm_min_ps(_mm_max_ps(fhi, min), max);
+		_mm_storeu_si128((__m128i *) &d[n],
+				_mm_packs_epi32(_mm_cvtps_epi32(flo), _mm_cvtps_epi32(fhi)));
+	}
+	for (; n < n_samples; n++) {
+		t = s[n] * gain[n];
+		t = SPA_CLAMP(t, (float) INT16_MIN, (float) INT16_MAX);
+		d[n] = lrintf(t);
+	}
+}
+
+static void
+apply_s32_sse2(void *dst, const void *src, const float *gain, int n_samples)
+{
+	const int32_t *s = src;
+	int32_t *d = dst;
+	const __m128d min = _mm_set1_pd(INT32_MIN), max = _mm_set1_pd(INT32_MAX);
+	__m128i in;
+	__m128d lo, hi;
+	__m128 g;
+	double t;
+	int n;
+
+	for (n = 0; n + 4 <= n_samples; n += 4) {
+		in = _mm_loadu_si128((const __m128i *) &s[n]);
+		g = _mm_loadu_ps(&gain[n]);
+		lo = _mm_mul_pd(_mm_cvtepi32_pd(in), _mm_cvtps_pd(g));
+		hi = _mm_mul_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(in, in)),
+				_mm_cvtps_pd(_mm_movehl_ps(g, g)));
+		lo = _mm_min_pd(_mm_max_pd(lo, min), max);
+		hi = _mm_min_pd(_mm_max_pd(hi, min), max);
+		_mm_storeu_si128((__m128i *) &d[n],
+				_mm_unpacklo_epi64(_mm_cvtpd_epi32(lo), _mm_cvtpd_epi32(hi)));
+	}
+	for (; n < n_samples; n++) {
+		t = s[n] * (double) gain[n];
+		t = SPA_CLAMP(t, (double) INT32_MIN, (double) INT32_MAX);
+		d[n] = lrint(t);
+	}
+}
+
+static void
+apply_f32_sse2(void *dst, const void *src, const float *gain, int n_samples)
+{
+	const float *s = src;
+	float *d = dst;
+	int n;
+
+	for (n = 0; n + 8 <= n_samples; n += 8) {
+		_mm_storeu_ps(&d[n], _mm_mul_ps(_mm_loadu_ps(&s[n]), _mm_loadu_ps(&gain[n])));
+		_mm_storeu_ps(&d[n + 4], _mm_mul_ps(_mm_loadu_ps(&s[n + 4]), _mm_loadu_ps(&gain[n + 4])));
+	}
+	for (; n < n_samples; n++)
+		d[n] = s[n] * gain[n];
+}
+
+void spa_volume_get_ops_sse2(struct spa_volume_ops *ops)
+{
+	ops->apply[VOLUME_FMT_S16] = apply_s16_sse2;
+	ops->apply[VOLUME_FMT_S32] = apply_s32_sse2;
+	ops->apply[VOLUME_FMT_F32] = apply_f32_sse2;
+}
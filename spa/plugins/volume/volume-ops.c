@@ -0,0 +1,95 @@
+/* Spa
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include <math.h>
+
+#include "volume-ops.h"
+
+static void
+apply_s16(void *dst, const void *src, const float *gain, int n_samples)
+{
+	const int16_t *s = src;
+	int16_t *d = dst;
+	float t;
+	int n;
+
+	for (n = 0; n < n_samples; n++) {
+		t = s[n] * gain[n];
+		t = SPA_CLAMP(t, (float) INT16_MIN, (float) INT16_MAX);
+		d[n] = lrintf(t);
+	}
+}
+
+static void
+apply_s32(void *dst, const void *src, const float *gain, int n_samples)
+{
+	const int32_t *s = src;
+	int32_t *d = dst;
+	double t;
+	int n;
+
+	/* float can not hold all 32 bits values, use double */
+	for (n = 0; n < n_samples; n++) {
+		t = s[n] * (double) gain[n];
+		t = SPA_CLAMP(t, (double) INT32_MIN, (double) INT32_MAX);
+		d[n] = lrint(t);
+	}
+}
+
+static void
+apply_f32(void *dst, const void *src, const float *gain, int n_samples)
+{
+	const float *s = src;
+	float *d = dst;
+	int n;
+
+	for (n = 0; n < n_samples; n++)
+		d[n] = s[n] * gain[n];
+}
+
+void spa_volume_get_ops_c(struct spa_volume_ops *ops)
+{
+	ops->apply[VOLUME_FMT_S16] = apply_s16;
+	ops->apply[VOLUME_FMT_S32] = apply_s32;
+	ops->apply[VOLUME_FMT_F32] = apply_f32;
+}
+
+void spa_volume_get_ops_flags(struct spa_volume_ops *ops, uint32_t cpu_flags)
+{
+	spa_volume_get_ops_c(ops);
+
+#if defined (HAVE_SSE2)
+	if (cpu_flags & SPA_CPU_FLAG_SSE2)
+		spa_volume_get_ops_sse2(ops);
+#endif
+#if defined (HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2)
+		spa_volume_get_ops_avx2(ops);
+#endif
+#if defined (HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON)
+		spa_volume_get_ops_neon(ops);
+#endif
+}
+
+void spa_volume_get_ops(struct spa_volume_ops *ops)
+{
+	spa_volume_get_ops_flags(ops, spa_cpu_get_flags());
+}
@@ -0,0 +1,61 @@
+/* Spa
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include <string.h>
+#include <stdio.h>
+
+#include <spa/utils/defs.h>
+#include <spa/utils/cpu.h>
+
+/* dst[i] = src[i] * gain[i] for n_samples samples. The gains are expanded
+ * per sample so that per channel gains and ramps use the same functions.
+ * Integer formats are rounded to the nearest value and saturated. dst
+ * can be the same as src. */
+typedef void (*volume_func_t) (void *dst, const void *src, const float *gain, int n_samples);
+
+enum {
+	VOLUME_FMT_S16,
+	VOLUME_FMT_S32,
+	VOLUME_FMT_F32,
+	VOLUME_FMT_MAX,
+};
+
+struct spa_volume_ops {
+	volume_func_t apply[VOLUME_FMT_MAX];
+};
+
+/** get the scalar reference functions */
+void spa_volume_get_ops_c(struct spa_volume_ops *ops);
+
+#if defined (HAVE_SSE2)
+void spa_volume_get_ops_sse2(struct spa_volume_ops *ops);
+#endif
+#if defined (HAVE_AVX2)
+void spa_volume_get_ops_avx2(struct spa_volume_ops *ops);
+#endif
+#if defined (HAVE_NEON)
+void spa_volume_get_ops_neon(struct spa_volume_ops *ops);
+#endif
+
+/** get the functions for the given SPA_CPU_FLAG_* */
+void spa_volume_get_ops_flags(struct spa_volume_ops *ops, uint32_t cpu_flags);
+
+/** get the best functions for this CPU */
+void spa_volume_get_ops(struct spa_volume_ops *ops);
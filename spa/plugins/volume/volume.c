@@ -31,21 +31,31 @@
 #include <spa/param/meta.h>
 #include <spa/param/io.h>
 #include <spa/pod/filter.h>
+#include <spa/pod/template.h>
+
+#include "volume-ops.h"
 
 #define NAME "volume"
 
 #define DEFAULT_VOLUME 1.0
 #define DEFAULT_MUTE false
 
+#define MAX_CHANNELS	64
+/* samples in the gain block, the gains are expanded per sample */
+#define MAX_GAINS	4096
+
 struct props {
 	double volume;
 	bool mute;
+	uint32_t n_channel_volumes;
+	float channel_volumes[MAX_CHANNELS];
 };
 
 static void reset_props(struct props *props)
 {
 	props->volume = DEFAULT_VOLUME;
 	props->mute = DEFAULT_MUTE;
+	props->n_channel_volumes = 0;
 }
 
 #define MAX_BUFFERS     16
@@ -78,6 +88,7 @@ struct type {
 	uint32_t props;
 	uint32_t prop_volume;
 	uint32_t prop_mute;
+	uint32_t prop_channel_volumes;
 	struct spa_type_io io;
 	struct spa_type_param param;
 	struct spa_type_meta meta;
@@ -100,6 +111,7 @@ static inline void init_type(struct type *type, struct spa_type_map *map)
 	type->props = spa_type_map_get_id(map, SPA_TYPE__Props);
 	type->prop_volume = spa_type_map_get_id(map, SPA_TYPE_PROPS__volume);
 	type->prop_mute = spa_type_map_get_id(map, SPA_TYPE_PROPS__mute);
+	type->prop_channel_volumes = spa_type_map_get_id(map, SPA_TYPE_PROPS__channelVolumes);
 	spa_type_io_map(map, &type->io);
 	spa_type_param_map(map, &type->param);
 	spa_type_meta_map(map, &type->meta);
@@ -124,12 +136,21 @@ struct impl {
 	struct spa_log *log;
 
 	struct props props;
+	struct spa_pod_template props_template;	/* volume and mute of the props */
 
 	const struct spa_node_callbacks *callbacks;
 	void *callbacks_data;
 
+	struct spa_volume_ops ops;
+
 	struct spa_audio_info current_format;
 	int bpf;
+	uint32_t n_channels;
+	volume_func_t apply;
+
+	float gain[MAX_CHANNELS];	/* gain of the last processed frame */
+	float gains[MAX_GAINS];		/* gain per sample of a block */
+	bool gains_valid;		/* gains has the current gain in all frames */
 
 	struct port in_ports[1];
 	struct port out_ports[1];
@@ -195,6 +216,14 @@ static int impl_node_enum_params(struct spa_node *node,
 				":", t->param.propName, "s", "Mute",
 				":", t->param.propType, "b", p->mute);
 			break;
+		case 2:
+			param = spa_pod_builder_object(&b,
+				id, t->param.PropInfo,
+				":", t->param.propId,   "I", t->prop_channel_volumes,
+				":", t->param.propName, "s", "The volume of each channel",
+				":", t->param.propType, "a", sizeof(float), SPA_POD_TYPE_FLOAT,
+					p->n_channel_volumes, p->channel_volumes);
+			break;
 		default:
 			return 0;
 		}
@@ -202,10 +231,12 @@ static int impl_node_enum_params(struct spa_node *node,
 	else if (id == t->param.idProps) {
 		switch (*index) {
 		case 0:
-			param = spa_pod_builder_object(&b,
-				id, t->props,
-				":", t->prop_volume, "d", p->volume,
-				":", t->prop_mute,   "b", p->mute);
+			spa_pod_builder_push_object(&b, id, t->props);
+			spa_pod_template_write(&b, &this->props_template, p);
+			spa_pod_builder_add(&b,
+				":", t->prop_channel_volumes, "a", sizeof(float), SPA_POD_TYPE_FLOAT,
+					p->n_channel_volumes, p->channel_volumes, NULL);
+			param = spa_pod_builder_pop(&b);
 			break;
 		default:
 			return 0;
@@ -235,14 +266,30 @@ static int impl_node_set_param(struct spa_node *node, uint32_t id, uint32_t flag
 
 	if (id == t->param.idProps) {
 		struct props *p = &this->props;
+		struct spa_pod *volumes = NULL;
 
 		if (param == NULL) {
 			reset_props(p);
 			return 0;
 		}
+		spa_pod_template_parse(&this->props_template, param, p);
 		spa_pod_object_parse(param,
-			":", t->prop_volume, "?d", &p->volume,
-			":", t->prop_mute,   "?b", &p->mute, NULL);
+			":", t->prop_channel_volumes, "?P", &volumes, NULL);
+
+		if (volumes != NULL) {
+			struct spa_pod_array *arr = (struct spa_pod_array *) volumes;
+
+			if (SPA_POD_TYPE(volumes) != SPA_POD_TYPE_ARRAY ||
+			    arr->body.child.type != SPA_POD_TYPE_FLOAT ||
+			    arr->body.child.size != sizeof(float))
+				return -EINVAL;
+
+			p->n_channel_volumes = SPA_MIN(MAX_CHANNELS,
+				(SPA_POD_BODY_SIZE(volumes) - sizeof(struct spa_pod_array_body)) /
+				sizeof(float));
+			memcpy(p->channel_volumes, SPA_MEMBER(arr, sizeof(struct spa_pod_array), void),
+			       p->n_channel_volumes * sizeof(float));
+		}
 	}
 	else
 		return -ENOENT;
@@ -374,9 +421,10 @@ static int port_enum_formats(struct spa_node *node,
 			t->param.idEnumFormat, t->format,
 			"I", t->media_type.audio,
 			"I", t->media_subtype.raw,
-			":", t->format_audio.format,  "Ieu", t->audio_format.S16,
-				SPA_POD_PROP_ENUM(2, t->audio_format.S16,
-						     t->audio_format.S32),
+			":", t->format_audio.format,  "Ieu", t->audio_format.F32,
+				SPA_POD_PROP_ENUM(3, t->audio_format.F32,
+						     t->audio_format.S32,
+						     t->audio_format.S16),
 			":", t->format_audio.rate,    "iru", 44100,
 				SPA_POD_PROP_MIN_MAX(1, INT32_MAX),
 			":", t->format_audio.channels,"iru", 2,
@@ -541,6 +589,19 @@ static int clear_buffers(struct impl *this, struct port *port)
 	return 0;
 }
 
+/* the gain of each channel from the properties */
+static void get_gain(struct impl *this, float *gain)
+{
+	struct props *p = &this->props;
+	uint32_t c;
+
+	for (c = 0; c < this->n_channels; c++) {
+		gain[c] = p->mute ? 0.0f : p->volume;
+		if (c < p->n_channel_volumes)
+			gain[c] *= p->channel_volumes[c];
+	}
+}
+
 static int port_set_format(struct spa_node *node,
 			   enum spa_direction direction, uint32_t port_id,
 			   uint32_t flags,
@@ -568,9 +629,31 @@ static int port_set_format(struct spa_node *node,
 		if (spa_format_audio_raw_parse(format, &info.info.raw, &this->type.format_audio) < 0)
 			return -EINVAL;
 
-		this->bpf = 2 * info.info.raw.channels;
+		if (info.info.raw.channels == 0 || info.info.raw.channels > MAX_CHANNELS)
+			return -EINVAL;
+
+		if (info.info.raw.format == this->type.audio_format.S16) {
+			this->apply = this->ops.apply[VOLUME_FMT_S16];
+			this->bpf = sizeof(int16_t) * info.info.raw.channels;
+		}
+		else if (info.info.raw.format == this->type.audio_format.S32) {
+			this->apply = this->ops.apply[VOLUME_FMT_S32];
+			this->bpf = sizeof(int32_t) * info.info.raw.channels;
+		}
+		else if (info.info.raw.format == this->type.audio_format.F32) {
+			this->apply = this->ops.apply[VOLUME_FMT_F32];
+			this->bpf = sizeof(float) * info.info.raw.channels;
+		}
+		else
+			return -EINVAL;
+
+		this->n_channels = info.info.raw.channels;
 		this->current_format = info;
 		port->have_format = true;
+
+		/* start at the configured gain, don't ramp from silence */
+		get_gain(this, this->gain);
+		this->gains_valid = false;
 	}
 
 	return 0;
@@ -754,14 +837,14 @@ static struct spa_buffer *find_free_buffer(struct impl *this, struct port *port)
 
 static void do_volume(struct impl *this, struct spa_buffer *dbuf, struct spa_buffer *sbuf)
 {
-	uint32_t i, n_samples, n_bytes;
+	uint32_t c, f, n_bytes, n_frames, max_frames, total_frames, frame;
 	struct spa_data *sd, *dd;
-	int16_t *src, *dst;
-	double volume;
+	void *src, *dst;
 	uint32_t written, towrite, savail, davail;
 	uint32_t sindex, dindex;
-
-	volume = this->props.volume;
+	uint32_t n_channels = this->n_channels;
+	float target[MAX_CHANNELS], delta[MAX_CHANNELS];
+	bool ramp = false, unity = true;
 
 	sd = sbuf->datas;
 	dd = dbuf->datas;
@@ -773,26 +856,66 @@ static void do_volume(struct impl *this, struct spa_buffer *dbuf, struct spa_buf
 	davail = dd[0].maxsize - davail;
 
 	towrite = SPA_MIN(savail, davail);
+	towrite -= towrite % this->bpf;
 	written = 0;
 
-	while (written < towrite) {
+	total_frames = towrite / this->bpf;
+	max_frames = MAX_GAINS / n_channels;
+
+	/* a gain change is ramped linearly over this buffer */
+	get_gain(this, target);
+	for (c = 0; c < n_channels; c++) {
+		if (target[c] != this->gain[c])
+			ramp = true;
+		if (target[c] != 1.0f)
+			unity = false;
+	}
+	if (ramp && total_frames > 0) {
+		for (c = 0; c < n_channels; c++)
+			delta[c] = (target[c] - this->gain[c]) / total_frames;
+		this->gains_valid = false;
+	} else
+		ramp = false;
+
+	for (frame = 0; written < towrite; frame += n_frames) {
 		uint32_t soffset = sindex % sd[0].maxsize;
 		uint32_t doffset = dindex % dd[0].maxsize;
 
-		src = SPA_MEMBER(sd[0].data, soffset, int16_t);
-		dst = SPA_MEMBER(dd[0].data, doffset, int16_t);
+		src = SPA_MEMBER(sd[0].data, soffset, void);
+		dst = SPA_MEMBER(dd[0].data, doffset, void);
 
-		n_bytes = SPA_MIN(towrite, sd[0].maxsize - soffset);
+		n_bytes = SPA_MIN(towrite - written, sd[0].maxsize - soffset);
 		n_bytes = SPA_MIN(n_bytes, dd[0].maxsize - doffset);
+		n_frames = SPA_MIN(n_bytes / this->bpf, max_frames);
+		if (n_frames == 0)
+			break;
+		n_bytes = n_frames * this->bpf;
 
-		n_samples = n_bytes / sizeof(int16_t);
-		for (i = 0; i < n_samples; i++)
-			dst[i] = src[i] * volume;
+		if (ramp) {
+			for (f = 0; f < n_frames; f++)
+				for (c = 0; c < n_channels; c++)
+					this->gains[f * n_channels + c] =
+						this->gain[c] + (frame + f + 1) * delta[c];
+		}
+		else if (!this->gains_valid) {
+			for (f = 0; f < max_frames; f++)
+				for (c = 0; c < n_channels; c++)
+					this->gains[f * n_channels + c] = this->gain[c];
+			this->gains_valid = true;
+		}
+
+		if (ramp || !unity)
+			this->apply(dst, src, this->gains, n_frames * n_channels);
+		else if (dst != src)
+			memcpy(dst, src, n_bytes);
 
 		sindex += n_bytes;
 		dindex += n_bytes;
 		written += n_bytes;
 	}
+	if (ramp)
+		memcpy(this->gain, target, n_channels * sizeof(float));
+
 	dd[0].chunk->offset = 0;
 	dd[0].chunk->size = written;
 	dd[0].chunk->stride = 0;
@@ -952,8 +1075,19 @@ impl_init(const struct spa_handle_factory *factory,
 	}
 	init_type(&this->type, this->map);
 
+	{
+		struct spa_pod_template_field fields[] = {
+			SPA_POD_TEMPLATE_FIELD(this->type.prop_volume, SPA_POD_TYPE_DOUBLE,
+					       struct props, volume),
+			SPA_POD_TEMPLATE_FIELD(this->type.prop_mute, SPA_POD_TYPE_BOOL,
+					       struct props, mute),
+		};
+		spa_pod_template_init(&this->props_template, fields, SPA_N_ELEMENTS(fields));
+	}
+
 	this->node = impl_node;
 	reset_props(&this->props);
+	spa_volume_get_ops(&this->ops);
 
 	this->in_ports[0].info.flags = SPA_PORT_INFO_FLAG_CAN_USE_BUFFERS |
 	    SPA_PORT_INFO_FLAG_IN_PLACE;
@@ -0,0 +1,137 @@
+/* Spa
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <spa/pod/builder.h>
+#include <spa/pod/parser.h>
+#include <spa/pod/template.h>
+
+#define N_ITERATIONS	1000000
+
+/* the props of audiotestsrc */
+struct props {
+	bool live;
+	uint32_t wave;
+	double freq;
+	double volume;
+};
+
+enum {
+	PROPS = 1,
+	PROP_LIVE,
+	PROP_WAVE,
+	PROP_FREQ,
+	PROP_VOLUME,
+};
+
+static uint64_t get_time(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * SPA_NSEC_PER_SEC + now.tv_nsec;
+}
+
+static struct spa_pod *build_props(struct spa_pod_builder *b, struct props *p)
+{
+	return spa_pod_builder_object(b, 0, PROPS,
+			":", PROP_LIVE,   "b", p->live,
+			":", PROP_WAVE,   "i", p->wave,
+			":", PROP_FREQ,   "d", p->freq,
+			":", PROP_VOLUME, "d", p->volume);
+}
+
+static void parse_props(struct spa_pod *pod, struct props *p)
+{
+	spa_pod_object_parse(pod,
+			":", PROP_LIVE,   "?b", &p->live,
+			":", PROP_WAVE,   "?i", &p->wave,
+			":", PROP_FREQ,   "?d", &p->freq,
+			":", PROP_VOLUME, "?d", &p->volume, NULL);
+}
+
+int main(int argc, char *argv[])
+{
+	uint8_t buffer1[1024], buffer2[1024];
+	struct spa_pod_builder b;
+	struct spa_pod_template tmpl;
+	struct spa_pod *pod1, *pod2;
+	struct props props = { true, 2, 440.0, 0.5 }, parsed;
+	struct spa_pod_template_field fields[] = {
+		SPA_POD_TEMPLATE_FIELD(PROP_LIVE, SPA_POD_TYPE_BOOL, struct props, live),
+		SPA_POD_TEMPLATE_FIELD(PROP_WAVE, SPA_POD_TYPE_INT, struct props, wave),
+		SPA_POD_TEMPLATE_FIELD(PROP_FREQ, SPA_POD_TYPE_DOUBLE, struct props, freq),
+		SPA_POD_TEMPLATE_FIELD(PROP_VOLUME, SPA_POD_TYPE_DOUBLE, struct props, volume),
+	};
+	uint64_t t1, t2, t3, t4, t5;
+	int i, res = 0;
+
+	if (spa_pod_template_init(&tmpl, fields, SPA_N_ELEMENTS(fields)) < 0) {
+		printf("can't make template\n");
+		return -1;
+	}
+
+	/* both ways should make the same pod */
+	spa_pod_builder_init(&b, buffer1, sizeof(buffer1));
+	pod1 = build_props(&b, &props);
+	spa_pod_builder_init(&b, buffer2, sizeof(buffer2));
+	pod2 = spa_pod_template_build(&b, 0, PROPS, &tmpl, &props);
+
+	if (pod1 == NULL || pod2 == NULL || SPA_POD_SIZE(pod1) != SPA_POD_SIZE(pod2) ||
+	    memcmp(pod1, pod2, SPA_POD_SIZE(pod1)) != 0) {
+		printf("template and builder pods differ\n");
+		res = -1;
+	}
+	memset(&parsed, 0, sizeof(parsed));
+	if (spa_pod_template_parse(&tmpl, pod1, &parsed) != 4 ||
+	    parsed.live != props.live || parsed.wave != props.wave ||
+	    parsed.freq != props.freq || parsed.volume != props.volume) {
+		printf("template parse failed\n");
+		res = -1;
+	}
+
+	t1 = get_time();
+	for (i = 0; i < N_ITERATIONS; i++) {
+		spa_pod_builder_init(&b, buffer1, sizeof(buffer1));
+		pod1 = build_props(&b, &props);
+	}
+	t2 = get_time();
+	for (i = 0; i < N_ITERATIONS; i++) {
+		spa_pod_builder_init(&b, buffer2, sizeof(buffer2));
+		pod2 = spa_pod_template_build(&b, 0, PROPS, &tmpl, &props);
+	}
+	t3 = get_time();
+	for (i = 0; i < N_ITERATIONS; i++)
+		parse_props(pod1, &parsed);
+	t4 = get_time();
+	for (i = 0; i < N_ITERATIONS; i++)
+		spa_pod_template_parse(&tmpl, pod2, &parsed);
+	t5 = get_time();
+
+	printf("build: builder %.1f ns, template %.1f ns\n",
+			(double)(t2 - t1) / N_ITERATIONS, (double)(t3 - t2) / N_ITERATIONS);
+	printf("parse: parser %.1f ns, template %.1f ns\n",
+			(double)(t4 - t3) / N_ITERATIONS, (double)(t5 - t4) / N_ITERATIONS);
+
+	return res;
+}
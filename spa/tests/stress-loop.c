@@ -0,0 +1,229 @@
+/* Spa
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <spa/support/plugin.h>
+#include <spa/support/loop.h>
+#include <spa/support/type-map-impl.h>
+
+#define MAX_PRODUCERS	16
+#define N_INVOKES	100000
+#define MAX_DATA	200
+
+static SPA_TYPE_MAP_IMPL(type_map, 4096);
+
+struct producer {
+	pthread_t thread;
+	uint32_t id;
+	uint32_t next;		/* next expected seq, only used in the loop */
+	uint32_t received;
+	uint32_t failures;
+	uint32_t full;
+};
+
+static struct spa_loop *loop;
+static struct spa_loop_control *control;
+static struct producer producers[MAX_PRODUCERS];
+static uint32_t n_producers = 4;
+static volatile bool running = true;
+
+static uint64_t get_time(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * SPA_NSEC_PER_SEC + now.tv_nsec;
+}
+
+/* the data is the producer id, followed by bytes derived from the seq */
+static size_t make_data(uint8_t *data, uint32_t id, uint32_t seq)
+{
+	size_t i, size = sizeof(uint32_t) + (seq * 7 + id) % MAX_DATA;
+
+	memcpy(data, &id, sizeof(uint32_t));
+	for (i = sizeof(uint32_t); i < size; i++)
+		data[i] = (uint8_t) (seq + i);
+	return size;
+}
+
+static int do_invoke(struct spa_loop *loop, bool async, uint32_t seq,
+		     const void *data, size_t size, void *user_data)
+{
+	uint8_t expected[MAX_DATA + sizeof(uint32_t)];
+	struct producer *p = user_data;
+	uint32_t id;
+
+	memcpy(&id, data, sizeof(uint32_t));
+
+	/* invokes of one producer are handled in order */
+	if (id != p->id || seq != p->next ||
+	    size != make_data(expected, id, seq) ||
+	    memcmp(data, expected, size) != 0)
+		p->failures++;
+
+	p->next = seq + 1;
+	p->received++;
+
+	return seq ^ id;
+}
+
+static void *producer_start(void *arg)
+{
+	uint8_t data[MAX_DATA + sizeof(uint32_t)];
+	struct producer *p = arg;
+	uint32_t seq;
+	size_t size;
+	int res;
+
+	for (seq = 0; seq < N_INVOKES; ) {
+		bool block = (seq % 16) == 0;
+
+		size = make_data(data, p->id, seq);
+		res = spa_loop_invoke(loop, do_invoke, seq, data, size, block, p);
+		if (res == -EPIPE) {
+			p->full++;
+			sched_yield();
+			continue;
+		}
+		/* blocking invokes return the result of the function */
+		if (block && res != (int) (seq ^ p->id))
+			__atomic_fetch_add(&p->failures, 1, __ATOMIC_RELAXED);
+		seq++;
+	}
+	return NULL;
+}
+
+static int do_stop(struct spa_loop *loop, bool async, uint32_t seq,
+		   const void *data, size_t size, void *user_data)
+{
+	running = false;
+	return 0;
+}
+
+static void *loop_start(void *arg)
+{
+	spa_loop_control_enter(control);
+	while (running)
+		spa_loop_control_iterate(control, -1);
+	spa_loop_control_leave(control);
+	return NULL;
+}
+
+static int make_loop(const char *lib)
+{
+	struct spa_handle *handle;
+	spa_handle_factory_enum_func_t enum_func;
+	const struct spa_handle_factory *factory;
+	struct spa_support support[1];
+	void *hnd, *iface;
+	uint32_t i;
+	int res;
+
+	if ((hnd = dlopen(lib, RTLD_NOW)) == NULL) {
+		printf("can't load %s: %s\n", lib, dlerror());
+		return -1;
+	}
+	if ((enum_func = dlsym(hnd, SPA_HANDLE_FACTORY_ENUM_FUNC_NAME)) == NULL) {
+		printf("can't find enum function\n");
+		return -1;
+	}
+	for (i = 0;;) {
+		if ((res = enum_func(&factory, &i)) <= 0) {
+			printf("can't find loop factory\n");
+			return -1;
+		}
+		if (strcmp(factory->name, "loop") == 0)
+			break;
+	}
+	support[0] = SPA_SUPPORT_INIT(SPA_TYPE__TypeMap, &type_map.map);
+
+	handle = calloc(1, factory->size);
+	if ((res = spa_handle_factory_init(factory, handle, NULL, support, 1)) < 0) {
+		printf("can't make factory instance: %d\n", res);
+		return -1;
+	}
+	if ((res = spa_handle_get_interface(handle,
+			spa_type_map_get_id(&type_map.map, SPA_TYPE__Loop), &iface)) < 0) {
+		printf("can't get loop interface %d\n", res);
+		return -1;
+	}
+	loop = iface;
+	if ((res = spa_handle_get_interface(handle,
+			spa_type_map_get_id(&type_map.map, SPA_TYPE__LoopControl), &iface)) < 0) {
+		printf("can't get loop control interface %d\n", res);
+		return -1;
+	}
+	control = iface;
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	pthread_t loop_thread;
+	uint32_t i, failures = 0, full = 0;
+	uint64_t t1, t2;
+
+	if (argc > 1)
+		n_producers = SPA_CLAMP(atoi(argv[1]), 1, MAX_PRODUCERS);
+
+	if (make_loop("build/spa/plugins/support/libspa-support.so") < 0)
+		return -1;
+
+	printf("starting loop stress test, %d producers, %d invokes each\n",
+	       n_producers, N_INVOKES);
+
+	pthread_create(&loop_thread, NULL, loop_start, NULL);
+
+	t1 = get_time();
+	for (i = 0; i < n_producers; i++) {
+		producers[i].id = i;
+		pthread_create(&producers[i].thread, NULL, producer_start, &producers[i]);
+	}
+	for (i = 0; i < n_producers; i++)
+		pthread_join(producers[i].thread, NULL);
+
+	spa_loop_invoke(loop, do_stop, 0, NULL, 0, true, NULL);
+	t2 = get_time();
+
+	pthread_join(loop_thread, NULL);
+
+	for (i = 0; i < n_producers; i++) {
+		struct producer *p = &producers[i];
+
+		if (p->received != N_INVOKES) {
+			printf("producer %d: received %d invokes\n", i, p->received);
+			failures++;
+		}
+		failures += p->failures;
+		full += p->full;
+	}
+	printf("%d failures, %d times full, %.2f ns per invoke\n", failures, full,
+	       (double) (t2 - t1) / (n_producers * N_INVOKES));
+
+	return failures ? -1 : 0;
+}
@@ -0,0 +1,84 @@
+/* Spa
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <spa/utils/dll.h>
+
+#define RATE		48000
+#define PERIOD		1024
+#define N_PERIODS	20000
+
+/* simulate a device that runs \a ppm too fast and wakes up with up to
+ * \a jitter nanoseconds of delay, check that the dll finds the real rate
+ * and filters the jitter */
+static int test_drift(double ppm, int64_t jitter)
+{
+	struct spa_dll dll;
+	double real_period = SPA_NSEC_PER_SEC / (RATE * (1.0 + ppm / 1e6));
+	double rate, err, max_err = 0.0;
+	int64_t ticks = 0, time, filtered;
+	int i, res = 0;
+
+	spa_dll_init(&dll, SPA_DLL_BW_MAX, RATE);
+
+	for (i = 0; i < N_PERIODS; i++) {
+		/* the wakeups are not periodic, the device is */
+		ticks += PERIOD + (rand() % 64) - 32;
+		time = 1000000 + ticks * real_period;
+		filtered = spa_dll_update(&dll, ticks, time + (rand() % (jitter + 1)));
+
+		if (i == 400)
+			spa_dll_set_bw(&dll, SPA_DLL_BW_MIN);
+		/* the filtered time settles on the mean delay of the wakeups */
+		if (i > N_PERIODS / 2) {
+			err = fabs((double)(filtered - time - jitter / 2));
+			max_err = SPA_MAX(max_err, err);
+		}
+	}
+	rate = spa_dll_get_rate(&dll);
+
+	printf("drift %+6.1f ppm jitter %6ld ns: rate %.3f (real %.3f), max error %.0f ns\n",
+			ppm, jitter, rate, RATE * (1.0 + ppm / 1e6), max_err);
+
+	/* within 2 ppm of the real rate and well below the jitter */
+	if (fabs(rate / (RATE * (1.0 + ppm / 1e6)) - 1.0) > 2e-6) {
+		printf("rate is off\n");
+		res = -1;
+	}
+	if (max_err > jitter / 10 + 1000) {
+		printf("jitter is not filtered\n");
+		res = -1;
+	}
+	return res;
+}
+
+int main(int argc, char *argv[])
+{
+	int res = 0;
+
+	res |= test_drift(0.0, 0);
+	res |= test_drift(100.0, 200000);
+	res |= test_drift(-250.0, 500000);
+	res |= test_drift(30.0, 1000000);
+
+	return res;
+}
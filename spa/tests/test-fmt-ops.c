@@ -0,0 +1,242 @@
+/* Spa
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <spa/utils/defs.h>
+
+#include "fmt-ops.h"
+
+#define N_FRAMES	1027	/* not a multiple of the vector size */
+#define MAX_CHANNELS	8
+#define N_LOOPS		2000
+
+struct impl {
+	const char *name;
+	uint32_t flags;
+	struct spa_audioconvert_ops ops;
+};
+
+static const char *fmt_names[] = { "s16", "s24", "s24_32", "s32", "f32" };
+static const int test_channels[] = { 1, 2, 3, 6 };
+
+static uint8_t src[N_FRAMES * MAX_CHANNELS * 4];
+static uint8_t dst[2][N_FRAMES * MAX_CHANNELS * 4];
+static float planes[MAX_CHANNELS][N_FRAMES];
+static float out_planes[2][MAX_CHANNELS][N_FRAMES];
+
+/* floats a bit outside of [-1.0, 1.0] so that the conversions also clip */
+static void fill(void)
+{
+	int i, j;
+
+	for (i = 0; i < (int) sizeof(src); i++)
+		src[i] = random();
+	for (j = 0; j < MAX_CHANNELS; j++)
+		for (i = 0; i < N_FRAMES; i++)
+			planes[j][i] = (float) (random() % 24001 - 12000) / 10000.0f;
+	memset(dst, 0, sizeof(dst));
+	memset(out_planes, 0, sizeof(out_planes));
+}
+
+static void get_planes(void *p[], float pl[][N_FRAMES], int n_channels, int offset)
+{
+	int j;
+
+	for (j = 0; j < n_channels; j++)
+		p[j] = &pl[j][offset];
+}
+
+/* run the reference and the vector function on the same data, with an
+ * unaligned offset and compare the bits */
+static int check(const char *name, int fmt, int n_channels, int offset,
+		 struct spa_audioconvert_ops *ref, struct spa_audioconvert_ops *ops)
+{
+	int size = spa_audioconvert_fmt_sizes[fmt] * n_channels;
+	int n_frames = N_FRAMES - offset;
+	void *d[MAX_CHANNELS];
+	const void *s[MAX_CHANNELS];
+	int res = 0;
+
+	fill();
+
+	s[0] = SPA_MEMBER(src, offset * size, void);
+	get_planes(d, out_planes[0], n_channels, offset);
+	ref->to_f32[fmt](d, s, n_channels, n_frames);
+	get_planes(d, out_planes[1], n_channels, offset);
+	ops->to_f32[fmt](d, s, n_channels, n_frames);
+
+	if (memcmp(out_planes[0], out_planes[1], sizeof(out_planes[0])) != 0) {
+		printf("%s: %s to f32 %d channels offset %d differs from scalar\n",
+		       name, fmt_names[fmt], n_channels, offset);
+		res = -1;
+	}
+
+	get_planes((void **) s, planes, n_channels, offset);
+	d[0] = SPA_MEMBER(dst[0], offset * size, void);
+	ref->from_f32[fmt](d, s, n_channels, n_frames);
+	d[0] = SPA_MEMBER(dst[1], offset * size, void);
+	ops->from_f32[fmt](d, s, n_channels, n_frames);
+
+	if (memcmp(dst[0], dst[1], sizeof(dst[0])) != 0) {
+		printf("%s: f32 to %s %d channels offset %d differs from scalar\n",
+		       name, fmt_names[fmt], n_channels, offset);
+		res = -1;
+	}
+	return res;
+}
+
+static int check_ops(struct impl *ref, struct impl *impl)
+{
+	int fmt, c, offset, res = 0;
+
+	for (fmt = 0; fmt < CONV_FMT_MAX; fmt++) {
+		for (c = 0; c < (int) SPA_N_ELEMENTS(test_channels); c++) {
+			for (offset = 0; offset < 2; offset++)
+				res |= check(impl->name, fmt, test_channels[c], offset,
+					     &ref->ops, &impl->ops);
+		}
+	}
+	return res;
+}
+
+/* the integer formats survive a conversion to float and back */
+static int check_roundtrip(struct impl *impl)
+{
+	int fmt, i, n_samples = N_FRAMES * 2, res = 0;
+	void *d[1];
+	const void *s[1];
+
+	for (fmt = 0; fmt < CONV_FMT_F32; fmt++) {
+		int size = spa_audioconvert_fmt_sizes[fmt];
+
+		fill();
+		for (i = 0; i < n_samples; i++) {
+			switch (fmt) {
+			case CONV_FMT_S16:
+				((int16_t *) src)[i] = SPA_MAX(((int16_t *) src)[i], -INT16_MAX);
+				break;
+			case CONV_FMT_S24:
+				if (src[i * 3 + 2] == 0x80 && src[i * 3 + 1] == 0 && src[i * 3] == 0)
+					src[i * 3] = 1;
+				break;
+			case CONV_FMT_S24_32:
+				((int32_t *) src)[i] = SPA_MAX(((int32_t *) src)[i] >> 8, -8388607);
+				break;
+			case CONV_FMT_S32:
+				((int32_t *) src)[i] = SPA_MAX(((int32_t *) src)[i] >> 8, -8388607) * 256;
+				break;
+			}
+		}
+		s[0] = src;
+		d[0] = planes[0];
+		impl->ops.to_f32[fmt](d, s, 1, n_samples);
+		s[0] = planes[0];
+		d[0] = dst[0];
+		impl->ops.from_f32[fmt](d, s, 1, n_samples);
+
+		if (memcmp(src, dst[0], n_samples * size) != 0) {
+			printf("%s: %s to f32 and back is not the same\n",
+			       impl->name, fmt_names[fmt]);
+			res = -1;
+		}
+	}
+	return res;
+}
+
+static uint64_t get_time(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * SPA_NSEC_PER_SEC + now.tv_nsec;
+}
+
+static void bench_ops(struct impl *impl)
+{
+	int fmt, c, i, n_channels;
+	uint64_t t1, t2, t3;
+	void *d[MAX_CHANNELS];
+	const void *s[MAX_CHANNELS];
+
+	fill();
+
+	for (fmt = 0; fmt < CONV_FMT_MAX; fmt++) {
+		for (c = 0; c < (int) SPA_N_ELEMENTS(test_channels); c++) {
+			n_channels = test_channels[c];
+
+			s[0] = src;
+			get_planes(d, out_planes[0], n_channels, 0);
+			t1 = get_time();
+			for (i = 0; i < N_LOOPS; i++)
+				impl->ops.to_f32[fmt](d, s, n_channels, N_FRAMES);
+			t2 = get_time();
+			get_planes((void **) s, planes, n_channels, 0);
+			d[0] = dst[0];
+			for (i = 0; i < N_LOOPS; i++)
+				impl->ops.from_f32[fmt](d, s, n_channels, N_FRAMES);
+			t3 = get_time();
+
+			printf("%-6s %-6s %d channels: to f32 %6.3f ns/sample, from f32 %6.3f ns/sample\n",
+			       impl->name, fmt_names[fmt], n_channels,
+			       (double) (t2 - t1) / (N_LOOPS * N_FRAMES * n_channels),
+			       (double) (t3 - t2) / (N_LOOPS * N_FRAMES * n_channels));
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	struct impl impls[] = {
+		{ "c", 0, },
+#if defined (HAVE_SSE2)
+		{ "sse2", SPA_CPU_FLAG_SSE2, },
+#endif
+	};
+	uint32_t i, cpu_flags;
+	int res = 0;
+
+	cpu_flags = spa_cpu_get_flags();
+	printf("cpu flags 0x%08x\n", cpu_flags);
+
+	for (i = 0; i < SPA_N_ELEMENTS(impls); i++) {
+		struct impl *impl = &impls[i];
+
+		if ((impl->flags & cpu_flags) != impl->flags) {
+			printf("%s: not supported\n", impl->name);
+			continue;
+		}
+		spa_audioconvert_get_ops_flags(&impl->ops, impl->flags);
+
+		if (i > 0 && check_ops(&impls[0], impl) < 0)
+			res = -1;
+		if (check_roundtrip(impl) < 0)
+			res = -1;
+
+		bench_ops(impl);
+	}
+	if (res == 0)
+		printf("all functions produce the same results as the scalar ones\n");
+
+	return res;
+}
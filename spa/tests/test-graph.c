@@ -25,6 +25,7 @@
 #include <errno.h>
 #include <pthread.h>
 #include <poll.h>
+#include <semaphore.h>
 
 #include <spa/support/log-impl.h>
 #include <spa/support/loop.h>
@@ -43,6 +44,8 @@ static SPA_LOG_IMPL(default_log);
 
 #include <spa/graph/graph.h>
 #include <spa/graph/graph-scheduler6.h>
+#include <spa/graph/graph-scheduler7.h>
+#include <spa/graph/graph-scheduler8.h>
 
 #include <spa/debug/pod.h>
 
@@ -143,6 +146,261 @@ struct data {
 
 #define BUFFER_SIZE    MIN_LATENCY
 
+#define TEST_CYCLES	16
+#define TEST_WORKERS	4
+
+struct test_node {
+	struct spa_node node;
+	struct spa_graph_node gnode;
+	struct spa_graph_port in[2];
+	struct spa_graph_port out;
+	uint32_t n_in;
+	uint32_t seq;
+	uint32_t n_process;
+	uint32_t results[TEST_CYCLES];
+	uint32_t n_results;
+};
+
+struct test_graph;
+
+struct test_worker {
+	struct test_graph *graph;
+	uint32_t id;
+	pthread_t thread;
+	sem_t wakeup;
+};
+
+struct test_graph {
+	struct spa_graph graph;
+	struct spa_graph_data data;
+	struct spa_graph_sorted sorted;
+	struct spa_graph_parallel parallel;
+	struct spa_graph_worker workers[TEST_WORKERS];
+	struct test_worker threads[TEST_WORKERS];
+	bool running;
+	struct test_node src[2];
+	struct test_node mix;
+	struct test_node sink;
+	struct spa_io_buffers src_mix_io[2];
+	struct spa_io_buffers mix_sink_io;
+};
+
+static int test_src_process_output(struct spa_node *node)
+{
+	struct test_node *n = SPA_CONTAINER_OF(node, struct test_node, node);
+	struct spa_io_buffers *io = n->out.io;
+
+	n->n_process++;
+	io->buffer_id = n->seq++;
+	io->status = SPA_STATUS_HAVE_BUFFER;
+	return SPA_STATUS_HAVE_BUFFER;
+}
+
+static int test_mix_process_input(struct spa_node *node)
+{
+	struct test_node *n = SPA_CONTAINER_OF(node, struct test_node, node);
+	struct spa_io_buffers *out = n->out.io;
+	uint32_t i;
+
+	n->n_process++;
+	out->buffer_id = 0;
+	for (i = 0; i < n->n_in; i++) {
+		struct spa_io_buffers *in = n->in[i].io;
+		if (in->status != SPA_STATUS_HAVE_BUFFER)
+			return SPA_STATUS_NEED_BUFFER;
+		out->buffer_id = out->buffer_id * 100 + in->buffer_id;
+	}
+	out->status = SPA_STATUS_HAVE_BUFFER;
+	return SPA_STATUS_HAVE_BUFFER;
+}
+
+static int test_mix_process_output(struct spa_node *node)
+{
+	struct test_node *n = SPA_CONTAINER_OF(node, struct test_node, node);
+	uint32_t i;
+
+	n->n_process++;
+	for (i = 0; i < n->n_in; i++)
+		n->in[i].io->status = SPA_STATUS_NEED_BUFFER;
+	return SPA_STATUS_NEED_BUFFER;
+}
+
+static int test_sink_process_input(struct spa_node *node)
+{
+	struct test_node *n = SPA_CONTAINER_OF(node, struct test_node, node);
+	struct spa_io_buffers *io = n->in[0].io;
+
+	n->n_process++;
+	if (io->status == SPA_STATUS_HAVE_BUFFER && n->n_results < TEST_CYCLES)
+		n->results[n->n_results++] = io->buffer_id;
+	io->status = SPA_STATUS_NEED_BUFFER;
+	return SPA_STATUS_OK;
+}
+
+static void test_node_init(struct test_graph *g, struct test_node *n,
+			   int (*process_input) (struct spa_node *node),
+			   int (*process_output) (struct spa_node *node))
+{
+	n->node.version = SPA_VERSION_NODE;
+	n->node.process_input = process_input;
+	n->node.process_output = process_output;
+	spa_graph_node_init(&n->gnode);
+	spa_graph_node_set_implementation(&n->gnode, &n->node);
+	spa_graph_node_add(&g->graph, &n->gnode);
+}
+
+static void test_node_add_port(struct test_node *n, enum spa_direction direction,
+			       struct spa_io_buffers *io)
+{
+	struct spa_graph_port *p;
+
+	if (direction == SPA_DIRECTION_INPUT)
+		p = &n->in[n->n_in++];
+	else
+		p = &n->out;
+
+	spa_graph_port_init(p, direction, direction == SPA_DIRECTION_INPUT ? n->n_in - 1 : 0, 0, io);
+	spa_graph_port_add(&n->gnode, p);
+}
+
+static void *test_worker_thread(void *data)
+{
+	struct test_worker *w = data;
+
+	while (true) {
+		sem_wait(&w->wakeup);
+		if (!__atomic_load_n(&w->graph->running, __ATOMIC_ACQUIRE))
+			break;
+		spa_graph_parallel_work(&w->graph->parallel, w->id);
+	}
+	return NULL;
+}
+
+static void test_wakeup(void *data)
+{
+	struct test_graph *g = data;
+	int i;
+
+	for (i = 1; i < TEST_WORKERS; i++)
+		sem_post(&g->threads[i].wakeup);
+}
+
+static const struct spa_graph_parallel_callbacks test_parallel_callbacks = {
+	SPA_VERSION_GRAPH_PARALLEL_CALLBACKS,
+	.wakeup = test_wakeup,
+};
+
+static void test_graph_build(struct test_graph *g, int mode)
+{
+	int i;
+
+	spa_graph_init(&g->graph);
+	switch (mode) {
+	case 0:
+		spa_graph_data_init(&g->data, &g->graph);
+		spa_graph_set_callbacks(&g->graph, &spa_graph_impl_default, &g->data);
+		break;
+	case 1:
+		spa_graph_sorted_init(&g->sorted, &g->graph);
+		spa_graph_set_callbacks(&g->graph, &spa_graph_impl_sorted, &g->sorted);
+		break;
+	case 2:
+		spa_graph_parallel_init(&g->parallel, &g->graph, g->workers, TEST_WORKERS,
+					&test_parallel_callbacks, g);
+		spa_graph_set_callbacks(&g->graph, &spa_graph_impl_parallel, &g->parallel);
+		g->running = true;
+		for (i = 1; i < TEST_WORKERS; i++) {
+			struct test_worker *w = &g->threads[i];
+			w->graph = g;
+			w->id = i;
+			sem_init(&w->wakeup, 0, 0);
+			pthread_create(&w->thread, NULL, test_worker_thread, w);
+		}
+		break;
+	}
+
+	/* add the nodes in reverse order so that the scheduler has to sort */
+	test_node_init(g, &g->sink, test_sink_process_input, NULL);
+	test_node_init(g, &g->mix, test_mix_process_input, test_mix_process_output);
+	test_node_init(g, &g->src[1], NULL, test_src_process_output);
+	test_node_init(g, &g->src[0], NULL, test_src_process_output);
+
+	g->mix_sink_io = SPA_IO_BUFFERS_INIT;
+	g->mix_sink_io.status = SPA_STATUS_NEED_BUFFER;
+	test_node_add_port(&g->mix, SPA_DIRECTION_OUTPUT, &g->mix_sink_io);
+	test_node_add_port(&g->sink, SPA_DIRECTION_INPUT, &g->mix_sink_io);
+	spa_graph_port_link(&g->mix.out, &g->sink.in[0]);
+
+	for (i = 0; i < 2; i++) {
+		g->src_mix_io[i] = SPA_IO_BUFFERS_INIT;
+		g->src[i].seq = i * 10;
+		test_node_add_port(&g->src[i], SPA_DIRECTION_OUTPUT, &g->src_mix_io[i]);
+		test_node_add_port(&g->mix, SPA_DIRECTION_INPUT, &g->src_mix_io[i]);
+		spa_graph_port_link(&g->src[i].out, &g->mix.in[i]);
+	}
+}
+
+static void test_graph_clear(struct test_graph *g)
+{
+	int i;
+
+	if (!g->running)
+		return;
+
+	__atomic_store_n(&g->running, false, __ATOMIC_RELEASE);
+	for (i = 1; i < TEST_WORKERS; i++)
+		sem_post(&g->threads[i].wakeup);
+	for (i = 1; i < TEST_WORKERS; i++) {
+		pthread_join(g->threads[i].thread, NULL);
+		sem_destroy(&g->threads[i].wakeup);
+	}
+}
+
+static int compare_schedulers(void)
+{
+	static const char *names[] = { "default", "sorted", "parallel" };
+	struct test_graph *g[3];
+	int i, j, res = 0;
+
+	for (i = 0; i < 3; i++) {
+		g[i] = calloc(1, sizeof(struct test_graph));
+		test_graph_build(g[i], i);
+
+		for (j = 0; j < TEST_CYCLES; j++)
+			spa_graph_need_input(&g[i]->graph, &g[i]->sink.gnode);
+
+		test_graph_clear(g[i]);
+	}
+
+	for (i = 1; i < 3 && res == 0; i++) {
+		if (g[0]->sink.n_results != TEST_CYCLES ||
+		    g[i]->sink.n_results != TEST_CYCLES ||
+		    memcmp(g[0]->sink.results, g[i]->sink.results, sizeof(g[0]->sink.results)) != 0) {
+			printf("%s scheduler produced different results\n", names[i]);
+			res = -1;
+		}
+		for (j = 0; j < 2 && res == 0; j++) {
+			if (g[0]->src[j].n_process != g[i]->src[j].n_process) {
+				printf("%s scheduler processed source %d %d times, expected %d\n",
+				       names[i], j, g[i]->src[j].n_process, g[0]->src[j].n_process);
+				res = -1;
+			}
+		}
+		if (res == 0 && g[0]->mix.n_process != g[i]->mix.n_process) {
+			printf("%s scheduler processed mixer %d times, expected %d\n",
+			       names[i], g[i]->mix.n_process, g[0]->mix.n_process);
+			res = -1;
+		}
+	}
+	if (res == 0)
+		printf("schedulers processed %d cycles with the same results\n", TEST_CYCLES);
+
+	for (i = 0; i < 3; i++)
+		free(g[i]);
+
+	return res;
+}
+
 static void
 init_buffer(struct data *data, struct spa_buffer **bufs, struct buffer *ba, int n_buffers,
 	    size_t size)
@@ -581,6 +839,9 @@ int main(int argc, char *argv[])
 
 	init_type(&data.type, data.map);
 
+	if ((res = compare_schedulers()) < 0)
+		return -1;
+
 	if ((res = make_nodes(&data, argc > 1 ? argv[1] : NULL)) < 0) {
 		printf("can't make nodes: %d\n", res);
 		return -1;
@@ -0,0 +1,156 @@
+/* Spa
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <dlfcn.h>
+#include <errno.h>
+
+#include <spa/support/plugin.h>
+#include <spa/support/type-map-impl.h>
+
+#define N_TYPES		4096
+#define N_LOOPS		100
+
+static SPA_TYPE_MAP_IMPL(linear_map, N_TYPES + 1);
+
+static char *types[N_TYPES];
+
+static uint64_t get_time(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * SPA_NSEC_PER_SEC + now.tv_nsec;
+}
+
+static struct spa_type_map *make_mapper(const char *lib)
+{
+	struct spa_handle *handle;
+	spa_handle_factory_enum_func_t enum_func;
+	const struct spa_handle_factory *factory;
+	struct spa_type_map *map;
+	void *hnd, *iface;
+	uint32_t i;
+	int res;
+
+	if ((hnd = dlopen(lib, RTLD_NOW)) == NULL) {
+		printf("can't load %s: %s\n", lib, dlerror());
+		return NULL;
+	}
+	if ((enum_func = dlsym(hnd, SPA_HANDLE_FACTORY_ENUM_FUNC_NAME)) == NULL) {
+		printf("can't find enum function\n");
+		return NULL;
+	}
+	for (i = 0;;) {
+		if ((res = enum_func(&factory, &i)) <= 0) {
+			printf("can't find mapper factory\n");
+			return NULL;
+		}
+		if (strcmp(factory->name, "mapper") == 0)
+			break;
+	}
+	handle = calloc(1, factory->size);
+	if ((res = spa_handle_factory_init(factory, handle, NULL, NULL, 0)) < 0) {
+		printf("can't make factory instance: %d\n", res);
+		return NULL;
+	}
+	/* the mapper maps its own type first, it has id 0 */
+	if ((res = spa_handle_get_interface(handle, 0, &iface)) < 0) {
+		printf("can't get interface %d\n", res);
+		return NULL;
+	}
+	map = iface;
+
+	return map;
+}
+
+/* ids must be stable, unique and the strings must stay valid while the
+ * map grows */
+static int check_map(struct spa_type_map *map)
+{
+	const char *first = spa_type_map_get_type(map, 0);
+	uint32_t i, id, base = spa_type_map_get_size(map);
+
+	for (i = 0; i < N_TYPES; i++) {
+		if ((id = spa_type_map_get_id(map, types[i])) != base + i) {
+			printf("type %s got id %u, expected %u\n", types[i], id, base + i);
+			return -1;
+		}
+	}
+	for (i = 0; i < N_TYPES; i++) {
+		id = spa_type_map_get_id(map, types[i]);
+		if (id != base + i || strcmp(spa_type_map_get_type(map, id), types[i]) != 0) {
+			printf("type %s changed id %u\n", types[i], id);
+			return -1;
+		}
+	}
+	if (first != spa_type_map_get_type(map, 0)) {
+		printf("type string moved\n");
+		return -1;
+	}
+	if (spa_type_map_get_size(map) != base + N_TYPES) {
+		printf("wrong size %zd\n", spa_type_map_get_size(map));
+		return -1;
+	}
+	return 0;
+}
+
+static void bench_map(const char *name, struct spa_type_map *map)
+{
+	uint64_t t1, t2;
+	uint32_t i, j;
+
+	t1 = get_time();
+	for (j = 0; j < N_LOOPS; j++)
+		for (i = 0; i < N_TYPES; i++)
+			spa_type_map_get_id(map, types[i]);
+	t2 = get_time();
+
+	printf("%-7s: %d types, get_id %8.2f ns\n", name, N_TYPES,
+	       (double) (t2 - t1) / (N_LOOPS * N_TYPES));
+}
+
+int main(int argc, char *argv[])
+{
+	struct spa_type_map *map;
+	uint32_t i;
+
+	for (i = 0; i < N_TYPES; i++) {
+		char name[64];
+		snprintf(name, sizeof(name), SPA_TYPE_BASE "Test:Type:%u", i);
+		types[i] = strdup(name);
+	}
+
+	if ((map = make_mapper("build/spa/plugins/support/libspa-support.so")) == NULL)
+		return -1;
+
+	if (check_map(map) < 0)
+		return -1;
+	for (i = 0; i < N_TYPES; i++)
+		spa_type_map_get_id(&linear_map.map, types[i]);
+
+	bench_map("mapper", map);
+	bench_map("linear", &linear_map.map);
+
+	return 0;
+}
@@ -0,0 +1,333 @@
+/* Spa
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <spa/utils/defs.h>
+
+#include "mix-ops.h"
+
+#define N_SAMPLES	4099	/* not a multiple of the vector size */
+#define N_LOOPS		20000
+#define N_SOURCES	8
+
+static const double scales[] = { 0.0, 0.25, 0.5, 0.999, 1.7, 15.9, 20.0, -1.0 };
+
+struct impl {
+	const char *name;
+	uint32_t flags;
+	struct spa_audiomixer_ops ops;
+};
+
+static int16_t src_s16[N_SAMPLES + 1], dst_s16[2][N_SAMPLES + 1];
+static float src_f32[N_SAMPLES + 1], dst_f32[2][N_SAMPLES + 1];
+static int16_t srcs_s16[N_SOURCES][N_SAMPLES + 1];
+static float srcs_f32[N_SOURCES][N_SAMPLES + 1];
+
+static void fill(void)
+{
+	int i, j;
+
+	for (i = 0; i < N_SAMPLES + 1; i++) {
+		src_s16[i] = (int16_t) (random() & 0xffff);
+		dst_s16[0][i] = dst_s16[1][i] = (int16_t) (random() & 0xffff);
+		src_f32[i] = (float) (random() % 20001 - 10000) / 10000.0f;
+		dst_f32[0][i] = dst_f32[1][i] = (float) (random() % 20001 - 10000) / 10000.0f;
+	}
+	for (j = 0; j < N_SOURCES; j++) {
+		for (i = 0; i < N_SAMPLES + 1; i++) {
+			srcs_s16[j][i] = (int16_t) (random() & 0xffff);
+			srcs_f32[j][i] = (float) (random() % 20001 - 10000) / 10000.0f;
+		}
+	}
+}
+
+/* run the reference and the vector function on the same data, with an
+ * unaligned offset and compare the bits */
+static int check(const char *name, const char *func, int fmt, int offset,
+		 mix_func_t ref, mix_func_t f, mix_scale_func_t ref_scale,
+		 mix_scale_func_t f_scale, double scale)
+{
+	void *src, *dst[2];
+	int size, n_bytes;
+
+	fill();
+
+	if (fmt == FMT_S16) {
+		src = &src_s16[offset];
+		dst[0] = &dst_s16[0][offset];
+		dst[1] = &dst_s16[1][offset];
+		size = sizeof(int16_t);
+	} else {
+		src = &src_f32[offset];
+		dst[0] = &dst_f32[0][offset];
+		dst[1] = &dst_f32[1][offset];
+		size = sizeof(float);
+	}
+	n_bytes = (N_SAMPLES - offset) * size;
+
+	if (ref) {
+		ref(dst[0], src, n_bytes);
+		f(dst[1], src, n_bytes);
+	} else {
+		ref_scale(dst[0], src, scale, n_bytes);
+		f_scale(dst[1], src, scale, n_bytes);
+	}
+	if (memcmp(dst[0], dst[1], n_bytes) != 0) {
+		printf("%s: %s_%s offset %d scale %f differs from scalar\n",
+		       name, func, fmt == FMT_S16 ? "s16" : "f32", offset, scale);
+		return -1;
+	}
+	return 0;
+}
+
+static void *get_sources(int fmt, int offset, const void *src[N_SOURCES])
+{
+	int i;
+
+	for (i = 0; i < N_SOURCES; i++) {
+		if (fmt == FMT_S16)
+			src[i] = &srcs_s16[i][offset];
+		else
+			src[i] = &srcs_f32[i][offset];
+	}
+	return fmt == FMT_S16 ? (void *) dst_s16 : (void *) dst_f32;
+}
+
+static int check_mix_n(const char *name, int fmt, int offset, int n_src,
+		       mix_n_func_t ref, mix_n_func_t f)
+{
+	const void *src[N_SOURCES];
+	double scale[N_SOURCES];
+	void *dst[2];
+	int i, size, n_bytes;
+
+	fill();
+
+	for (i = 0; i < N_SOURCES; i++)
+		scale[i] = scales[(i + n_src) % SPA_N_ELEMENTS(scales)];
+
+	get_sources(fmt, offset, src);
+	if (fmt == FMT_S16) {
+		dst[0] = &dst_s16[0][offset];
+		dst[1] = &dst_s16[1][offset];
+		size = sizeof(int16_t);
+	} else {
+		dst[0] = &dst_f32[0][offset];
+		dst[1] = &dst_f32[1][offset];
+		size = sizeof(float);
+	}
+	n_bytes = (N_SAMPLES - offset) * size;
+
+	ref(dst[0], src, scale, n_src, n_bytes);
+	f(dst[1], src, scale, n_src, n_bytes);
+
+	if (memcmp(dst[0], dst[1], n_bytes) != 0) {
+		printf("%s: mix_n_%s offset %d n_src %d differs from scalar\n",
+		       name, fmt == FMT_S16 ? "s16" : "f32", offset, n_src);
+		return -1;
+	}
+	return 0;
+}
+
+/* for f32, mix_n must give the same result as the copy_scale and add_scale
+ * passes. s16 is not compared, the passes clamp after each source. */
+static int check_mix_n_passes(const char *name, int fmt, int n_src, struct impl *impl)
+{
+	const void *src[N_SOURCES];
+	double scale[N_SOURCES];
+	void *dst[2];
+	int i, size, n_bytes;
+
+	fill();
+
+	for (i = 0; i < N_SOURCES; i++)
+		scale[i] = scales[(i + 1) % SPA_N_ELEMENTS(scales)];
+
+	get_sources(fmt, 0, src);
+	if (fmt == FMT_S16) {
+		dst[0] = dst_s16[0];
+		dst[1] = dst_s16[1];
+		size = sizeof(int16_t);
+	} else {
+		dst[0] = dst_f32[0];
+		dst[1] = dst_f32[1];
+		size = sizeof(float);
+	}
+	n_bytes = N_SAMPLES * size;
+
+	impl->ops.mix_n[fmt](dst[0], src, scale, n_src, n_bytes);
+	for (i = 0; i < n_src; i++) {
+		if (i == 0)
+			impl->ops.copy_scale[fmt](dst[1], src[i], scale[i], n_bytes);
+		else
+			impl->ops.add_scale[fmt](dst[1], src[i], scale[i], n_bytes);
+	}
+	if (memcmp(dst[0], dst[1], n_bytes) != 0) {
+		printf("%s: mix_n_%s n_src %d differs from separate passes\n",
+		       name, fmt == FMT_S16 ? "s16" : "f32", n_src);
+		return -1;
+	}
+	return 0;
+}
+
+static int check_ops(struct impl *ref, struct impl *impl)
+{
+	int fmt, offset, res = 0;
+	uint32_t i;
+
+	for (fmt = 0; fmt < FMT_MAX; fmt++) {
+		for (offset = 0; offset < 2; offset++) {
+			res |= check(impl->name, "add", fmt, offset,
+				     ref->ops.add[fmt], impl->ops.add[fmt], NULL, NULL, 0.0);
+			for (i = 0; i < SPA_N_ELEMENTS(scales); i++) {
+				res |= check(impl->name, "copy_scale", fmt, offset, NULL, NULL,
+					     ref->ops.copy_scale[fmt], impl->ops.copy_scale[fmt],
+					     scales[i]);
+				res |= check(impl->name, "add_scale", fmt, offset, NULL, NULL,
+					     ref->ops.add_scale[fmt], impl->ops.add_scale[fmt],
+					     scales[i]);
+			}
+			for (i = 0; i <= N_SOURCES; i++)
+				res |= check_mix_n(impl->name, fmt, offset, i,
+						   ref->ops.mix_n[fmt], impl->ops.mix_n[fmt]);
+		}
+	}
+	return res;
+}
+
+static uint64_t get_time(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * SPA_NSEC_PER_SEC + now.tv_nsec;
+}
+
+static void bench_mix_n(struct impl *impl)
+{
+	const void *src[N_SOURCES];
+	double scale[N_SOURCES];
+	int fmt, i, j;
+	uint64_t t1, t2, t3;
+	void *dst;
+
+	for (i = 0; i < N_SOURCES; i++)
+		scale[i] = 0.5;
+
+	for (fmt = 0; fmt < FMT_MAX; fmt++) {
+		int n_bytes = N_SAMPLES * (fmt == FMT_S16 ? sizeof(int16_t) : sizeof(float));
+
+		dst = get_sources(fmt, 0, src);
+
+		t1 = get_time();
+		for (i = 0; i < N_LOOPS / N_SOURCES; i++) {
+			impl->ops.copy_scale[fmt](dst, src[0], scale[0], n_bytes);
+			for (j = 1; j < N_SOURCES; j++)
+				impl->ops.add_scale[fmt](dst, src[j], scale[j], n_bytes);
+		}
+		t2 = get_time();
+		for (i = 0; i < N_LOOPS / N_SOURCES; i++)
+			impl->ops.mix_n[fmt](dst, src, scale, N_SOURCES, n_bytes);
+		t3 = get_time();
+
+		printf("%-6s %s: %d sources, passes %6.3f mix_n %6.3f ns/sample\n",
+		       impl->name, fmt == FMT_S16 ? "s16" : "f32", N_SOURCES,
+		       (double) (t2 - t1) / ((N_LOOPS / N_SOURCES) * N_SAMPLES),
+		       (double) (t3 - t2) / ((N_LOOPS / N_SOURCES) * N_SAMPLES));
+	}
+}
+
+static void bench_ops(struct impl *impl)
+{
+	int fmt, i;
+	uint64_t t1, t2, t3, t4;
+	void *src, *dst;
+
+	for (fmt = 0; fmt < FMT_MAX; fmt++) {
+		int n_bytes = N_SAMPLES * (fmt == FMT_S16 ? sizeof(int16_t) : sizeof(float));
+
+		src = fmt == FMT_S16 ? (void *) src_s16 : (void *) src_f32;
+		dst = fmt == FMT_S16 ? (void *) dst_s16[0] : (void *) dst_f32[0];
+
+		t1 = get_time();
+		for (i = 0; i < N_LOOPS; i++)
+			impl->ops.add[fmt](dst, src, n_bytes);
+		t2 = get_time();
+		for (i = 0; i < N_LOOPS; i++)
+			impl->ops.copy_scale[fmt](dst, src, 0.5, n_bytes);
+		t3 = get_time();
+		for (i = 0; i < N_LOOPS; i++)
+			impl->ops.add_scale[fmt](dst, src, 0.5, n_bytes);
+		t4 = get_time();
+
+		printf("%-6s %s: add %6.3f copy_scale %6.3f add_scale %6.3f ns/sample\n",
+		       impl->name, fmt == FMT_S16 ? "s16" : "f32",
+		       (double) (t2 - t1) / (N_LOOPS * N_SAMPLES),
+		       (double) (t3 - t2) / (N_LOOPS * N_SAMPLES),
+		       (double) (t4 - t3) / (N_LOOPS * N_SAMPLES));
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	struct impl impls[] = {
+		{ "c", 0, },
+#if defined (HAVE_SSE2)
+		{ "sse2", SPA_AUDIOMIXER_CPU_SSE2, },
+#endif
+#if defined (HAVE_AVX2)
+		{ "avx2", SPA_AUDIOMIXER_CPU_AVX2, },
+#endif
+#if defined (HAVE_NEON)
+		{ "neon", SPA_AUDIOMIXER_CPU_NEON, },
+#endif
+	};
+	uint32_t i, cpu_flags;
+	int j, res = 0;
+
+	cpu_flags = spa_audiomixer_get_cpu_flags();
+	printf("cpu flags 0x%08x\n", cpu_flags);
+
+	for (i = 0; i < SPA_N_ELEMENTS(impls); i++) {
+		struct impl *impl = &impls[i];
+
+		if ((impl->flags & cpu_flags) != impl->flags) {
+			printf("%s: not supported\n", impl->name);
+			continue;
+		}
+		spa_audiomixer_get_ops_flags(&impl->ops, impl->flags);
+
+		if (i > 0 && check_ops(&impls[0], impl) < 0)
+			res = -1;
+		for (j = 1; j <= N_SOURCES; j++)
+			if (check_mix_n_passes(impl->name, FMT_F32, j, impl) < 0)
+				res = -1;
+
+		bench_ops(impl);
+		bench_mix_n(impl);
+	}
+	if (res == 0)
+		printf("all functions produce the same results as the scalar ones\n");
+
+	return res;
+}
@@ -0,0 +1,210 @@
+/* Spa
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include <spa/utils/defs.h>
+
+#include "resample-ops.h"
+
+#define N_SAMPLES	4096
+#define N_LOOPS		200
+#define FREQ		1000.0
+
+struct impl {
+	const char *name;
+	uint32_t flags;
+};
+
+static const struct rates {
+	uint32_t i_rate, o_rate;
+	double rate;
+} test_rates[] = {
+	{ 44100, 48000, 1.0 },
+	{ 48000, 44100, 1.0 },
+	{ 48000, 48000, 1.001 },
+	{ 44100, 48000, 0.999 },
+	{ 48000, 96000, 1.0 },
+	{ 96000, 44100, 1.0 },
+};
+
+static float in[N_SAMPLES];
+static float out[2][N_SAMPLES * 3];
+
+static uint64_t get_time(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * SPA_NSEC_PER_SEC + now.tv_nsec;
+}
+
+static void fill_sine(uint32_t rate)
+{
+	int i;
+
+	for (i = 0; i < N_SAMPLES; i++)
+		in[i] = sin(2.0 * M_PI * FREQ * i / rate) * 0.5;
+}
+
+static uint32_t run(struct spa_resample *r, float *d, uint32_t out_size)
+{
+	const void *src[1] = { in };
+	void *dst[1] = { d };
+	uint32_t in_len = N_SAMPLES, out_len = out_size;
+
+	spa_resample_process(r, src, &in_len, dst, &out_len);
+	return out_len;
+}
+
+static int make(struct spa_resample *r, const struct rates *rt, int quality, uint32_t flags)
+{
+	memset(r, 0, sizeof(*r));
+	r->channels = 1;
+	r->i_rate = rt->i_rate;
+	r->o_rate = rt->o_rate;
+	r->quality = quality;
+	if (spa_resample_init(r, flags) < 0)
+		return -1;
+	spa_resample_update_rate(r, rt->rate);
+	return 0;
+}
+
+/* the vector functions make the same output as the scalar ones */
+static int check(struct impl *impl)
+{
+	struct spa_resample r[2];
+	uint32_t i, q, n[2];
+	int res = 0;
+
+	fill_sine(48000);
+
+	for (i = 0; i < SPA_N_ELEMENTS(test_rates); i++) {
+		for (q = RESAMPLE_QUALITY_MIN; q <= RESAMPLE_QUALITY_MAX; q++) {
+			make(&r[0], &test_rates[i], q, 0);
+			make(&r[1], &test_rates[i], q, impl->flags);
+			memset(out, 0, sizeof(out));
+			n[0] = run(&r[0], out[0], SPA_N_ELEMENTS(out[0]));
+			n[1] = run(&r[1], out[1], SPA_N_ELEMENTS(out[1]));
+
+			if (n[0] != n[1] || memcmp(out[0], out[1], sizeof(out[0])) != 0) {
+				printf("%s: %d -> %d quality %d differs from scalar\n",
+				       impl->name, test_rates[i].i_rate, test_rates[i].o_rate, q);
+				res = -1;
+			}
+			spa_resample_free(&r[0]);
+			spa_resample_free(&r[1]);
+		}
+	}
+	return res;
+}
+
+/* the signal to noise ratio of a resampled sine */
+static void quality(struct impl *impl, const struct rates *rt)
+{
+	struct spa_resample r;
+	uint32_t i, n, q;
+
+	fill_sine(rt->i_rate);
+
+	for (q = RESAMPLE_QUALITY_MIN; q <= RESAMPLE_QUALITY_MAX; q++) {
+		double signal = 0.0, noise = 0.0, e, ratio;
+
+		make(&r, rt, q, impl->flags);
+		n = run(&r, out[0], SPA_N_ELEMENTS(out[0]));
+		ratio = (double) rt->i_rate / rt->o_rate * rt->rate;
+
+		/* skip the start, output k is at input position k * ratio */
+		for (i = r.n_taps; i < n; i++) {
+			e = sin(2.0 * M_PI * FREQ * i * ratio / rt->i_rate) * 0.5;
+			signal += e * e;
+			noise += (out[0][i] - e) * (out[0][i] - e);
+		}
+		printf("%-6s %6d -> %6d quality %d: %3d taps %4d phases SNR %6.1f dB\n",
+		       impl->name, rt->i_rate, rt->o_rate, q, r.n_taps, r.n_phases,
+		       10.0 * log10(signal / noise));
+		spa_resample_free(&r);
+	}
+}
+
+static void bench(struct impl *impl, const struct rates *rt)
+{
+	struct spa_resample r;
+	uint32_t i, n = 0, q;
+	uint64_t t1, t2;
+
+	fill_sine(rt->i_rate);
+
+	for (q = RESAMPLE_QUALITY_MIN; q <= RESAMPLE_QUALITY_MAX; q++) {
+		make(&r, rt, q, impl->flags);
+
+		t1 = get_time();
+		for (i = 0; i < N_LOOPS; i++)
+			n += run(&r, out[0], SPA_N_ELEMENTS(out[0]));
+		t2 = get_time();
+
+		printf("%-6s %6d -> %6d quality %d: %6.2f ns/sample per channel, %6.1f x realtime\n",
+		       impl->name, rt->i_rate, rt->o_rate, q,
+		       (double) (t2 - t1) / n,
+		       (double) n / rt->o_rate * SPA_NSEC_PER_SEC / (t2 - t1));
+		spa_resample_free(&r);
+		n = 0;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	struct impl impls[] = {
+		{ "c", 0, },
+#if defined (HAVE_SSE2)
+		{ "sse2", SPA_CPU_FLAG_SSE2, },
+#endif
+	};
+	uint32_t i, j, cpu_flags;
+	int res = 0;
+
+	cpu_flags = spa_cpu_get_flags();
+	printf("cpu flags 0x%08x\n", cpu_flags);
+
+	for (i = 0; i < SPA_N_ELEMENTS(impls); i++) {
+		struct impl *impl = &impls[i];
+
+		if ((impl->flags & cpu_flags) != impl->flags) {
+			printf("%s: not supported\n", impl->name);
+			continue;
+		}
+		if (i > 0 && check(impl) < 0)
+			res = -1;
+
+		for (j = 0; j < 2; j++)
+			quality(impl, &test_rates[j]);
+		quality(impl, &test_rates[3]);
+		for (j = 0; j < 2; j++)
+			bench(impl, &test_rates[j]);
+	}
+	if (res == 0)
+		printf("all functions produce the same results as the scalar ones\n");
+
+	return res;
+}
@@ -0,0 +1,166 @@
+/* Spa
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <spa/utils/defs.h>
+
+#include "volume-ops.h"
+
+#define N_SAMPLES	4099	/* not a multiple of the vector size */
+#define N_LOOPS		20000
+
+struct impl {
+	const char *name;
+	uint32_t flags;
+	struct spa_volume_ops ops;
+};
+
+static const char *fmt_names[] = { "s16", "s32", "f32" };
+static const int fmt_sizes[] = { sizeof(int16_t), sizeof(int32_t), sizeof(float) };
+
+static int32_t src[N_SAMPLES + 1], dst[2][N_SAMPLES + 1];
+static float gain[N_SAMPLES + 1];
+
+/* gains between 0.0 and 4.0 so that the integer formats also clip */
+static void fill(int fmt)
+{
+	int i;
+
+	for (i = 0; i < N_SAMPLES + 1; i++) {
+		switch (fmt) {
+		case VOLUME_FMT_S16:
+			((int16_t *) src)[i] = (int16_t) (random() & 0xffff);
+			break;
+		case VOLUME_FMT_S32:
+			src[i] = (int32_t) random() - (int32_t) random();
+			break;
+		case VOLUME_FMT_F32:
+			((float *) src)[i] = (float) (random() % 20001 - 10000) / 10000.0f;
+			break;
+		}
+		gain[i] = (float) (random() % 40001) / 10000.0f;
+	}
+	memset(dst, 0, sizeof(dst));
+}
+
+/* run the reference and the vector function on the same data, with an
+ * unaligned offset and compare the bits */
+static int check(const char *name, int fmt, int offset,
+		 volume_func_t ref, volume_func_t f)
+{
+	int size = fmt_sizes[fmt];
+	int n_samples = N_SAMPLES - offset;
+
+	fill(fmt);
+
+	ref(SPA_MEMBER(dst[0], offset * size, void), SPA_MEMBER(src, offset * size, void),
+	    &gain[offset], n_samples);
+	f(SPA_MEMBER(dst[1], offset * size, void), SPA_MEMBER(src, offset * size, void),
+	  &gain[offset], n_samples);
+
+	if (memcmp(dst[0], dst[1], sizeof(dst[0])) != 0) {
+		printf("%s: apply_%s offset %d differs from scalar\n",
+		       name, fmt_names[fmt], offset);
+		return -1;
+	}
+	return 0;
+}
+
+static int check_ops(struct impl *ref, struct impl *impl)
+{
+	int fmt, offset, res = 0;
+
+	for (fmt = 0; fmt < VOLUME_FMT_MAX; fmt++) {
+		for (offset = 0; offset < 2; offset++)
+			res |= check(impl->name, fmt, offset,
+				     ref->ops.apply[fmt], impl->ops.apply[fmt]);
+	}
+	return res;
+}
+
+static uint64_t get_time(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * SPA_NSEC_PER_SEC + now.tv_nsec;
+}
+
+static void bench_ops(struct impl *impl)
+{
+	int fmt, i;
+	uint64_t t1, t2;
+
+	for (fmt = 0; fmt < VOLUME_FMT_MAX; fmt++) {
+		fill(fmt);
+
+		t1 = get_time();
+		for (i = 0; i < N_LOOPS; i++)
+			impl->ops.apply[fmt](dst[0], src, gain, N_SAMPLES);
+		t2 = get_time();
+
+		printf("%-6s %s: apply %6.3f ns/sample\n", impl->name, fmt_names[fmt],
+		       (double) (t2 - t1) / (N_LOOPS * N_SAMPLES));
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	struct impl impls[] = {
+		{ "c", 0, },
+#if defined (HAVE_SSE2)
+		{ "sse2", SPA_CPU_FLAG_SSE2, },
+#endif
+#if defined (HAVE_AVX2)
+		{ "avx2", SPA_CPU_FLAG_AVX2, },
+#endif
+#if defined (HAVE_NEON)
+		{ "neon", SPA_CPU_FLAG_NEON, },
+#endif
+	};
+	uint32_t i, cpu_flags;
+	int res = 0;
+
+	cpu_flags = spa_cpu_get_flags();
+	printf("cpu flags 0x%08x\n", cpu_flags);
+
+	for (i = 0; i < SPA_N_ELEMENTS(impls); i++) {
+		struct impl *impl = &impls[i];
+
+		if ((impl->flags & cpu_flags) != impl->flags) {
+			printf("%s: not supported\n", impl->name);
+			continue;
+		}
+		spa_volume_get_ops_flags(&impl->ops, impl->flags);
+
+		if (i > 0 && check_ops(&impls[0], impl) < 0)
+			res = -1;
+
+		bench_ops(impl);
+	}
+	if (res == 0)
+		printf("all functions produce the same results as the scalar ones\n");
+
+	return res;
+}
@@ -46,6 +46,24 @@ struct pw_client_node_area {
 	uint32_t n_output_ports;	/**< number of output ports of the node */
 };
 
+enum pw_client_node_activation_status {
+	PW_CLIENT_NODE_ACTIVATION_AWAKE,	/**< running, checks for messages before sleeping */
+	PW_CLIENT_NODE_ACTIVATION_POLLING,	/**< sleeping in poll on the eventfd */
+};
+
+/** Activation record of the receiving side of a ringbuffer, at the end of
+ * the shared area. The sender only writes the eventfd when the receiver is
+ * sleeping.
+ * \memberof pw_client_node */
+struct pw_client_node_activation {
+	int32_t status;			/**< one of enum pw_client_node_activation_status */
+	uint32_t pending;		/**< messages added since the receiver last checked */
+#define PW_CLIENT_NODE_ACTIVATION_FLAG_IDLE	(1 << 0)	/**< the receiver updates the status,
+								  *  older peers don't */
+	uint32_t flags;
+	uint32_t padding[13];		/**< keep the records in separate cache lines */
+};
+
 /** \class pw_client_node_transport
  *
  * \brief Transport object
@@ -62,6 +80,8 @@ struct pw_client_node_transport {
 	struct spa_ringbuffer *input_buffer;	/**< ringbuffer for input memory */
 	void *output_data;			/**< output memory for ringbuffer */
 	struct spa_ringbuffer *output_buffer;	/**< ringbuffer for output memory */
+	struct pw_client_node_activation *input_activation;	/**< our activation */
+	struct pw_client_node_activation *output_activation;	/**< activation of the peer */
 
 	/** Destroy a transport
 	 * \param trans a transport to destroy
@@ -100,12 +120,34 @@ struct pw_client_node_transport {
 	 * Use this function after \ref next_message().
 	 */
 	int (*parse_message) (struct pw_client_node_transport *trans, void *message);
+
+	/** Wake up the peer
+	 * \param trans the transport
+	 * \param fd the eventfd of the peer
+	 * \return 1 when the peer was woken up, 0 when it was awake, < 0 on error
+	 *
+	 * Call this after \ref add_message(). The eventfd is only written
+	 * when the peer is polling, nothing is done when it is still
+	 * processing messages.
+	 */
+	int (*signal) (struct pw_client_node_transport *trans, int fd);
+
+	/** Prepare to sleep in poll
+	 * \param trans the transport
+	 * \return 0 when the caller can sleep, 1 when new messages arrived
+	 *
+	 * Call this after all messages were read with \ref next_message().
+	 * When 1 is returned, the messages should be read again.
+	 */
+	int (*idle) (struct pw_client_node_transport *trans);
 };
 
 #define pw_client_node_transport_destroy(t)		((t)->destroy((t)))
 #define pw_client_node_transport_add_message(t,m)	((t)->add_message((t), (m)))
 #define pw_client_node_transport_next_message(t,m)	((t)->next_message((t), (m)))
 #define pw_client_node_transport_parse_message(t,m)	((t)->parse_message((t), (m)))
+#define pw_client_node_transport_signal(t,f)		((t)->signal((t), (f)))
+#define pw_client_node_transport_idle(t)		((t)->idle((t)))
 
 enum pw_client_node_message_type {
 	PW_CLIENT_NODE_MESSAGE_HAVE_OUTPUT,		/*< signal that the node has output */
@@ -46,6 +46,7 @@ enum
 static guint pool_signals[LAST_SIGNAL] = { 0 };
 
 static GQuark pool_data_quark;
+static GQuark pool_memory_quark;
 
 GstPipeWirePool *
 gst_pipewire_pool_new (void)
@@ -101,8 +102,22 @@ void gst_pipewire_pool_wrap_buffer (GstPipeWirePool *pool, struct pw_buffer *b)
                                      d->maxsize, NULL, NULL);
       data->offset = 0;
     }
-    if (gmem)
+    if (gmem) {
+      /* find the buffer back when the memory is shared in another buffer */
+      gst_mini_object_set_qdata (GST_MINI_OBJECT_CAST (gmem),
+                                 pool_memory_quark, data, NULL);
       gst_buffer_append_memory (buf, gmem);
+    }
+  }
+
+  /* upstream renders into the buffer with the layout of the caps */
+  if (pool->add_metavideo) {
+    GstVideoInfo *info = &pool->video_info;
+
+    gst_buffer_add_video_meta_full (buf, GST_VIDEO_FRAME_FLAG_NONE,
+        GST_VIDEO_INFO_FORMAT (info), GST_VIDEO_INFO_WIDTH (info),
+        GST_VIDEO_INFO_HEIGHT (info), GST_VIDEO_INFO_N_PLANES (info),
+        info->offset, info->stride);
   }
 
   data->pool = gst_object_ref (pool);
@@ -111,6 +126,7 @@ void gst_pipewire_pool_wrap_buffer (GstPipeWirePool *pool, struct pw_buffer *b)
   data->flags = GST_BUFFER_FLAGS (buf);
   data->b = b;
   data->buf = buf;
+  data->queued = FALSE;
 
   gst_mini_object_set_qdata (GST_MINI_OBJECT_CAST (buf),
                              pool_data_quark,
@@ -119,11 +135,32 @@ void gst_pipewire_pool_wrap_buffer (GstPipeWirePool *pool, struct pw_buffer *b)
   b->user_data = data;
 }
 
+void gst_pipewire_pool_unwrap_buffer (GstPipeWirePool *pool, struct pw_buffer *b)
+{
+  GstPipeWirePoolData *data = b->user_data;
+  guint i, n_mem;
+
+  GST_LOG_OBJECT (pool, "unwrap buffer");
+
+  /* the memory can outlive the pw_buffer */
+  n_mem = gst_buffer_n_memory (data->buf);
+  for (i = 0; i < n_mem; i++)
+    gst_mini_object_set_qdata (GST_MINI_OBJECT_CAST (gst_buffer_peek_memory (data->buf, i)),
+                               pool_memory_quark, NULL, NULL);
+}
+
 GstPipeWirePoolData *gst_pipewire_pool_get_data (GstBuffer *buffer)
 {
   return gst_mini_object_get_qdata (GST_MINI_OBJECT_CAST (buffer), pool_data_quark);
 }
 
+GstPipeWirePoolData *gst_pipewire_pool_get_memory_data (GstMemory *mem)
+{
+  while (mem->parent)
+    mem = mem->parent;
+  return gst_mini_object_get_qdata (GST_MINI_OBJECT_CAST (mem), pool_memory_quark);
+}
+
 #if 0
 gboolean
 gst_pipewire_pool_add_buffer (GstPipeWirePool *pool, GstBuffer *buffer)
@@ -176,6 +213,7 @@ acquire_buffer (GstBufferPool * pool, GstBuffer ** buffer,
   }
 
   data = b->user_data;
+  data->queued = FALSE;
   *buffer = data->buf;
 
   GST_OBJECT_UNLOCK (pool);
@@ -207,6 +245,50 @@ release_buffer (GstBufferPool * pool, GstBuffer *buffer)
   GST_DEBUG ("release buffer %p", buffer);
 }
 
+static const gchar **
+get_options (GstBufferPool * pool)
+{
+  static const gchar *options[] = { GST_BUFFER_POOL_OPTION_VIDEO_META, NULL };
+  return options;
+}
+
+static gboolean
+set_config (GstBufferPool * pool, GstStructure * config)
+{
+  GstPipeWirePool *p = GST_PIPEWIRE_POOL (pool);
+  GstCaps *caps;
+  guint size, min_buffers, max_buffers;
+  GstStructure *structure;
+
+  if (!gst_buffer_pool_config_get_params (config, &caps, &size, &min_buffers, &max_buffers)) {
+    GST_WARNING_OBJECT (pool, "invalid config");
+    return FALSE;
+  }
+
+  p->add_metavideo = FALSE;
+
+  /* video buffers need at least a frame of the caps, the video meta
+   * tells upstream the layout of the frame */
+  if (caps != NULL &&
+      (structure = gst_caps_get_structure (caps, 0)) != NULL &&
+      gst_structure_has_name (structure, "video/x-raw")) {
+    if (!gst_video_info_from_caps (&p->video_info, caps)) {
+      GST_WARNING_OBJECT (pool, "invalid caps %" GST_PTR_FORMAT, caps);
+      return FALSE;
+    }
+    if (size < GST_VIDEO_INFO_SIZE (&p->video_info)) {
+      size = GST_VIDEO_INFO_SIZE (&p->video_info);
+      gst_buffer_pool_config_set_params (config, caps, size, min_buffers, max_buffers);
+    }
+    p->add_metavideo = gst_buffer_pool_config_has_option (config,
+        GST_BUFFER_POOL_OPTION_VIDEO_META);
+  }
+  GST_DEBUG_OBJECT (pool, "size %u, buffers %u-%u, video meta %d", size,
+      min_buffers, max_buffers, p->add_metavideo);
+
+  return GST_BUFFER_POOL_CLASS (gst_pipewire_pool_parent_class)->set_config (pool, config);
+}
+
 static gboolean
 do_start (GstBufferPool * pool)
 {
@@ -234,6 +316,8 @@ gst_pipewire_pool_class_init (GstPipeWirePoolClass * klass)
 
   gobject_class->finalize = gst_pipewire_pool_finalize;
 
+  bufferpool_class->get_options = get_options;
+  bufferpool_class->set_config = set_config;
   bufferpool_class->start = do_start;
   bufferpool_class->flush_start = flush_start;
   bufferpool_class->acquire_buffer = acquire_buffer;
@@ -247,6 +331,7 @@ gst_pipewire_pool_class_init (GstPipeWirePoolClass * klass)
       "debug category for pipewirepool object");
 
   pool_data_quark = g_quark_from_static_string ("GstPipeWirePoolDataQuark");
+  pool_memory_quark = g_quark_from_static_string ("GstPipeWirePoolMemoryQuark");
 }
 
 static void
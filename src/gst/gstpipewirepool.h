@@ -21,6 +21,7 @@
 #define __GST_PIPEWIRE_POOL_H__
 
 #include <gst/gst.h>
+#include <gst/video/video.h>
 
 #include <pipewire/pipewire.h>
 
@@ -51,6 +52,7 @@ struct _GstPipeWirePoolData {
   goffset offset;
   struct pw_buffer *b;
   GstBuffer *buf;
+  gboolean queued;
 };
 
 struct _GstPipeWirePool {
@@ -62,6 +64,9 @@ struct _GstPipeWirePool {
   GstAllocator *fd_allocator;
   GstAllocator *dmabuf_allocator;
 
+  GstVideoInfo video_info;
+  gboolean add_metavideo;
+
   GCond cond;
 };
 
@@ -75,7 +80,10 @@ GstPipeWirePool *  gst_pipewire_pool_new           (void);
 
 void gst_pipewire_pool_wrap_buffer (GstPipeWirePool *pool, struct pw_buffer *buffer);
 
+void gst_pipewire_pool_unwrap_buffer (GstPipeWirePool *pool, struct pw_buffer *buffer);
+
 GstPipeWirePoolData *gst_pipewire_pool_get_data (GstBuffer *buffer);
+GstPipeWirePoolData *gst_pipewire_pool_get_memory_data (GstMemory *mem);
 
 //gboolean        gst_pipewire_pool_add_buffer    (GstPipeWirePool *pool, GstBuffer *buffer);
 //gboolean        gst_pipewire_pool_remove_buffer (GstPipeWirePool *pool, GstBuffer *buffer);
@@ -38,6 +38,8 @@
 #include <fcntl.h>
 #include <sys/socket.h>
 
+#include <gst/video/video.h>
+
 #include "gstpipewireformat.h"
 
 GST_DEBUG_CATEGORY_STATIC (pipewire_sink_debug);
@@ -124,12 +126,48 @@ gst_pipewire_sink_finalize (GObject * object)
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
+/* Propose our pool so that upstream renders straight into the memory of
+ * the PipeWire buffers, then nothing needs to be copied in render */
 static gboolean
 gst_pipewire_sink_propose_allocation (GstBaseSink * bsink, GstQuery * query)
 {
   GstPipeWireSink *pwsink = GST_PIPEWIRE_SINK (bsink);
+  GstBufferPool *pool = GST_BUFFER_POOL_CAST (pwsink->pool);
+  GstStructure *config;
+  GstCaps *caps;
+  gboolean need_pool;
+  guint size = 0, min_buffers = 0, max_buffers = 0;
+
+  gst_query_parse_allocation (query, &caps, &need_pool);
+
+  if (caps == NULL) {
+    GST_DEBUG_OBJECT (pwsink, "no caps specified");
+    return FALSE;
+  }
+
+  config = gst_buffer_pool_get_config (pool);
+  if (gst_buffer_pool_is_active (pool)) {
+    /* the buffers are negotiated with PipeWire already */
+    gst_buffer_pool_config_get_params (config, NULL, &size, &min_buffers, &max_buffers);
+    gst_structure_free (config);
+  } else {
+    gst_buffer_pool_config_set_params (config, caps, 0, 0, 0);
+    gst_buffer_pool_config_add_option (config, GST_BUFFER_POOL_OPTION_VIDEO_META);
+    if (!gst_buffer_pool_set_config (pool, config)) {
+      GST_WARNING_OBJECT (pwsink, "failed to configure the pool for %" GST_PTR_FORMAT, caps);
+      return FALSE;
+    }
+    config = gst_buffer_pool_get_config (pool);
+    gst_buffer_pool_config_get_params (config, NULL, &size, &min_buffers, &max_buffers);
+    gst_structure_free (config);
+  }
+  GST_DEBUG_OBJECT (pwsink, "propose pool, size %u, buffers %u-%u", size,
+      min_buffers, max_buffers);
+
+  gst_query_add_allocation_pool (query, pool, size, min_buffers, max_buffers);
+  if (gst_structure_has_name (gst_caps_get_structure (caps, 0), "video/x-raw"))
+    gst_query_add_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL);
 
-  gst_query_add_allocation_pool (query, GST_BUFFER_POOL_CAST (pwsink->pool), 0, 0, 0);
   return TRUE;
 }
 
@@ -403,14 +441,36 @@ on_add_buffer (void *_data, struct pw_buffer *b)
   pw_thread_loop_signal (pwsink->main_loop, FALSE);
 }
 
+/* Get the pool data of @buffer, a buffer from the pool or a buffer with
+ * the memory of a pool buffer */
+static GstPipeWirePoolData *
+get_buffer_data (GstBuffer *buffer)
+{
+  GstPipeWirePoolData *data;
+
+  if ((data = gst_pipewire_pool_get_data (buffer)) == NULL &&
+      gst_buffer_n_memory (buffer) > 0)
+    data = gst_pipewire_pool_get_memory_data (gst_buffer_peek_memory (buffer, 0));
+  return data;
+}
+
 static void
 on_remove_buffer (void *_data, struct pw_buffer *b)
 {
   GstPipeWireSink *pwsink = _data;
   GstPipeWirePoolData *data = b->user_data;
+  GList *walk, *next;
 
   GST_LOG_OBJECT (pwsink, "remove buffer");
 
+  for (walk = pwsink->queue.head; walk; walk = next) {
+    next = walk->next;
+    if (walk->data != data->buf && get_buffer_data (walk->data) == data) {
+      gst_buffer_unref (walk->data);
+      g_queue_delete_link (&pwsink->queue, walk);
+    }
+  }
+  gst_pipewire_pool_unwrap_buffer (pwsink->pool, b);
   if (g_queue_remove (&pwsink->queue, data->buf))
     gst_buffer_unref (data->buf);
   gst_buffer_unref (data->buf);
@@ -424,6 +484,7 @@ do_send_buffer (GstPipeWireSink *pwsink)
   gboolean res;
   guint i;
   struct spa_buffer *b;
+  GstVideoMeta *vmeta;
 
   buffer = g_queue_pop_head (&pwsink->queue);
   if (buffer == NULL) {
@@ -431,7 +492,7 @@ do_send_buffer (GstPipeWireSink *pwsink)
     return;
   }
 
-  data = gst_pipewire_pool_get_data(buffer);
+  data = get_buffer_data (buffer);
 
   b = data->b->buffer;
 
@@ -440,20 +501,74 @@ do_send_buffer (GstPipeWireSink *pwsink)
     data->header->pts = GST_BUFFER_PTS (buffer);
     data->header->dts_offset = GST_BUFFER_DTS (buffer);
   }
+  /* a shared buffer has its own memory offsets in the pool memory */
+  vmeta = gst_buffer_get_video_meta (buffer);
   for (i = 0; i < b->n_datas; i++) {
     struct spa_data *d = &b->datas[i];
     GstMemory *mem = gst_buffer_peek_memory (buffer, i);
     d->chunk->offset = mem->offset - data->offset;
     d->chunk->size = mem->size;
+    if (vmeta && i < vmeta->n_planes)
+      d->chunk->stride = vmeta->stride[i];
   }
 
   if ((res = pw_stream_queue_buffer (pwsink->stream, data->b)) < 0) {
     g_warning ("can't send buffer %s", spa_strerror(res));
     pw_thread_loop_signal (pwsink->main_loop, FALSE);
-  } else
+  } else {
+    data->queued = TRUE;
     pwsink->need_ready--;
+  }
+
+  /* the memory of a shared buffer is kept by the pool buffer */
+  if (buffer != data->buf)
+    gst_buffer_unref (buffer);
 }
 
+/* Check if @buffer only has the memory of one of our pool buffers.
+ * Upstream can make a new buffer with the memory of one of our buffers,
+ * we can send it without copying the data. */
+static gboolean
+is_shared_buffer (GstPipeWireSink *pwsink, GstBuffer *buffer)
+{
+  GstPipeWirePoolData *data = NULL;
+  guint i, n_mem;
+  GList *walk;
+
+  n_mem = gst_buffer_n_memory (buffer);
+  for (i = 0; i < n_mem; i++) {
+    GstMemory *mem = gst_buffer_peek_memory (buffer, i);
+    GstPipeWirePoolData *d = gst_pipewire_pool_get_memory_data (mem);
+
+    if (d == NULL || d->pool != pwsink->pool || (data && d != data))
+      return FALSE;
+    data = d;
+  }
+  if (data == NULL || data->queued ||
+      n_mem != gst_buffer_n_memory (data->buf) ||
+      n_mem != data->b->buffer->n_datas)
+    return FALSE;
+
+  for (walk = pwsink->queue.head; walk; walk = walk->next) {
+    if (get_buffer_data (walk->data) == data)
+      return FALSE;
+  }
+
+  for (i = 0; i < n_mem; i++) {
+    GstMemory *mem = gst_buffer_peek_memory (buffer, i);
+    GstMemory *root = mem;
+    struct spa_data *d = &data->b->buffer->datas[i];
+
+    while (root->parent)
+      root = root->parent;
+    if (root != gst_buffer_peek_memory (data->buf, i))
+      return FALSE;
+    if (mem->offset < data->offset ||
+        mem->offset + mem->size > data->offset + d->maxsize)
+      return FALSE;
+  }
+  return TRUE;
+}
 
 static void
 on_process (void *data)
@@ -585,7 +700,12 @@ gst_pipewire_sink_render (GstBaseSink * bsink, GstBuffer * buffer)
   if (pw_stream_get_state (pwsink->stream, &error) != PW_STREAM_STATE_STREAMING)
     goto done;
 
-  if (buffer->pool != GST_BUFFER_POOL_CAST (pwsink->pool)) {
+  if (buffer->pool == GST_BUFFER_POOL_CAST (pwsink->pool)) {
+    gst_buffer_ref (buffer);
+  } else if (is_shared_buffer (pwsink, buffer)) {
+    GST_LOG_OBJECT (pwsink, "send shared buffer %p", buffer);
+    gst_buffer_ref (buffer);
+  } else {
     GstBuffer *b = NULL;
     GstMapInfo info = { 0, };
 
@@ -600,8 +720,6 @@ gst_pipewire_sink_render (GstBaseSink * bsink, GstBuffer * buffer)
     gst_buffer_unmap (b, &info);
     gst_buffer_resize (b, 0, gst_buffer_get_size (buffer));
     buffer = b;
-  } else {
-    gst_buffer_ref (buffer);
   }
 
   GST_DEBUG ("push buffer in queue");
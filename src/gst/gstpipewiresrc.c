@@ -376,6 +376,7 @@ on_remove_buffer (void *_data, struct pw_buffer *b)
   GST_LOG_OBJECT (pwsrc, "remove buffer %p", buf);
 
   GST_MINI_OBJECT_CAST (buf)->dispose = NULL;
+  gst_pipewire_pool_unwrap_buffer (pwsrc->pool, b);
 
   walk = pwsrc->queue.head;
   while (walk) {
@@ -36,10 +36,15 @@
 #include "pipewire/type.h"
 #include "pipewire/private.h"
 
+#include "fmt-ops.h"
+
 #define NAME "dsp"
 
 #define MAX_PORTS	256
 #define MAX_BUFFERS	8
+#define MAX_SAMPLES	4096
+
+#define DEFAULT_CHANNELS	2
 
 struct type {
 	struct spa_type_media_type media_type;
@@ -68,6 +73,8 @@ struct impl {
 	struct spa_hook module_listener;
 	struct pw_properties *properties;
 
+	struct spa_audioconvert_ops ops;
+
 	int node_count;
 
 	struct spa_list node_list;
@@ -119,6 +126,13 @@ struct node {
 	int sample_rate;
 	int buffer_size;
 
+	/* the format of the device port */
+	bool have_format;
+	struct spa_audio_info_raw format;
+	uint32_t stride;
+	convert_func_t convert;
+	float silence[MAX_SAMPLES];
+
 	struct spa_node node_impl;
 
 	struct port *in_ports[MAX_PORTS];
@@ -239,27 +253,6 @@ static struct buffer * dequeue_buffer(struct node *n, struct port *p)
         return b;
 }
 
-static void conv_f32_s16(int16_t *out, float *in, int n_samples, int stride)
-{
-	int i;
-	for (i = 0; i < n_samples; i++) {
-		if (in[i] < -1.0f)
-			*out = -32767;
-		else if (in[i] >= 1.0f)
-			*out = 32767;
-		else
-			*out = lrintf(in[i] * 32767.0f);
-		out += stride;
-	}
-}
-static void fill_s16(int16_t *out, int n_samples, int stride)
-{
-	int i;
-	for (i = 0; i < n_samples; i++) {
-		*out = 0;
-		out += stride;
-	}
-}
 #if 0
 static void add_f32(float *out, float *in, int n_samples)
 {
@@ -276,7 +269,8 @@ static int node_process_input(struct spa_node *node)
 	struct port *outp = GET_OUT_PORT(n, 0);
 	struct spa_io_buffers *outio = outp->io;
 	struct buffer *out;
-	int16_t *op;
+	const void *src[MAX_PORTS];
+	void *dst[1];
 	int i;
 
 	pw_log_trace(NAME " %p: process input", this);
@@ -293,27 +287,24 @@ static int node_process_input(struct spa_node *node)
 	outio->buffer_id = out->outbuf->id;
 	outio->status = SPA_STATUS_HAVE_BUFFER;
 
-	op = out->ptr;
-
 	for (i = 0; i < n->n_in_ports; i++) {
 		struct port *inp = GET_IN_PORT(n, i);
 		struct spa_io_buffers *inio = inp->io;
-		struct buffer *in;
-		int stride = 2;
 
-		if (inio->buffer_id < inp->n_buffers && inio->status == SPA_STATUS_HAVE_BUFFER) {
-			in = &inp->buffers[inio->buffer_id];
-			conv_f32_s16(op, in->ptr, n->buffer_size, stride);
-		}
-		else {
-			fill_s16(op, n->buffer_size, stride);
-		}
-		op++;
+		if (inio->buffer_id < inp->n_buffers && inio->status == SPA_STATUS_HAVE_BUFFER)
+			src[i] = inp->buffers[inio->buffer_id].ptr;
+		else
+			src[i] = n->silence;
+
 		inio->status = SPA_STATUS_NEED_BUFFER;
 	}
 
+	/* interleave the channels in the format of the device */
+	dst[0] = out->ptr;
+	n->convert(dst, src, n->n_in_ports, n->buffer_size);
+
 	out->outbuf->datas[0].chunk->offset = 0;
-	out->outbuf->datas[0].chunk->size = n->buffer_size * sizeof(int16_t) * 2;
+	out->outbuf->datas[0].chunk->size = n->buffer_size * n->stride;
 	out->outbuf->datas[0].chunk->stride = 0;
 
 	return outio->status;
@@ -424,7 +415,12 @@ static int port_enum_formats(struct spa_node *node,
 			type->param.idEnumFormat, type->spa_format,
 			"I", t->media_type.audio,
 			"I", t->media_subtype.raw,
-                        ":", t->format_audio.format,   "I", t->audio_format.S16,
+                        ":", t->format_audio.format,   "Ieu", t->audio_format.F32,
+				SPA_POD_PROP_ENUM(5, t->audio_format.F32,
+						     t->audio_format.S16,
+						     t->audio_format.S24_32,
+						     t->audio_format.S32,
+						     t->audio_format.S24),
                         ":", t->format_audio.rate,     "i", n->sample_rate,
                         ":", t->format_audio.channels, "i", n->channels);
 	}
@@ -432,6 +428,37 @@ static int port_enum_formats(struct spa_node *node,
 	return 1;
 }
 
+static int port_get_format(struct spa_node *node,
+			   enum spa_direction direction, uint32_t port_id,
+			   uint32_t *index,
+			   const struct spa_pod *filter,
+			   struct spa_pod **param,
+			   struct spa_pod_builder *builder)
+{
+	struct node *n = SPA_CONTAINER_OF(node, struct node, node_impl);
+	struct port *p = GET_PORT(n, direction, port_id);
+	struct pw_type *type = n->impl->t;
+	struct type *t = &n->impl->type;
+
+	if (SPA_FLAG_CHECK(p->flags, PORT_FLAG_DSP))
+		return port_enum_formats(node, direction, port_id, index, filter, param, builder);
+
+	if (!n->have_format)
+		return -EIO;
+	if (*index > 0)
+		return 0;
+
+	*param = spa_pod_builder_object(builder,
+		type->param.idFormat, type->spa_format,
+		"I", t->media_type.audio,
+		"I", t->media_subtype.raw,
+		":", t->format_audio.format,   "I", n->format.format,
+		":", t->format_audio.rate,     "i", n->format.rate,
+		":", t->format_audio.channels, "i", n->format.channels);
+
+	return 1;
+}
+
 static int port_enum_params(struct spa_node *node,
 			    enum spa_direction direction, uint32_t port_id,
 			    uint32_t id, uint32_t *index,
@@ -454,16 +481,21 @@ static int port_enum_params(struct spa_node *node,
 			return res;
 	}
 	else if (id == t->param.idFormat) {
-		if ((res = port_enum_formats(node, direction, port_id, index, filter, &param, &b)) <= 0)
+		if ((res = port_get_format(node, direction, port_id, index, filter, &param, &b)) <= 0)
 			return res;
 	}
 	else if (id == t->param.idBuffers) {
+		struct port *p = GET_PORT(n, direction, port_id);
+		uint32_t stride = SPA_FLAG_CHECK(p->flags, PORT_FLAG_DSP) ? sizeof(float) : n->stride;
+
+		if (stride == 0)
+			return -EIO;
 		if (*index > 0)
 			return 0;
 
 		param = spa_pod_builder_object(&b,
 			id, t->param_buffers.Buffers,
-			":", t->param_buffers.size,    "i", n->buffer_size * sizeof(float),
+			":", t->param_buffers.size,    "i", n->buffer_size * stride,
 			":", t->param_buffers.stride,  "i", 0,
 			":", t->param_buffers.buffers, "ir", 2,
 				SPA_POD_PROP_MIN_MAX(1, MAX_BUFFERS),
@@ -480,14 +512,35 @@ static int port_enum_params(struct spa_node *node,
 	return 1;
 }
 
+static int get_fmt(struct impl *impl, uint32_t format)
+{
+	struct spa_type_audio_format *af = &impl->type.audio_format;
+
+	if (format == af->S16)
+		return CONV_FMT_S16;
+	else if (format == af->S24)
+		return CONV_FMT_S24;
+	else if (format == af->S24_32)
+		return CONV_FMT_S24_32;
+	else if (format == af->S32)
+		return CONV_FMT_S32;
+	else if (format == af->F32)
+		return CONV_FMT_F32;
+	return -EINVAL;
+}
+
 static int port_set_format(struct spa_node *node, struct port *p,
 			   uint32_t flags, const struct spa_pod *format)
 {
 	struct spa_audio_info info = { 0 };
 	struct node *n = SPA_CONTAINER_OF(node, struct node, node_impl);
-	struct type *t = &n->impl->type;
+	struct impl *impl = n->impl;
+	struct type *t = &impl->type;
+	int fmt;
 
 	if (format == NULL) {
+		if (!SPA_FLAG_CHECK(p->flags, PORT_FLAG_DSP))
+			n->have_format = false;
 		clear_buffers(n, p);
 		return 0;
 	}
@@ -503,6 +556,19 @@ static int port_set_format(struct spa_node *node, struct port *p,
 	if (spa_format_audio_raw_parse(format, &info.info.raw, &t->format_audio) < 0)
 		return -EINVAL;
 
+	if (!SPA_FLAG_CHECK(p->flags, PORT_FLAG_DSP)) {
+		if ((fmt = get_fmt(impl, info.info.raw.format)) < 0 ||
+		    info.info.raw.channels != (uint32_t) n->channels ||
+		    info.info.raw.layout != SPA_AUDIO_LAYOUT_INTERLEAVED)
+			return -EINVAL;
+
+		n->format = info.info.raw;
+		n->stride = spa_audioconvert_fmt_sizes[fmt] * n->channels;
+		n->convert = p->port->direction == PW_DIRECTION_OUTPUT ?
+			impl->ops.from_f32[fmt] : impl->ops.to_f32[fmt];
+		n->have_format = true;
+	}
+
 	pw_log_info(NAME " %p: set format on port %p", n, p);
 
 	return 0;
@@ -734,7 +800,7 @@ static struct port *make_port(struct node *n, enum pw_direction direction,
 }
 
 static struct pw_node *make_node(struct impl *impl, const struct pw_properties *props,
-		enum pw_direction direction)
+		enum pw_direction direction, int channels)
 {
 	struct pw_node *node;
 	struct node *n;
@@ -762,7 +828,7 @@ static struct pw_node *make_node(struct impl *impl, const struct pw_properties *
 	n->node = node;
 	n->impl = impl;
 	n->node_impl = node_impl;
-	n->channels = 2;
+	n->channels = channels;
 	n->sample_rate = 44100;
 	n->buffer_size = 1024 / sizeof(float);
 	pw_node_set_implementation(node, &n->node_impl);
@@ -809,6 +875,23 @@ static struct pw_node *make_node(struct impl *impl, const struct pw_properties *
 	return NULL;
 }
 
+/* the default number of channels of the formats of the device port */
+static int get_channels(struct impl *impl, struct pw_port *port)
+{
+	struct pw_array *formats;
+	struct spa_pod_prop *prop;
+	int channels = DEFAULT_CHANNELS;
+
+	if (pw_port_get_enum_formats(port, &formats) <= 0)
+		return channels;
+
+	prop = spa_pod_find_prop(formats->data, impl->type.format_audio.channels);
+	if (prop != NULL && prop->body.value.type == SPA_POD_TYPE_INT)
+		channels = SPA_POD_VALUE(struct spa_pod_int, &prop->body.value);
+
+	return SPA_CLAMP(channels, 1, MAX_PORTS);
+}
+
 static int on_global(void *data, struct pw_global *global)
 {
 	struct impl *impl = data;
@@ -831,7 +914,8 @@ static int on_global(void *data, struct pw_global *global)
 	if (strcmp(str, "Audio/Sink") == 0) {
 		if ((ip = pw_node_get_free_port(n, PW_DIRECTION_INPUT)) == NULL)
 			return 0;
-		if ((node = make_node(impl, properties, PW_DIRECTION_OUTPUT)) == NULL)
+		if ((node = make_node(impl, properties, PW_DIRECTION_OUTPUT,
+				get_channels(impl, ip))) == NULL)
 			return 0;
 		if ((op = pw_node_get_free_port(node, PW_DIRECTION_OUTPUT)) == NULL)
 			return 0;
@@ -839,7 +923,8 @@ static int on_global(void *data, struct pw_global *global)
 	else if (strcmp(str, "Audio/Source") == 0) {
 		if ((op = pw_node_get_free_port(n, PW_DIRECTION_OUTPUT)) == NULL)
 			return 0;
-		if ((node = make_node(impl, properties, PW_DIRECTION_INPUT)) == NULL)
+		if ((node = make_node(impl, properties, PW_DIRECTION_INPUT,
+				get_channels(impl, op))) == NULL)
 			return 0;
 		if ((ip = pw_node_get_free_port(node, PW_DIRECTION_INPUT)) == NULL)
 			return 0;
@@ -914,6 +999,7 @@ static int module_init(struct pw_module *module, struct pw_properties *propertie
 	impl->properties = properties;
 
 	init_type(&impl->type, core->type.map);
+	spa_audioconvert_get_ops(&impl->ops);
 
 	spa_list_init(&impl->node_list);
 
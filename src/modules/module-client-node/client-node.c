@@ -155,8 +155,11 @@ static struct mem *ensure_mem(struct impl *impl, int fd, uint32_t type, uint32_t
 	struct mem *m, *f = NULL;
 
 	pw_array_for_each(m, &impl->mems) {
-		if (m->ref <= 0)
-			f = m;
+		if (m->ref <= 0) {
+			/* with the id of the same memory, the client keeps its mapping */
+			if (f == NULL || f->fd != fd)
+				f = m;
+		}
 		else if (m->fd == fd)
 			goto found;
 	}
@@ -266,10 +269,8 @@ static int impl_node_set_param(struct spa_node *node, uint32_t id, uint32_t flag
 
 static inline void do_flush(struct node *this)
 {
-	uint64_t cmd = 1;
-	if (write(this->writefd, &cmd, 8) != 8)
+	if (pw_client_node_transport_signal(this->impl->transport, this->writefd) < 0)
 		spa_log_warn(this->log, "node %p: error flushing : %s", this, strerror(errno));
-
 }
 
 static int impl_node_send_command(struct spa_node *node, const struct spa_command *command)
@@ -1081,11 +1082,13 @@ static void node_on_data_fd_events(struct spa_source *source)
 			spa_log_warn(this->log, "node %p: error reading message: %s",
 					this, strerror(errno));
 
-		while (pw_client_node_transport_next_message(impl->transport, &message) == 1) {
-			struct pw_client_node_message *msg = alloca(SPA_POD_SIZE(&message));
-			pw_client_node_transport_parse_message(impl->transport, msg);
-			handle_node_message(this, msg);
-		}
+		do {
+			while (pw_client_node_transport_next_message(impl->transport, &message) == 1) {
+				struct pw_client_node_message *msg = alloca(SPA_POD_SIZE(&message));
+				pw_client_node_transport_parse_message(impl->transport, msg);
+				handle_node_message(this, msg);
+			}
+		} while (pw_client_node_transport_idle(impl->transport));
 	}
 }
 
@@ -39,6 +39,9 @@ struct transport {
 	struct pw_memblock *mem;
 	size_t offset;
 
+	/* used when the area of the peer has no activation records */
+	struct pw_client_node_activation activation[2];
+
 	struct pw_client_node_message current;
 	uint32_t current_index;
 };
@@ -54,6 +57,8 @@ static size_t area_get_size(struct pw_client_node_area *area)
 	size += INPUT_BUFFER_SIZE;
 	size += sizeof(struct spa_ringbuffer);
 	size += OUTPUT_BUFFER_SIZE;
+	/* at the end, older peers don't know about them */
+	size += 2 * sizeof(struct pw_client_node_activation);
 	return size;
 }
 
@@ -81,6 +86,12 @@ static void transport_setup_area(void *p, struct pw_client_node_transport *trans
 
 	trans->output_data = p;
 	p = SPA_MEMBER(p, OUTPUT_BUFFER_SIZE, void);
+
+	trans->input_activation = p;
+	p = SPA_MEMBER(p, sizeof(struct pw_client_node_activation), void);
+
+	trans->output_activation = p;
+	p = SPA_MEMBER(p, sizeof(struct pw_client_node_activation), void);
 }
 
 static void transport_reset_area(struct pw_client_node_transport *trans)
@@ -98,6 +109,15 @@ static void transport_reset_area(struct pw_client_node_transport *trans)
 	}
 	spa_ringbuffer_init(trans->input_buffer);
 	spa_ringbuffer_init(trans->output_buffer);
+
+	/* nobody is running yet, the first message needs a wakeup. The peer
+	 * sets the IDLE flag when it knows about the activation records */
+	trans->input_activation->status = PW_CLIENT_NODE_ACTIVATION_POLLING;
+	trans->input_activation->pending = 0;
+	trans->input_activation->flags = PW_CLIENT_NODE_ACTIVATION_FLAG_IDLE;
+	trans->output_activation->status = PW_CLIENT_NODE_ACTIVATION_POLLING;
+	trans->output_activation->pending = 0;
+	trans->output_activation->flags = 0;
 }
 
 static void destroy(struct pw_client_node_transport *trans)
@@ -176,6 +196,48 @@ static int parse_message(struct pw_client_node_transport *trans, void *message)
 	return 0;
 }
 
+static int signal_peer(struct pw_client_node_transport *trans, int fd)
+{
+	struct pw_client_node_activation *a = trans->output_activation;
+	uint64_t cmd = 1;
+	int32_t status;
+
+	/* an older peer always polls the eventfd */
+	if (!(a->flags & PW_CLIENT_NODE_ACTIVATION_FLAG_IDLE)) {
+		if (write(fd, &cmd, sizeof(cmd)) != sizeof(cmd))
+			return -errno;
+		return 1;
+	}
+
+	/* the pending count must be visible before the status is read, the
+	 * peer does the opposite in idle() so that either it sees the new
+	 * message or we see it sleeping */
+	__atomic_fetch_add(&a->pending, 1, __ATOMIC_SEQ_CST);
+	status = __atomic_exchange_n(&a->status, PW_CLIENT_NODE_ACTIVATION_AWAKE,
+				     __ATOMIC_SEQ_CST);
+
+	if (status != PW_CLIENT_NODE_ACTIVATION_POLLING)
+		return 0;
+
+	if (write(fd, &cmd, sizeof(cmd)) != sizeof(cmd))
+		return -errno;
+	return 1;
+}
+
+static int idle(struct pw_client_node_transport *trans)
+{
+	struct pw_client_node_activation *a = trans->input_activation;
+
+	__atomic_store_n(&a->status, PW_CLIENT_NODE_ACTIVATION_POLLING, __ATOMIC_SEQ_CST);
+	if (__atomic_exchange_n(&a->pending, 0, __ATOMIC_SEQ_CST) == 0)
+		return 0;
+
+	/* messages were added since we last looked, they might not have been
+	 * read yet */
+	__atomic_store_n(&a->status, PW_CLIENT_NODE_ACTIVATION_AWAKE, __ATOMIC_SEQ_CST);
+	return 1;
+}
+
 /** Create a new transport
  * \param max_input_ports maximum number of input_ports
  * \param max_output_ports maximum number of output_ports
@@ -218,6 +280,8 @@ pw_client_node_transport_new(uint32_t max_input_ports, uint32_t max_output_ports
 	trans->add_message = add_message;
 	trans->next_message = next_message;
 	trans->parse_message = parse_message;
+	trans->signal = signal_peer;
+	trans->idle = idle;
 
 	return trans;
 }
@@ -259,10 +323,26 @@ pw_client_node_transport_new_from_info(struct pw_client_node_transport_info *inf
 	trans->output_data = trans->input_data;
 	trans->input_data = tmp;
 
+	if (impl->mem->size >= area_get_size(trans->area)) {
+		tmp = trans->output_activation;
+		trans->output_activation = trans->input_activation;
+		trans->input_activation = tmp;
+		__atomic_or_fetch(&trans->input_activation->flags,
+				  PW_CLIENT_NODE_ACTIVATION_FLAG_IDLE, __ATOMIC_SEQ_CST);
+	} else {
+		/* an older peer, it always writes the eventfd and expects us
+		 * to write it */
+		pw_log_debug("transport %p: no activation records", impl);
+		trans->input_activation = &impl->activation[0];
+		trans->output_activation = &impl->activation[1];
+	}
+
 	trans->destroy = destroy;
 	trans->add_message = add_message;
 	trans->next_message = next_message;
 	trans->parse_message = parse_message;
+	trans->signal = signal_peer;
+	trans->idle = idle;
 
 	return trans;
 
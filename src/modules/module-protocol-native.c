@@ -107,33 +107,43 @@ struct client_data {
 	bool busy;
 };
 
-static bool pod_remap_data(uint32_t type, void *body, uint32_t size, struct pw_map *types)
+/* ids below n_identity are static types that have the same id in the peer */
+static inline bool remap_id(uint32_t *id, struct pw_map *types, uint32_t n_identity)
 {
 	void *t;
 
+	if (*id < n_identity)
+		return true;
+	if ((t = pw_map_lookup(types, *id)) == NULL)
+		return false;
+	*id = PW_MAP_PTR_TO_ID(t);
+	return true;
+}
+
+static bool pod_remap_data(uint32_t type, void *body, uint32_t size, struct pw_map *types,
+			   uint32_t n_identity)
+{
 	switch (type) {
 	case SPA_POD_TYPE_ID:
-		if ((t = pw_map_lookup(types, *(int32_t *) body)) == NULL)
+		if (!remap_id(body, types, n_identity))
 			return false;
-		*(int32_t *) body = PW_MAP_PTR_TO_ID(t);
 		break;
 
 	case SPA_POD_TYPE_PROP:
 	{
 		struct spa_pod_prop_body *b = body;
 
-		if ((t = pw_map_lookup(types, b->key)) == NULL)
+		if (!remap_id(&b->key, types, n_identity))
 			return false;
-		b->key = PW_MAP_PTR_TO_ID(t);
 
 		if (b->value.type == SPA_POD_TYPE_ID) {
 			void *alt;
 			if (!pod_remap_data
-			    (b->value.type, SPA_POD_BODY(&b->value), b->value.size, types))
+			    (b->value.type, SPA_POD_BODY(&b->value), b->value.size, types, n_identity))
 				return false;
 
 			SPA_POD_PROP_ALTERNATIVE_FOREACH(b, size, alt)
-				if (!pod_remap_data(b->value.type, alt, b->value.size, types))
+				if (!pod_remap_data(b->value.type, alt, b->value.size, types, n_identity))
 					return false;
 		}
 		break;
@@ -143,17 +153,14 @@ static bool pod_remap_data(uint32_t type, void *body, uint32_t size, struct pw_m
 		struct spa_pod_object_body *b = body;
 		struct spa_pod *p;
 
-		if ((t = pw_map_lookup(types, b->id)) != NULL)
-			b->id = PW_MAP_PTR_TO_ID(t);
-		else
+		if (!remap_id(&b->id, types, n_identity))
 			b->id = SPA_ID_INVALID;
 
-		if ((t = pw_map_lookup(types, b->type)) == NULL)
+		if (!remap_id(&b->type, types, n_identity))
 			return false;
-		b->type = PW_MAP_PTR_TO_ID(t);
 
 		SPA_POD_OBJECT_BODY_FOREACH(b, size, p)
-			if (!pod_remap_data(p->type, SPA_POD_BODY(p), p->size, types))
+			if (!pod_remap_data(p->type, SPA_POD_BODY(p), p->size, types, n_identity))
 				return false;
 		break;
 	}
@@ -162,7 +169,7 @@ static bool pod_remap_data(uint32_t type, void *body, uint32_t size, struct pw_m
 		struct spa_pod *b = body, *p;
 
 		SPA_POD_FOREACH(b, size, p)
-			if (!pod_remap_data(p->type, SPA_POD_BODY(p), p->size, types))
+			if (!pod_remap_data(p->type, SPA_POD_BODY(p), p->size, types, n_identity))
 				return false;
 		break;
 	}
@@ -172,6 +179,12 @@ static bool pod_remap_data(uint32_t type, void *body, uint32_t size, struct pw_m
 	return true;
 }
 
+/* when all the types of the peer have our ids, there is nothing to remap */
+static inline bool need_remap(struct pw_map *types, uint32_t n_identity)
+{
+	return n_identity < pw_map_get_size(types);
+}
+
 static void
 process_messages(struct client_data *data)
 {
@@ -226,8 +239,10 @@ process_messages(struct client_data *data)
 			continue;
 		}
 
-		if (demarshal[opcode].flags & PW_PROTOCOL_NATIVE_REMAP)
-			if (!pod_remap_data(SPA_POD_TYPE_STRUCT, message, size, &client->types))
+		if ((demarshal[opcode].flags & PW_PROTOCOL_NATIVE_REMAP) &&
+		    need_remap(&client->types, client->n_identity_types))
+			if (!pod_remap_data(SPA_POD_TYPE_STRUCT, message, size,
+					    &client->types, client->n_identity_types))
 				goto invalid_message;
 
 		if (debug_messages) {
@@ -564,8 +579,10 @@ on_remote_data(void *data, int fd, enum spa_io mask)
 				continue;
 			}
 
-			if (demarshal[opcode].flags & PW_PROTOCOL_NATIVE_REMAP) {
-				if (!pod_remap_data(SPA_POD_TYPE_STRUCT, message, size, &this->types)) {
+			if ((demarshal[opcode].flags & PW_PROTOCOL_NATIVE_REMAP) &&
+			    need_remap(&this->types, this->n_identity_types)) {
+				if (!pod_remap_data(SPA_POD_TYPE_STRUCT, message, size,
+						    &this->types, this->n_identity_types)) {
                                         pw_log_error
                                             ("protocol-native %p: invalid message received %u for %u", this,
                                              opcode, id);
@@ -112,6 +112,33 @@ static void core_marshal_get_registry(void *object, uint32_t version, uint32_t n
 	pw_protocol_native_end_proxy(proxy, b);
 }
 
+static void core_marshal_get_registry_filtered(void *object, uint32_t version,
+					       const struct spa_dict *filter, uint32_t new_id)
+{
+	struct pw_proxy *proxy = object;
+	struct spa_pod_builder *b;
+	uint32_t i, n_items;
+
+	b = pw_protocol_native_begin_proxy(proxy, PW_CORE_PROXY_METHOD_GET_REGISTRY_FILTERED);
+
+	n_items = filter ? filter->n_items : 0;
+
+	spa_pod_builder_add(b,
+			    "[",
+			    "i", version,
+			    "i", new_id,
+			    "i", n_items, NULL);
+
+	for (i = 0; i < n_items; i++) {
+		spa_pod_builder_add(b,
+				    "s", filter->items[i].key,
+				    "s", filter->items[i].value, NULL);
+	}
+	spa_pod_builder_add(b, "]", NULL);
+
+	pw_protocol_native_end_proxy(proxy, b);
+}
+
 static void
 core_marshal_create_object(void *object,
 			   const char *factory_name,
@@ -470,6 +497,34 @@ static int core_demarshal_get_registry(void *object, void *data, size_t size)
 	return 0;
 }
 
+static int core_demarshal_get_registry_filtered(void *object, void *data, size_t size)
+{
+	struct pw_resource *resource = object;
+	struct spa_pod_parser prs;
+	struct spa_dict filter;
+	uint32_t version, new_id, i;
+
+	spa_pod_parser_init(&prs, data, size, 0);
+	if (spa_pod_parser_get(&prs,
+			"["
+			"i", &version,
+			"i", &new_id,
+			"i", &filter.n_items, NULL) < 0)
+		return -EINVAL;
+
+	filter.items = alloca(filter.n_items * sizeof(struct spa_dict_item));
+	for (i = 0; i < filter.n_items; i++) {
+		if (spa_pod_parser_get(&prs,
+				"s", &filter.items[i].key,
+				"s", &filter.items[i].value,
+				NULL) < 0)
+			return -EINVAL;
+	}
+	pw_resource_do(resource, struct pw_core_proxy_methods, get_registry_filtered, 1,
+		       version, &filter, new_id);
+	return 0;
+}
+
 static int core_demarshal_create_object(void *object, void *data, size_t size)
 {
 	struct pw_resource *resource = object;
@@ -582,6 +637,41 @@ static void registry_marshal_global_remove(void *object, uint32_t id)
 	pw_protocol_native_end_resource(resource, b);
 }
 
+static void registry_marshal_snapshot(void *object, uint32_t n_globals,
+				      const struct pw_registry_global *globals)
+{
+	struct pw_resource *resource = object;
+	struct spa_pod_builder *b;
+	uint32_t i, j;
+
+	b = pw_protocol_native_begin_resource(resource, PW_REGISTRY_PROXY_EVENT_SNAPSHOT);
+
+	spa_pod_builder_add(b, "[ i", n_globals, NULL);
+
+	for (i = 0; i < n_globals; i++) {
+		const struct pw_registry_global *g = &globals[i];
+
+		spa_pod_builder_add(b,
+				    "[",
+				    "i", g->id,
+				    "i", g->parent_id,
+				    "i", g->permissions,
+				    "I", g->type,
+				    "i", g->version,
+				    "i", g->props.n_items, NULL);
+
+		for (j = 0; j < g->props.n_items; j++) {
+			spa_pod_builder_add(b,
+					    "s", g->props.items[j].key,
+					    "s", g->props.items[j].value, NULL);
+		}
+		spa_pod_builder_add(b, "]", NULL);
+	}
+	spa_pod_builder_add(b, "]", NULL);
+
+	pw_protocol_native_end_resource(resource, b);
+}
+
 static int registry_demarshal_bind(void *object, void *data, size_t size)
 {
 	struct pw_resource *resource = object;
@@ -1144,6 +1234,65 @@ static int registry_demarshal_global_remove(void *object, void *data, size_t siz
 	return 0;
 }
 
+/* the snapshot is delivered as a global event for each global */
+static int registry_demarshal_snapshot(void *object, void *data, size_t size)
+{
+	struct pw_proxy *proxy = object;
+	struct spa_pod_parser prs;
+	uint32_t id, parent_id, permissions, type, version, n_globals, i, j;
+	struct spa_dict props;
+	struct spa_dict_item *items = NULL;
+	uint32_t max_items = 0;
+	int res = 0;
+
+	spa_pod_parser_init(&prs, data, size, 0);
+	if (spa_pod_parser_get(&prs, "[ i", &n_globals, NULL) < 0)
+		return -EINVAL;
+
+	for (i = 0; i < n_globals; i++) {
+		if (spa_pod_parser_get(&prs,
+				"["
+				"i", &id,
+				"i", &parent_id,
+				"i", &permissions,
+				"I", &type,
+				"i", &version,
+				"i", &props.n_items, NULL) < 0)
+			goto invalid;
+
+		if (props.n_items > max_items) {
+			void *p = realloc(items, props.n_items * sizeof(struct spa_dict_item));
+			if (p == NULL) {
+				res = -ENOMEM;
+				goto exit;
+			}
+			items = p;
+			max_items = props.n_items;
+		}
+		props.items = items;
+
+		for (j = 0; j < props.n_items; j++) {
+			if (spa_pod_parser_get(&prs,
+					       "s", &items[j].key,
+					       "s", &items[j].value, NULL) < 0)
+				goto invalid;
+		}
+		if (spa_pod_parser_get(&prs, "]", NULL) < 0)
+			goto invalid;
+
+		pw_proxy_notify(proxy, struct pw_registry_proxy_events,
+				global, 0, id, parent_id, permissions, type, version,
+				props.n_items > 0 ? &props : NULL);
+	}
+      exit:
+	free(items);
+	return res;
+
+      invalid:
+	res = -EINVAL;
+	goto exit;
+}
+
 static void registry_marshal_bind(void *object, uint32_t id,
 				  uint32_t type, uint32_t version, uint32_t new_id)
 {
@@ -1171,6 +1320,7 @@ static const struct pw_core_proxy_methods pw_protocol_native_core_method_marshal
 	&core_marshal_permissions,
 	&core_marshal_create_object,
 	&core_marshal_destroy,
+	&core_marshal_get_registry_filtered,
 };
 
 static const struct pw_protocol_native_demarshal pw_protocol_native_core_method_demarshal[PW_CORE_PROXY_METHOD_NUM] = {
@@ -1181,7 +1331,8 @@ static const struct pw_protocol_native_demarshal pw_protocol_native_core_method_
 	{ &core_demarshal_client_update, 0, },
 	{ &core_demarshal_permissions, 0, },
 	{ &core_demarshal_create_object, PW_PROTOCOL_NATIVE_REMAP, },
-	{ &core_demarshal_destroy, 0, }
+	{ &core_demarshal_destroy, 0, },
+	{ &core_demarshal_get_registry_filtered, 0, },
 };
 
 static const struct pw_core_proxy_events pw_protocol_native_core_event_marshal = {
@@ -1225,11 +1376,13 @@ static const struct pw_registry_proxy_events pw_protocol_native_registry_event_m
 	PW_VERSION_REGISTRY_PROXY_EVENTS,
 	&registry_marshal_global,
 	&registry_marshal_global_remove,
+	&registry_marshal_snapshot,
 };
 
 static const struct pw_protocol_native_demarshal pw_protocol_native_registry_event_demarshal[] = {
 	{ &registry_demarshal_global, PW_PROTOCOL_NATIVE_REMAP, },
-	{ &registry_demarshal_global_remove, 0, }
+	{ &registry_demarshal_global_remove, 0, },
+	{ &registry_demarshal_snapshot, PW_PROTOCOL_NATIVE_REMAP, },
 };
 
 const struct pw_protocol_marshal pw_protocol_native_registry_marshal = {
@@ -50,6 +50,7 @@ struct impl {
 	struct spa_source source;
 
 	struct spa_hook module_listener;
+	struct spa_hook core_listener;
 };
 
 /***
@@ -382,6 +383,7 @@ static void module_destroy(void *data)
 	struct impl *impl = data;
 
 	spa_hook_remove(&impl->module_listener);
+	spa_hook_remove(&impl->core_listener);
 
 	if (impl->properties)
 		pw_properties_free(impl->properties);
@@ -394,15 +396,13 @@ static const struct pw_module_events module_events = {
 	.destroy = module_destroy,
 };
 
-static void idle_func(struct spa_source *source)
+static void make_realtime(void)
 {
-	struct impl *impl = source->data;
 	struct sched_param sp;
 	struct pw_rtkit_bus *system_bus;
 	struct rlimit rl;
 	int r, rtprio;
 	long long rttime;
-	uint64_t count;
 
 	rtprio = 20;
 	rttime = 20000;
@@ -437,10 +437,37 @@ static void idle_func(struct spa_source *source)
 		pw_log_debug("thread made realtime");
 	}
 	pw_rtkit_bus_free(system_bus);
+}
+
+static void idle_func(struct spa_source *source)
+{
+	struct impl *impl = source->data;
+	uint64_t count;
+
+	make_realtime();
 
 	read(impl->source.fd, &count, sizeof(uint64_t));
 }
 
+static int
+do_make_realtime(struct spa_loop *loop,
+		 bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	make_realtime();
+	return 0;
+}
+
+static void core_data_loop_added(void *data, struct pw_loop *loop)
+{
+	pw_log_debug("loop %p: make realtime", loop);
+	pw_loop_invoke(loop, do_make_realtime, 1, NULL, 0, true, data);
+}
+
+static const struct pw_core_events core_events = {
+	PW_VERSION_CORE_EVENTS,
+	.data_loop_added = core_data_loop_added,
+};
+
 static int module_init(struct pw_module *module, struct pw_properties *properties)
 {
 	struct pw_core *core = pw_module_get_core(module);
@@ -473,6 +500,7 @@ static int module_init(struct pw_module *module, struct pw_properties *propertie
 	impl->source.mask = SPA_IO_IN;
 	spa_loop_add_source(impl->loop, &impl->source);
 
+	pw_core_add_listener(core, &impl->core_listener, &core_events, impl);
 	pw_module_add_listener(module, &impl->module_listener, &module_events, impl);
 
 	return 0;
@@ -20,11 +20,14 @@
 #include <unistd.h>
 #include <time.h>
 #include <stdio.h>
+#include <limits.h>
+#include <inttypes.h>
 
 #include <pipewire/log.h>
 
 #include <spa/support/dbus.h>
 #include <spa/debug/format.h>
+#include <spa/pod/filter.h>
 
 #include <pipewire/pipewire.h>
 #include <pipewire/private.h>
@@ -36,12 +39,54 @@
 #undef spa_debug
 #define spa_debug pw_log_trace
 #include <spa/graph/graph-scheduler6.h>
+#include <spa/graph/graph-scheduler7.h>
+#include <spa/graph/graph-scheduler8.h>
 
 /** \cond */
+#define MAX_WORKERS	64
+#define MAX_IDLE_MEMBLOCKS	8
+#define SNAPSHOT_MAX_SIZE	(32 * 1024)
+
+/* buffer memory of an owner, kept when not in use so that the owner can
+ * get it back without allocating and mapping new memory */
+struct mem_cache_entry {
+	const void *owner;		/**< owner or NULL when not cached */
+	enum pw_memblock_flags flags;
+	size_t size;			/**< requested size */
+	struct pw_memblock *mem;	/**< the memory or NULL for a free entry */
+	bool in_use;
+};
+
+struct worker {
+	struct pw_data_loop *loop;
+	struct spa_source *event;
+	struct spa_graph_parallel *parallel;
+	uint32_t id;
+};
+
+struct impl {
+	struct pw_core this;
+
+	struct spa_graph_sorted sorted;
+
+	struct spa_graph_parallel parallel;
+	struct spa_graph_worker *graph_workers;
+	struct worker workers[MAX_WORKERS];
+	uint32_t n_workers;
+};
+
 struct resource_data {
 	struct spa_hook resource_listener;
 };
 
+struct registry_data {
+	struct spa_hook resource_listener;
+	uint32_t *types;		/**< types to announce, NULL for all */
+	int n_types;
+	char **keys;			/**< property keys to send, NULL for all */
+	int n_keys;
+};
+
 /** \endcond */
 
 static void registry_bind(void *object, uint32_t id,
@@ -94,7 +139,13 @@ static const struct pw_registry_proxy_methods registry_methods = {
 static void destroy_registry_resource(void *object)
 {
 	struct pw_resource *resource = object;
+	struct registry_data *data = pw_resource_get_user_data(resource);
+
 	spa_list_remove(&resource->link);
+
+	free(data->types);
+	if (data->keys)
+		pw_free_strv(data->keys);
 }
 
 static const struct pw_resource_events resource_events = {
@@ -134,14 +185,234 @@ static void core_sync(void *object, uint32_t seq)
 	pw_core_resource_done(resource, seq);
 }
 
-static void core_get_registry(void *object, uint32_t version, uint32_t new_id)
+static bool registry_filter_type(struct registry_data *data, uint32_t type)
+{
+	int i;
+
+	if (data->types == NULL)
+		return true;
+	for (i = 0; i < data->n_types; i++) {
+		if (data->types[i] == type)
+			return true;
+	}
+	return false;
+}
+
+static bool registry_filter_key(struct registry_data *data, const char *key)
+{
+	int i;
+
+	for (i = 0; i < data->n_keys; i++) {
+		if (strcmp(data->keys[i], key) == 0)
+			return true;
+	}
+	return false;
+}
+
+/* fill dict with the properties of the global that pass the filter, items
+ * must have space for all the properties of the global */
+static const struct spa_dict *
+registry_filter_props(struct registry_data *data, struct pw_global *global,
+		      struct spa_dict *dict, struct spa_dict_item *items)
+{
+	const struct spa_dict *props;
+	uint32_t i;
+
+	props = global->properties ? &global->properties->dict : NULL;
+	if (data->keys == NULL || props == NULL)
+		return props;
+
+	dict->items = items;
+	dict->n_items = 0;
+	for (i = 0; i < props->n_items; i++) {
+		if (registry_filter_key(data, props->items[i].key))
+			items[dict->n_items++] = props->items[i];
+	}
+	return dict;
+}
+
+static uint32_t registry_get_permissions(struct pw_resource *registry, struct pw_global *global)
+{
+	struct registry_data *data = pw_resource_get_user_data(registry);
+
+	if (!registry_filter_type(data, global->type))
+		return 0;
+
+	return pw_global_get_permissions(global, registry->client);
+}
+
+/** Announce a global on a registry
+ *
+ * \param registry a registry resource
+ * \param global the global to announce
+ *
+ * The global is only announced when the client can read it and when
+ * it passes the filter of the registry.
+ */
+void pw_core_registry_global(struct pw_resource *registry, struct pw_global *global)
+{
+	struct registry_data *data = pw_resource_get_user_data(registry);
+	uint32_t permissions = registry_get_permissions(registry, global);
+	const struct spa_dict *props;
+	struct spa_dict dict;
+	struct spa_dict_item *items;
+
+	pw_log_debug("registry %p: global %d %08x", registry, global->id, permissions);
+	if (!PW_PERM_IS_R(permissions))
+		return;
+
+	items = alloca((global->properties ? global->properties->dict.n_items : 0) *
+			sizeof(struct spa_dict_item));
+	props = registry_filter_props(data, global, &dict, items);
+
+	pw_registry_resource_global(registry,
+				    global->id,
+				    global->parent->id,
+				    permissions,
+				    global->type,
+				    global->version,
+				    props);
+}
+
+/** Announce the removal of a global on a registry
+ *
+ * \param registry a registry resource
+ * \param global the global that is removed
+ */
+void pw_core_registry_global_remove(struct pw_resource *registry, struct pw_global *global)
+{
+	uint32_t permissions = registry_get_permissions(registry, global);
+
+	pw_log_debug("registry %p: global remove %d %08x", registry, global->id, permissions);
+	if (PW_PERM_IS_R(permissions))
+		pw_registry_resource_global_remove(registry, global->id);
+}
+
+/* a guess of the size of the global in a snapshot message */
+static size_t snapshot_global_size(const struct pw_registry_global *g)
+{
+	size_t size = 8 + 6 * 16;
+	uint32_t i;
+
+	for (i = 0; i < g->props.n_items; i++) {
+		const struct spa_dict_item *it = &g->props.items[i];
+		size += 8 + SPA_ROUND_UP_N(strlen(it->key) + 1, 8);
+		size += 8 + SPA_ROUND_UP_N((it->value ? strlen(it->value) : 0) + 1, 8);
+	}
+	return size;
+}
+
+/* send all the globals the registry can see in snapshot events, the
+ * messages are kept below SNAPSHOT_MAX_SIZE */
+static int registry_snapshot(struct pw_resource *registry)
+{
+	struct registry_data *data = pw_resource_get_user_data(registry);
+	struct pw_core *this = registry->core;
+	struct pw_global *global;
+	struct pw_registry_global *globals, *g, *first;
+	struct spa_dict_item *items;
+	uint32_t n_globals = 0, n_items = 0;
+	size_t size = 0, global_size;
+
+	spa_list_for_each(global, &this->global_list, link) {
+		if (!PW_PERM_IS_R(registry_get_permissions(registry, global)))
+			continue;
+		n_globals++;
+		if (data->keys != NULL && global->properties)
+			n_items += global->properties->dict.n_items;
+	}
+
+	globals = malloc(n_globals * sizeof(struct pw_registry_global) +
+			 n_items * sizeof(struct spa_dict_item));
+	if (globals == NULL)
+		return -ENOMEM;
+
+	g = first = globals;
+	items = SPA_MEMBER(globals, n_globals * sizeof(struct pw_registry_global),
+			   struct spa_dict_item);
+
+	spa_list_for_each(global, &this->global_list, link) {
+		const struct spa_dict *props;
+		uint32_t permissions = registry_get_permissions(registry, global);
+
+		if (!PW_PERM_IS_R(permissions))
+			continue;
+
+		g->id = global->id;
+		g->parent_id = global->parent->id;
+		g->permissions = permissions;
+		g->type = global->type;
+		g->version = global->version;
+
+		props = registry_filter_props(data, global, &g->props, items);
+		if (props == NULL)
+			g->props = SPA_DICT_INIT(NULL, 0);
+		else if (props != &g->props)
+			g->props = *props;
+		else
+			items += g->props.n_items;
+
+		global_size = snapshot_global_size(g);
+		if (g > first && size + global_size > SNAPSHOT_MAX_SIZE) {
+			pw_log_debug("registry %p: snapshot of %zd globals", registry, g - first);
+			pw_registry_resource_snapshot(registry, g - first, first);
+			first = g;
+			size = 0;
+		}
+		size += global_size;
+		g++;
+	}
+
+	pw_log_debug("registry %p: snapshot of %zd globals of %u", registry, g - first, n_globals);
+	pw_registry_resource_snapshot(registry, g - first, first);
+
+	free(globals);
+
+	return 0;
+}
+
+static int registry_parse_filter(struct pw_core *core, struct registry_data *data,
+				 const struct spa_dict *filter)
+{
+	const char *str;
+	char **types;
+	int i;
+
+	if (filter == NULL)
+		return 0;
+
+	if ((str = spa_dict_lookup(filter, PW_REGISTRY_FILTER_TYPES)) != NULL) {
+		types = pw_split_strv(str, ",", INT_MAX, &data->n_types);
+		if (types == NULL)
+			return -ENOMEM;
+
+		data->types = calloc(SPA_MAX(data->n_types, 1), sizeof(uint32_t));
+		if (data->types == NULL) {
+			pw_free_strv(types);
+			return -ENOMEM;
+		}
+		for (i = 0; i < data->n_types; i++)
+			data->types[i] = spa_type_map_get_id(core->type.map, types[i]);
+
+		pw_free_strv(types);
+	}
+	if ((str = spa_dict_lookup(filter, PW_REGISTRY_FILTER_PROPERTIES)) != NULL) {
+		data->keys = pw_split_strv(str, ",", INT_MAX, &data->n_keys);
+		if (data->keys == NULL)
+			return -ENOMEM;
+	}
+	return 0;
+}
+
+static void core_get_registry_filtered(void *object, uint32_t version,
+				       const struct spa_dict *filter, uint32_t new_id)
 {
 	struct pw_resource *resource = object;
 	struct pw_client *client = resource->client;
 	struct pw_core *this = resource->core;
 	struct pw_global *global;
 	struct pw_resource *registry_resource;
-	struct resource_data *data;
+	struct registry_data *data;
 
 	registry_resource = pw_resource_new(client,
 					    new_id,
@@ -164,28 +435,33 @@ static void core_get_registry(void *object, uint32_t version, uint32_t new_id)
 
 	spa_list_append(&this->registry_resource_list, &registry_resource->link);
 
-	spa_list_for_each(global, &this->global_list, link) {
-		uint32_t permissions = pw_global_get_permissions(global, client);
-		if (PW_PERM_IS_R(permissions)) {
-			pw_registry_resource_global(registry_resource,
-						    global->id,
-						    global->parent->id,
-						    permissions,
-						    global->type,
-						    global->version,
-						    global->properties ?
-						        &global->properties->dict : NULL);
-		}
+	if (registry_parse_filter(this, data, filter) < 0)
+		goto no_mem_destroy;
+
+	if (version >= 1) {
+		if (registry_snapshot(registry_resource) < 0)
+			goto no_mem_destroy;
+	}
+	else {
+		spa_list_for_each(global, &this->global_list, link)
+			pw_core_registry_global(registry_resource, global);
 	}
 
 	return;
 
+      no_mem_destroy:
+	pw_resource_destroy(registry_resource);
       no_mem:
 	pw_log_error("can't create registry resource");
 	pw_core_resource_error(client->core_resource,
 			       resource->id, -ENOMEM, "no memory");
 }
 
+static void core_get_registry(void *object, uint32_t version, uint32_t new_id)
+{
+	core_get_registry_filtered(object, version, NULL, new_id);
+}
+
 static void
 core_create_object(void *object,
 		   const char *factory_name,
@@ -276,6 +552,8 @@ static void core_update_types(void *object, uint32_t first_id, const char **type
 		uint32_t this_id = spa_type_map_get_id(this->type.map, types[i]);
 		if (!pw_map_insert_at(&client->types, first_id, PW_MAP_ID_TO_PTR(this_id)))
 			pw_log_error("can't add type %d->%d for client", first_id, this_id);
+		else if (first_id == client->n_identity_types && this_id == first_id)
+			client->n_identity_types++;
 	}
 }
 
@@ -289,6 +567,7 @@ static const struct pw_core_proxy_methods core_methods = {
 	.permissions = core_permissions,
 	.create_object = core_create_object,
 	.destroy = core_destroy,
+	.get_registry_filtered = core_get_registry_filtered,
 };
 
 static void core_unbind_func(void *data)
@@ -352,6 +631,88 @@ static const struct pw_global_events global_events = {
 	.bind = global_bind,
 };
 
+static void do_work(void *data, uint64_t count)
+{
+	struct worker *w = data;
+	spa_graph_parallel_work(w->parallel, w->id);
+}
+
+static void do_wakeup(void *data)
+{
+	struct impl *impl = data;
+	uint32_t i;
+
+	for (i = 1; i < impl->n_workers; i++)
+		pw_loop_signal_event(pw_data_loop_get_loop(impl->workers[i].loop),
+				     impl->workers[i].event);
+}
+
+static const struct spa_graph_parallel_callbacks parallel_callbacks = {
+	SPA_VERSION_GRAPH_PARALLEL_CALLBACKS,
+	.wakeup = do_wakeup,
+};
+
+static int init_parallel(struct impl *impl, struct pw_properties *properties)
+{
+	struct pw_core *this = &impl->this;
+	const char *str;
+	uint32_t i, n_workers;
+
+	if ((str = pw_properties_get(properties, PW_CORE_PROP_DATA_LOOPS)) != NULL)
+		n_workers = atoi(str);
+	else
+		n_workers = sysconf(_SC_NPROCESSORS_ONLN);
+
+	n_workers = SPA_CLAMP(n_workers, 1, MAX_WORKERS);
+
+	impl->graph_workers = calloc(n_workers, sizeof(struct spa_graph_worker));
+	if (impl->graph_workers == NULL)
+		return -ENOMEM;
+
+	/* worker 0 is the thread that runs the graph cycle */
+	impl->workers[0].loop = this->data_loop_impl;
+	impl->n_workers = 1;
+
+	for (i = 1; i < n_workers; i++) {
+		struct worker *w = &impl->workers[i];
+
+		w->loop = pw_data_loop_new(properties);
+		if (w->loop == NULL)
+			break;
+
+		w->parallel = &impl->parallel;
+		w->id = i;
+		w->event = pw_loop_add_event(pw_data_loop_get_loop(w->loop), do_work, w);
+		impl->n_workers++;
+	}
+
+	spa_graph_parallel_init(&impl->parallel, &this->rt.graph,
+				impl->graph_workers, impl->n_workers,
+				&parallel_callbacks, impl);
+
+	for (i = 1; i < impl->n_workers; i++)
+		pw_data_loop_start(impl->workers[i].loop);
+
+	pw_log_info("core %p: using parallel graph scheduler with %d workers",
+		    this, impl->n_workers);
+
+	return 0;
+}
+
+static void clear_parallel(struct impl *impl)
+{
+	uint32_t i;
+
+	for (i = 1; i < impl->n_workers; i++) {
+		struct worker *w = &impl->workers[i];
+		pw_data_loop_stop(w->loop);
+		pw_loop_destroy_source(pw_data_loop_get_loop(w->loop), w->event);
+		pw_data_loop_destroy(w->loop);
+	}
+	impl->n_workers = 0;
+	free(impl->graph_workers);
+}
+
 /** Create a new core object
  *
  * \param main_loop the main loop to use
@@ -362,13 +723,16 @@ static const struct pw_global_events global_events = {
  */
 struct pw_core *pw_core_new(struct pw_loop *main_loop, struct pw_properties *properties)
 {
+	struct impl *impl;
 	struct pw_core *this;
-	const char *name;
+	const char *name, *str;
 
-	this = calloc(1, sizeof(struct pw_core));
-	if (this == NULL)
+	impl = calloc(1, sizeof(struct impl));
+	if (impl == NULL)
 		return NULL;
 
+	this = &impl->this;
+
 	pw_log_debug("core %p: new", this);
 
 	if (properties == NULL)
@@ -389,7 +753,18 @@ struct pw_core *pw_core_new(struct pw_loop *main_loop, struct pw_properties *pro
 	pw_map_init(&this->globals, 128, 32);
 
 	spa_graph_init(&this->rt.graph);
-	spa_graph_set_callbacks(&this->rt.graph, &spa_graph_impl_default, NULL);
+	str = pw_properties_get(properties, PW_CORE_PROP_SCHEDULER);
+	if (str != NULL && strcmp(str, "sorted") == 0) {
+		pw_log_info("core %p: using sorted graph scheduler", this);
+		spa_graph_sorted_init(&impl->sorted, &this->rt.graph);
+		spa_graph_set_callbacks(&this->rt.graph, &spa_graph_impl_sorted, &impl->sorted);
+	}
+	else if (str != NULL && strcmp(str, "parallel") == 0 &&
+	    init_parallel(impl, properties) == 0) {
+		spa_graph_set_callbacks(&this->rt.graph, &spa_graph_impl_parallel, &impl->parallel);
+	}
+	else
+		spa_graph_set_callbacks(&this->rt.graph, &spa_graph_impl_default, NULL);
 
 	this->dbus_iface = pw_get_spa_dbus(this->main_loop);
 
@@ -419,6 +794,8 @@ struct pw_core *pw_core_new(struct pw_loop *main_loop, struct pw_properties *pro
 	spa_list_init(&this->control_list[1]);
 	spa_hook_list_init(&this->listener_list);
 
+	pw_array_init(&this->mem_cache.blocks, 8 * sizeof(struct mem_cache_entry));
+
 	if ((name = pw_properties_get(properties, PW_CORE_PROP_NAME)) == NULL) {
 		pw_properties_setf(properties,
 				   PW_CORE_PROP_NAME, "pipewire-%s-%d",
@@ -458,7 +835,7 @@ struct pw_core *pw_core_new(struct pw_loop *main_loop, struct pw_properties *pro
 
       no_mem:
       no_data_loop:
-	free(this);
+	free(impl);
 	return NULL;
 }
 
@@ -470,10 +847,12 @@ struct pw_core *pw_core_new(struct pw_loop *main_loop, struct pw_properties *pro
  */
 void pw_core_destroy(struct pw_core *core)
 {
+	struct impl *impl = SPA_CONTAINER_OF(core, struct impl, this);
 	struct pw_global *global, *t;
 	struct pw_module *module, *tm;
 	struct pw_remote *remote, *tr;
 	struct pw_node *node, *tn;
+	struct mem_cache_entry *e;
 
 	pw_log_debug("core %p: destroy", core);
 	pw_core_events_destroy(core);
@@ -494,6 +873,9 @@ void pw_core_destroy(struct pw_core *core)
 
 	pw_core_events_free(core);
 
+	if (impl->n_workers > 0)
+		clear_parallel(impl);
+
 	pw_data_loop_destroy(core->data_loop_impl);
 
 	pw_release_spa_dbus(core->dbus_iface);
@@ -502,6 +884,12 @@ void pw_core_destroy(struct pw_core *core)
 
 	pw_map_clear(&core->globals);
 
+	pw_array_for_each(e, &core->mem_cache.blocks) {
+		if (e->mem)
+			pw_memblock_free(e->mem);
+	}
+	pw_array_clear(&core->mem_cache.blocks);
+
 	pw_log_debug("core %p: free", core);
 	free(core);
 }
@@ -521,7 +909,17 @@ void pw_core_add_listener(struct pw_core *core,
 			  const struct pw_core_events *events,
 			  void *data)
 {
+	struct impl *impl = SPA_CONTAINER_OF(core, struct impl, this);
+	uint32_t i;
+
 	spa_hook_list_append(&core->listener_list, listener, events, data);
+
+	/* the workers were made before anyone could listen, announce them so
+	 * that they get the same priority as the data loop */
+	if (events->data_loop_added) {
+		for (i = 1; i < impl->n_workers; i++)
+			events->data_loop_added(data, pw_data_loop_get_loop(impl->workers[i].loop));
+	}
 }
 
 struct pw_type *pw_core_get_type(struct pw_core *core)
@@ -767,40 +1165,37 @@ int pw_core_find_format(struct pw_core *core,
 			goto error;
 		}
 	} else if (in_state == PW_PORT_STATE_CONFIGURE && out_state == PW_PORT_STATE_CONFIGURE) {
-		struct spa_pod_builder fb = { 0 };
-		uint8_t fbuf[4096];
-		struct spa_pod *filter;
-	      again:
-		/* both ports need a format */
-		pw_log_debug("core %p: do enum input %d", core, iidx);
-		spa_pod_builder_init(&fb, fbuf, sizeof(fbuf));
-		if ((res = spa_node_port_enum_params(input->node->node,
-						     input->direction, input->port_id,
-						     t->param.idEnumFormat, &iidx,
-						     NULL, &filter, &fb)) <= 0) {
-			if (res == 0 && iidx == 0) {
-				asprintf(error, "error input enum formats: %s", spa_strerror(res));
-				goto error;
-			}
-			asprintf(error, "no more input formats");
+		struct pw_array *in_formats, *out_formats;
+		struct spa_pod *in, *out;
+
+		/* both ports need a format, intersect the cached formats of the ports */
+		if ((res = pw_port_get_enum_formats(input, &in_formats)) <= 0) {
+			asprintf(error, "error input enum formats: %s", spa_strerror(res));
 			goto error;
 		}
-		pw_log_debug("enum output %d with filter: %p", oidx, filter);
-		if (pw_log_level_enabled(SPA_LOG_LEVEL_DEBUG))
-			spa_debug_format(2, core->type.map, filter);
+		if ((res = pw_port_get_enum_formats(output, &out_formats)) <= 0) {
+			asprintf(error, "error output enum formats: %s", spa_strerror(res));
+			goto error;
+		}
+		pw_log_debug("core %p: format cache hits %"PRIu64" misses %"PRIu64, core,
+				core->format_cache.hits, core->format_cache.misses);
 
-		if ((res = spa_node_port_enum_params(output->node->node,
-						     output->direction, output->port_id,
-						     t->param.idEnumFormat, &oidx,
-						     filter, format, builder)) <= 0) {
-			if (res == 0) {
-				oidx = 0;
-				goto again;
+		SPA_POD_FOREACH(in_formats->data, in_formats->size, in) {
+			pw_log_debug("enum output with filter: %p", in);
+			if (pw_log_level_enabled(SPA_LOG_LEVEL_DEBUG))
+				spa_debug_format(2, core->type.map, in);
+
+			SPA_POD_FOREACH(out_formats->data, out_formats->size, out) {
+				if (spa_pod_filter(builder, format, out, in) >= 0)
+					goto found;
 			}
-			asprintf(error, "error output enum formats: %d", res);
-			goto error;
 		}
+		res = 0;
+		asprintf(error, "no more input formats");
+		goto error;
 
+	      found:
+		res = 1;
 		pw_log_debug("Got filtered:");
 		if (pw_log_level_enabled(SPA_LOG_LEVEL_DEBUG))
 			spa_debug_format(2, core->type.map, *format);
@@ -817,6 +1212,105 @@ int pw_core_find_format(struct pw_core *core,
 	return res;
 }
 
+/** Get the counters of the format cache
+ *
+ * \param core the core object
+ * \param[out] hits number of times the formats of a port were cached
+ * \param[out] misses number of times the formats of a port were enumerated
+ *
+ * \memberof pw_core
+ */
+void pw_core_get_format_cache_stats(struct pw_core *core, uint64_t *hits, uint64_t *misses)
+{
+	*hits = core->format_cache.hits;
+	*misses = core->format_cache.misses;
+}
+
+int pw_core_alloc_memblock(struct pw_core *core, const void *owner,
+			   enum pw_memblock_flags flags, size_t size,
+			   struct pw_memblock **mem)
+{
+	struct mem_cache_entry *e, *f = NULL;
+	int res;
+
+	/* the layout of the buffers is made again in the memory, the size
+	 * is all that needs to match */
+	pw_array_for_each(e, &core->mem_cache.blocks) {
+		if (e->mem == NULL) {
+			f = e;
+			continue;
+		}
+		if (e->in_use || e->owner != owner || e->flags != flags || e->size != size)
+			continue;
+
+		e->in_use = true;
+		core->mem_cache.n_idle--;
+		core->mem_cache.hits++;
+		*mem = e->mem;
+		pw_log_debug("core %p: reuse mem %p for %p, hits %"PRIu64" misses %"PRIu64,
+				core, e->mem, owner, core->mem_cache.hits, core->mem_cache.misses);
+		return 0;
+	}
+
+	if ((res = pw_memblock_alloc(flags, size, mem)) < 0)
+		return res;
+
+	if (f == NULL &&
+	    (f = pw_array_add(&core->mem_cache.blocks, sizeof(struct mem_cache_entry))) == NULL) {
+		pw_memblock_free(*mem);
+		return -ENOMEM;
+	}
+	f->owner = owner;
+	f->flags = flags;
+	f->size = size;
+	f->mem = *mem;
+	f->in_use = true;
+
+	core->mem_cache.misses++;
+	pw_log_debug("core %p: new mem %p for %p, hits %"PRIu64" misses %"PRIu64,
+			core, *mem, owner, core->mem_cache.hits, core->mem_cache.misses);
+
+	return 0;
+}
+
+void pw_core_release_memblock(struct pw_core *core, struct pw_memblock *mem)
+{
+	struct mem_cache_entry *e;
+
+	pw_array_for_each(e, &core->mem_cache.blocks) {
+		if (e->mem != mem)
+			continue;
+
+		if (e->owner == NULL || core->mem_cache.n_idle >= MAX_IDLE_MEMBLOCKS) {
+			pw_memblock_free(mem);
+			e->mem = NULL;
+		}
+		else {
+			e->in_use = false;
+			core->mem_cache.n_idle++;
+		}
+		return;
+	}
+	pw_memblock_free(mem);
+}
+
+void pw_core_clear_memblocks(struct pw_core *core, const void *owner)
+{
+	struct mem_cache_entry *e;
+
+	pw_array_for_each(e, &core->mem_cache.blocks) {
+		if (e->mem == NULL || e->owner != owner)
+			continue;
+
+		e->owner = NULL;
+		if (!e->in_use) {
+			pw_memblock_free(e->mem);
+			e->mem = NULL;
+			core->mem_cache.n_idle--;
+		}
+	}
+}
+
 /** Find a factory by name
  *
  * \param core the core object
@@ -85,7 +85,7 @@ struct pw_core;
 
 /** core events emited by the core object added with \ref pw_core_add_listener */
 struct pw_core_events {
-#define PW_VERSION_CORE_EVENTS	0
+#define PW_VERSION_CORE_EVENTS	1
 	uint32_t version;
 
 	/** The core is being destroyed */
@@ -98,6 +98,8 @@ struct pw_core_events {
 	void (*global_added) (void *data, struct pw_global *global);
 	/** a global object was removed */
 	void (*global_removed) (void *data, struct pw_global *global);
+	/** a new data thread was started, running \a loop. Since version 1 */
+	void (*data_loop_added) (void *data, struct pw_loop *loop);
 };
 
 /** The user name that started the core */
@@ -110,6 +112,12 @@ struct pw_core_events {
 #define PW_CORE_PROP_VERSION	"pipewire.core.version"
 /** If the core should listen for connections, boolean default false */
 #define PW_CORE_PROP_DAEMON	"pipewire.daemon"
+/** The graph scheduler to use, "default", "sorted" or "parallel".
+ * Default is "default" */
+#define PW_CORE_PROP_SCHEDULER	"pipewire.core.scheduler"
+/** The number of data threads of the parallel scheduler. Default is the
+ * number of online CPUs */
+#define PW_CORE_PROP_DATA_LOOPS	"pipewire.core.data-loops"
 
 /** Make a new core object for a given main_loop. Ownership of the properties is taken */
 struct pw_core * pw_core_new(struct pw_loop *main_loop, struct pw_properties *props);
@@ -156,6 +164,9 @@ int pw_core_for_each_global(struct pw_core *core,	/**< the core */
 struct pw_global *pw_core_find_global(struct pw_core *core,	/**< the core */
 				      uint32_t id		/**< the global id */);
 
+/** Get the hit and miss counters of the format cache */
+void pw_core_get_format_cache_stats(struct pw_core *core, uint64_t *hits, uint64_t *misses);
+
 /** Find a factory by name */
 struct pw_factory *
 pw_core_find_factory(struct pw_core *core	/**< the core */,
@@ -119,19 +119,8 @@ pw_global_register(struct pw_global *global,
 	pw_log_debug("global %p: add %u owner %p parent %p", global, global->id, owner, parent);
 	pw_core_events_global_added(core, global);
 
-	spa_list_for_each(registry, &core->registry_resource_list, link) {
-		uint32_t permissions = pw_global_get_permissions(global, registry->client);
-		pw_log_debug("registry %p: global %d %08x", registry, global->id, permissions);
-		if (PW_PERM_IS_R(permissions))
-			pw_registry_resource_global(registry,
-						    global->id,
-						    global->parent->id,
-						    permissions,
-						    global->type,
-						    global->version,
-						    global->properties ?
-						        &global->properties->dict : NULL);
-	}
+	spa_list_for_each(registry, &core->registry_resource_list, link)
+		pw_core_registry_global(registry, global);
 	return 0;
 }
 
@@ -233,12 +222,8 @@ void pw_global_destroy(struct pw_global *global)
 	pw_global_events_destroy(global);
 
 	if (global->id != SPA_ID_INVALID) {
-		spa_list_for_each(registry, &core->registry_resource_list, link) {
-			uint32_t permissions = pw_global_get_permissions(global, registry->client);
-			pw_log_debug("registry %p: global %d %08x", registry, global->id, permissions);
-			if (PW_PERM_IS_R(permissions))
-				pw_registry_resource_global_remove(registry, global->id);
-		}
+		spa_list_for_each(registry, &core->registry_resource_list, link)
+			pw_core_registry_global_remove(registry, global);
 
 		pw_map_remove(&core->globals, global->id);
 
@@ -66,7 +66,7 @@ struct pw_link_proxy;
 #define PW_TYPE_INTERFACE__Client	PW_TYPE_INTERFACE_BASE "Client"
 #define PW_TYPE_INTERFACE__Link		PW_TYPE_INTERFACE_BASE "Link"
 
-#define PW_VERSION_CORE				0
+#define PW_VERSION_CORE				1
 
 #define PW_CORE_PROXY_METHOD_HELLO		0
 #define PW_CORE_PROXY_METHOD_UPDATE_TYPES	1
@@ -76,7 +76,8 @@ struct pw_link_proxy;
 #define PW_CORE_PROXY_METHOD_PERMISSIONS	5
 #define PW_CORE_PROXY_METHOD_CREATE_OBJECT	6
 #define PW_CORE_PROXY_METHOD_DESTROY		7
-#define PW_CORE_PROXY_METHOD_NUM		8
+#define PW_CORE_PROXY_METHOD_GET_REGISTRY_FILTERED	8
+#define PW_CORE_PROXY_METHOD_NUM		9
 
 /**
  * Key to update default permissions of globals without specific
@@ -112,7 +113,7 @@ struct pw_link_proxy;
  * also used for internal features.
  */
 struct pw_core_proxy_methods {
-#define PW_VERSION_CORE_PROXY_METHODS	0
+#define PW_VERSION_CORE_PROXY_METHODS	1
 	uint32_t version;
 	/**
 	 * Start a conversation with the server. This will send
@@ -193,6 +194,18 @@ struct pw_core_proxy_methods {
 	 * \param id the object id to destroy
 	 */
 	void (*destroy) (void *object, uint32_t id);
+	/**
+	 * Get a registry object with a filter
+	 *
+	 * Like get_registry but the registry will only announce the globals
+	 * and properties selected by \a filter. See \ref PW_REGISTRY_FILTER_TYPES
+	 * and \ref PW_REGISTRY_FILTER_PROPERTIES.
+	 * \param version the registry version
+	 * \param filter the filter properties or NULL
+	 * \param new_id the client proxy id
+	 */
+	void (*get_registry_filtered) (void *object, uint32_t version,
+				       const struct spa_dict *filter, uint32_t new_id);
 };
 
 static inline void
@@ -221,6 +234,16 @@ pw_core_proxy_get_registry(struct pw_core_proxy *core, uint32_t type, uint32_t v
 	return (struct pw_registry_proxy *) p;
 }
 
+static inline struct pw_registry_proxy *
+pw_core_proxy_get_registry_filtered(struct pw_core_proxy *core, uint32_t type, uint32_t version,
+				    const struct spa_dict *filter, size_t user_data_size)
+{
+	struct pw_proxy *p = pw_proxy_new((struct pw_proxy*)core, type, user_data_size);
+	pw_proxy_do((struct pw_proxy*)core, struct pw_core_proxy_methods, get_registry_filtered,
+		    version, filter, pw_proxy_get_id(p));
+	return (struct pw_registry_proxy *) p;
+}
+
 static inline void
 pw_core_proxy_client_update(struct pw_core_proxy *core, const struct spa_dict *props)
 {
@@ -337,7 +360,7 @@ pw_core_proxy_add_listener(struct pw_core_proxy *core,
 #define pw_core_resource_info(r,...)         pw_resource_notify(r,struct pw_core_proxy_events,info,__VA_ARGS__)
 
 
-#define PW_VERSION_REGISTRY			0
+#define PW_VERSION_REGISTRY			1
 
 /** \page page_registry Registry
  *
@@ -359,6 +382,14 @@ pw_core_proxy_add_listener(struct pw_core_proxy *core,
  * events, the client can use the pw_core.sync methosd immediately
  * after calling pw_core.get_registry.
  *
+ * Since version 1, the globals that exist when the registry is created
+ * are sent in snapshot events with many globals each instead of one
+ * global event per global. The proxy emits a global event for each of
+ * the globals in the snapshots.
+ *
+ * With pw_core.get_registry_filtered, a client can select the interface
+ * types and the properties of the globals it wants to be informed about.
+ *
  * A client can bind to a global object by using the bind
  * request.  This creates a client-side proxy that lets the object
  * emit events to the client and lets the client invoke methods on
@@ -370,6 +401,13 @@ pw_core_proxy_add_listener(struct pw_core_proxy *core,
  * can, for example, hide certain existing or new objects or limit
  * the access permissions on an object.
  */
+/** Comma separated list of interface types to announce,
+ * when not given, all globals are announced */
+#define PW_REGISTRY_FILTER_TYPES		"registry.filter.types"
+/** Comma separated list of global property keys to send,
+ * when not given, all properties are sent */
+#define PW_REGISTRY_FILTER_PROPERTIES		"registry.filter.properties"
+
 #define PW_REGISTRY_PROXY_METHOD_BIND		0
 #define PW_REGISTRY_PROXY_METHOD_NUM		1
 
@@ -406,11 +444,22 @@ pw_registry_proxy_bind(struct pw_registry_proxy *registry,
 
 #define PW_REGISTRY_PROXY_EVENT_GLOBAL             0
 #define PW_REGISTRY_PROXY_EVENT_GLOBAL_REMOVE      1
-#define PW_REGISTRY_PROXY_EVENT_NUM                2
+#define PW_REGISTRY_PROXY_EVENT_SNAPSHOT           2
+#define PW_REGISTRY_PROXY_EVENT_NUM                3
+
+/** A global in a registry snapshot */
+struct pw_registry_global {
+	uint32_t id;			/**< the global object id */
+	uint32_t parent_id;		/**< the parent global id */
+	uint32_t permissions;		/**< the permissions of the object */
+	uint32_t type;			/**< the type of the interface */
+	uint32_t version;		/**< the version of the interface */
+	struct spa_dict props;		/**< extra properties of the global */
+};
 
 /** Registry events */
 struct pw_registry_proxy_events {
-#define PW_VERSION_REGISTRY_PROXY_EVENTS	0
+#define PW_VERSION_REGISTRY_PROXY_EVENTS	1
 	uint32_t version;
 	/**
 	 * Notify of a new global object
@@ -438,6 +487,19 @@ struct pw_registry_proxy_events {
 	 * \param id the id of the global that was removed
 	 */
 	void (*global_remove) (void *object, uint32_t id);
+	/**
+	 * Notify of the current global objects
+	 *
+	 * Emited when the registry is created, with the globals that are
+	 * available at that moment. Many globals are split over several
+	 * snapshot events to keep the messages small. The client side
+	 * protocol delivers each of the globals as a global event.
+	 *
+	 * \param n_globals the number of globals
+	 * \param globals the globals
+	 */
+	void (*snapshot) (void *object, uint32_t n_globals,
+			  const struct pw_registry_global *globals);
 };
 
 static inline void
@@ -451,6 +513,7 @@ pw_registry_proxy_add_listener(struct pw_registry_proxy *registry,
 
 #define pw_registry_resource_global(r,...)        pw_resource_notify(r,struct pw_registry_proxy_events,global,__VA_ARGS__)
 #define pw_registry_resource_global_remove(r,...) pw_resource_notify(r,struct pw_registry_proxy_events,global_remove,__VA_ARGS__)
+#define pw_registry_resource_snapshot(r,...)      pw_resource_notify(r,struct pw_registry_proxy_events,snapshot,__VA_ARGS__)
 
 
 #define PW_VERSION_MODULE			0
@@ -38,6 +38,11 @@
 
 #define MAX_BUFFERS     16
 
+/* the data of the buffers is aligned to at least a cache line */
+#define CACHE_LINE_SIZE		64
+/* pools of at least this size are backed with huge pages when possible */
+#define HUGEPAGE_POOL_SIZE	(8 * 1024 * 1024)
+
 /** \cond */
 struct impl {
 	struct pw_link this;
@@ -102,6 +107,14 @@ static void complete_paused(void *obj, void *data, int res, uint32_t id)
 	}
 }
 
+static void complete_mix(void *obj, void *data, int res, uint32_t id)
+{
+	struct pw_port *port = data;
+	if ((res = pw_port_start_mix(port, res)) < 0)
+		pw_log_warn("port %p: failed to start mixing: %d (%s)", port,
+			    res, spa_strerror(res));
+}
+
 static void complete_streaming(void *obj, void *data, int res, uint32_t id)
 {
 	struct pw_port *port = data;
@@ -304,13 +317,19 @@ static struct spa_pod *find_param(struct spa_pod **params, uint32_t n_params, ui
  *    | |   uint32_t size              |
  *    | |   int32_t stride             |
  *    | | ... <n_datas> chunks         |
- *    | +------------------------------+
- *    +>| data                         | memory for n_datas data
- *      | ... <n_datas> blocks         |
+ *    | +==============================+
+ *    | | ... <n_buffers>              | repeated for each buffer, each
+ *    | +==============================+ buffer starts on a cache line
+ *    +>| data                         | memory for n_datas data, each
+ *      | ... <n_datas> blocks         | block starts on \a data_align
  *      +==============================+
  *      | ... <n_buffers>              | repeated for each buffer
  *      +==============================+
  *
+ * The metas and chunks are kept away from the data so that the headers
+ * written by one side don't share cache lines with the data written by
+ * the other side.
+ *
  * The shared memory block should not contain any types or structure,
  * just the actual metadata contents.
  */
@@ -321,18 +340,20 @@ static int alloc_buffers(struct pw_link *this,
 			 uint32_t n_datas,
 			 size_t *data_sizes,
 			 ssize_t *data_strides,
+			 size_t data_align,
 			 struct allocation *allocation)
 {
 	int res;
 	struct spa_buffer **buffers, *bp;
 	uint32_t i;
-	size_t skel_size, data_size, meta_size;
+	size_t skel_size, header_size, data_size, meta_size, data_offset, total_size;
 	struct spa_chunk *cdp;
 	void *ddp;
 	uint32_t n_metas;
 	struct spa_meta *metas;
 	struct pw_memblock *m;
 	struct pw_type *t = &this->core->type;
+	enum pw_memblock_flags flags;
 
 	n_metas = data_size = meta_size = 0;
 
@@ -359,23 +380,40 @@ static int alloc_buffers(struct pw_link *this,
 			skel_size += sizeof(struct spa_meta);
 		}
 	}
-	data_size += meta_size;
+
+	if (data_align < CACHE_LINE_SIZE || (data_align & (data_align - 1)) != 0)
+		data_align = CACHE_LINE_SIZE;
+
+	/* metas and chunks of a buffer */
+	header_size = SPA_ROUND_UP_N(meta_size + n_datas * sizeof(struct spa_chunk),
+				     CACHE_LINE_SIZE);
 
 	/* data */
 	for (i = 0; i < n_datas; i++) {
-		data_size += sizeof(struct spa_chunk);
-		data_size += data_sizes[i];
+		data_size += SPA_ROUND_UP_N(data_sizes[i], data_align);
 		skel_size += sizeof(struct spa_data);
 	}
 
+	data_offset = SPA_ROUND_UP_N(n_buffers * header_size, data_align);
+	total_size = data_offset + n_buffers * data_size;
+
+	flags = PW_MEMBLOCK_FLAG_WITH_FD |
+		PW_MEMBLOCK_FLAG_MAP_READWRITE |
+		PW_MEMBLOCK_FLAG_SEAL;
+	if (total_size >= HUGEPAGE_POOL_SIZE)
+		flags |= PW_MEMBLOCK_FLAG_HUGEPAGES;
+
 	buffers = calloc(n_buffers, skel_size + sizeof(struct spa_buffer *));
 	/* pointer to buffer structures */
 	bp = SPA_MEMBER(buffers, n_buffers * sizeof(struct spa_buffer *), struct spa_buffer);
 
-	if ((res = pw_memblock_alloc(PW_MEMBLOCK_FLAG_WITH_FD |
-				     PW_MEMBLOCK_FLAG_MAP_READWRITE |
-				     PW_MEMBLOCK_FLAG_SEAL, n_buffers * data_size, &m)) < 0)
+	if ((res = pw_core_alloc_memblock(this->core, this, flags, total_size, &m)) < 0) {
+		free(buffers);
 		return res;
+	}
+
+	pw_log_debug("link %p: %d buffers of %zd header and %zd data, align %zd", this,
+		     n_buffers, header_size, data_size, data_align);
 
 	for (i = 0; i < n_buffers; i++) {
 		int j;
@@ -384,7 +422,7 @@ static int alloc_buffers(struct pw_link *this,
 
 		buffers[i] = b = SPA_MEMBER(bp, skel_size * i, struct spa_buffer);
 
-		p = SPA_MEMBER(m->ptr, data_size * i, void);
+		p = SPA_MEMBER(m->ptr, header_size * i, void);
 
 		b->id = i;
 		b->n_metas = n_metas;
@@ -402,7 +440,7 @@ static int alloc_buffers(struct pw_link *this,
 		b->datas = SPA_MEMBER(b->metas, n_metas * sizeof(struct spa_meta), struct spa_data);
 
 		cdp = p;
-		ddp = SPA_MEMBER(cdp, sizeof(struct spa_chunk) * n_datas, void);
+		ddp = SPA_MEMBER(m->ptr, data_offset + data_size * i, void);
 
 		for (j = 0; j < n_datas; j++) {
 			struct spa_data *d = &b->datas[j];
@@ -418,7 +456,7 @@ static int alloc_buffers(struct pw_link *this,
 				d->chunk->offset = 0;
 				d->chunk->size = 0;
 				d->chunk->stride = data_strides[j];
-				ddp += data_sizes[j];
+				ddp += SPA_ROUND_UP_N(data_sizes[j], data_align);
 			} else {
 				/* needs to be allocated by a node */
 				d->type = SPA_ID_INVALID;
@@ -429,6 +467,7 @@ static int alloc_buffers(struct pw_link *this,
 	allocation->mem = m;
 	allocation->n_buffers = n_buffers;
 	allocation->buffers = buffers;
+	allocation->core = this->core;
 
 	return 0;
 }
@@ -482,6 +521,49 @@ param_filter(struct pw_link *this,
 	return num;
 }
 
+/* make buffers like the buffers of the link for the input port to mix
+ * the links into */
+static int alloc_mix_buffers(struct pw_link *this, struct allocation *allocation)
+{
+	struct impl *impl = SPA_CONTAINER_OF(this, struct impl, this);
+	struct pw_port *input = this->input;
+	struct spa_buffer *b;
+	size_t data_sizes[1];
+	ssize_t data_strides[1];
+	struct allocation mix;
+	int res;
+
+	if (input->mix_allocation.n_buffers > 0)
+		return 0;
+
+	if (allocation->n_buffers == 0 || allocation->buffers[0]->n_datas == 0)
+		return -EINVAL;
+
+	b = allocation->buffers[0];
+	data_sizes[0] = b->datas[0].maxsize;
+	data_strides[0] = b->datas[0].chunk->stride;
+	if (data_sizes[0] == 0)
+		return -EINVAL;
+
+	if ((res = alloc_buffers(this,
+				 allocation->n_buffers,
+				 0, NULL,
+				 1,
+				 data_sizes, data_strides,
+				 CACHE_LINE_SIZE,
+				 &mix)) < 0)
+		return res;
+
+	pw_log_debug("link %p: mixing in %d buffers %p %zd on input port", this,
+		     mix.n_buffers, mix.buffers, data_sizes[0]);
+
+	res = pw_port_use_mix_buffers(input, &mix);
+	if (SPA_RESULT_IS_ASYNC(res))
+		pw_work_queue_add(impl->work, input->node, res, complete_mix, input);
+
+	return res;
+}
+
 static int do_allocation(struct pw_link *this, uint32_t in_state, uint32_t out_state)
 {
 	struct impl *impl = SPA_CONTAINER_OF(this, struct impl, this);
@@ -492,6 +574,7 @@ static int do_allocation(struct pw_link *this, uint32_t in_state, uint32_t out_s
 	struct pw_port *input, *output;
 	struct pw_type *t = &this->core->type;
 	struct allocation allocation;
+	bool mix;
 
 	if (in_state != PW_PORT_STATE_READY && out_state != PW_PORT_STATE_READY)
 		return 0;
@@ -501,6 +584,10 @@ static int do_allocation(struct pw_link *this, uint32_t in_state, uint32_t out_s
 	input = this->input;
 	output = this->output;
 
+	/* the input port has buffers from another link, it can keep them when
+	 * it mixes the links */
+	mix = in_state > PW_PORT_STATE_READY && input->mix != NULL;
+
 	pw_log_debug("link %p: doing alloc buffers %p %p", this, output->node, input->node);
 	/* find out what's possible */
 	if ((res = spa_node_port_get_info(output->node->node, output->direction, output->port_id,
@@ -551,6 +638,8 @@ static int do_allocation(struct pw_link *this, uint32_t in_state, uint32_t out_s
 	} else if (out_state == PW_PORT_STATE_READY && in_state > PW_PORT_STATE_READY) {
 		in_flags &= ~SPA_PORT_INFO_FLAG_CAN_USE_BUFFERS;
 		out_flags &= ~SPA_PORT_INFO_FLAG_CAN_ALLOC_BUFFERS;
+		if (mix)
+			in_flags = 0;
 	} else {
 		pw_log_debug("link %p: delay allocation, state %d %d", this, in_state, out_state);
 		return 0;
@@ -582,7 +671,7 @@ static int do_allocation(struct pw_link *this, uint32_t in_state, uint32_t out_s
 		struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
 		uint32_t i, offset, n_params;
 		uint32_t max_buffers;
-		size_t minsize = 1024, stride = 0;
+		size_t minsize = 1024, stride = 0, align;
 		size_t data_sizes[1];
 		ssize_t data_strides[1];
 
@@ -601,24 +690,27 @@ static int do_allocation(struct pw_link *this, uint32_t in_state, uint32_t out_s
 
 		max_buffers = MAX_BUFFERS;
 		minsize = stride = 0;
+		align = CACHE_LINE_SIZE;
 		param = find_param(params, n_params, t->param_buffers.Buffers);
 		if (param) {
 			uint32_t qmax_buffers = max_buffers,
-			    qminsize = minsize, qstride = stride;
+			    qminsize = minsize, qstride = stride, qalign = 0;
 
 			spa_pod_object_parse(param,
 				":", t->param_buffers.size, "i", &qminsize,
 				":", t->param_buffers.stride, "i", &qstride,
-				":", t->param_buffers.buffers, "i", &qmax_buffers, NULL);
+				":", t->param_buffers.buffers, "i", &qmax_buffers,
+				":", t->param_buffers.align, "?i", &qalign, NULL);
 
 			max_buffers =
 			    qmax_buffers == 0 ? max_buffers : SPA_MIN(qmax_buffers,
 							      max_buffers);
 			minsize = SPA_MAX(minsize, qminsize);
 			stride = SPA_MAX(stride, qstride);
+			align = SPA_MAX(align, qalign);
 
-			pw_log_debug("%d %d %d -> %zd %zd %d", qminsize, qstride, qmax_buffers,
-				     minsize, stride, max_buffers);
+			pw_log_debug("%d %d %d %d -> %zd %zd %d %zd", qminsize, qstride,
+				     qmax_buffers, qalign, minsize, stride, max_buffers, align);
 		} else {
 			pw_log_warn("no buffers param");
 			minsize = 1024;
@@ -639,6 +731,7 @@ static int do_allocation(struct pw_link *this, uint32_t in_state, uint32_t out_s
 					 params,
 					 1,
 					 data_sizes, data_strides,
+					 align,
 					 &allocation)) < 0) {
 			asprintf(&error, "error alloc buffers: %d", res);
 			goto error;
@@ -692,6 +785,9 @@ static int do_allocation(struct pw_link *this, uint32_t in_state, uint32_t out_s
 
 		move_allocation(&allocation, &output->allocation);
 
+	} else if (mix) {
+		pw_log_debug("link %p: mixing %d output buffers %p on input port", this,
+			     allocation.n_buffers, allocation.buffers);
 	} else if (in_flags & SPA_PORT_INFO_FLAG_CAN_USE_BUFFERS) {
 		pw_log_debug("link %p: using %d buffers %p on input port", this,
 			     allocation.n_buffers, allocation.buffers);
@@ -709,6 +805,10 @@ static int do_allocation(struct pw_link *this, uint32_t in_state, uint32_t out_s
 		goto error;
 	}
 
+	if (mix && (res = alloc_mix_buffers(this, &output->allocation)) < 0)
+		pw_log_warn("link %p: can't mix on input port %p: %d (%s)", this,
+			    input, res, spa_strerror(res));
+
 	return 0;
 
       error:
@@ -890,6 +990,7 @@ do_remove_output(struct spa_loop *loop,
 {
 	struct pw_link *this = user_data;
 	spa_graph_port_remove(&this->rt.out_port);
+	pw_port_release_link_buffers(this->output, this->rt.out_port.port_id);
 	return 0;
 }
 
@@ -1272,6 +1373,8 @@ int pw_link_register(struct pw_link *link,
 	    input_node->active && output_node->active)
 		pw_link_activate(link);
 
+	pw_node_update_quantum(input_node);
+
 	return 0;
 }
 
@@ -1279,6 +1382,7 @@ void pw_link_destroy(struct pw_link *link)
 {
 	struct impl *impl = SPA_CONTAINER_OF(link, struct impl, this);
 	struct pw_resource *resource, *tmp;
+	struct pw_node *input_node = link->input->node, *output_node = link->output->node;
 
 	pw_log_debug("link %p: destroy", impl);
 	pw_link_events_destroy(link);
@@ -1292,6 +1396,15 @@ void pw_link_destroy(struct pw_link *link)
 
 	output_remove(link, link->output);
 
+	/* buffers that are still in use are freed when released */
+	pw_core_clear_memblocks(link->core, link);
+
+	/* the nodes can be in different parts of the graph now */
+	if (link->registered) {
+		pw_node_update_quantum(input_node);
+		pw_node_update_quantum(output_node);
+	}
+
 	if (link->global) {
 		spa_hook_remove(&link->global_listener);
 		pw_global_destroy(link->global);
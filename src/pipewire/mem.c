@@ -31,11 +31,11 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <pthread.h>
 #include <sys/syscall.h>
 
-#include <spa/utils/list.h>
-
 #include <pipewire/log.h>
+#include <pipewire/array.h>
 #include <pipewire/mem.h>
 
 #ifndef HAVE_MEMFD_CREATE
@@ -63,6 +63,13 @@ static inline int memfd_create(const char *name, unsigned int flags)
 #define MFD_ALLOW_SEALING 0x0002U
 #endif
 
+#ifndef MFD_HUGETLB
+#define MFD_HUGETLB       0x0004U
+#endif
+
+/* the default huge page size, memfds with MFD_HUGETLB are a multiple of it */
+#define HUGEPAGE_SIZE	(2 * 1024 * 1024)
+
 /* fcntl() seals-related flags */
 
 #ifndef F_LINUX_SPECIFIC_BASE
@@ -81,19 +88,85 @@ static inline int memfd_create(const char *name, unsigned int flags)
 
 struct memblock {
 	struct pw_memblock mem;
-	struct spa_list link;
+	const void *indexed;	/**< start of the range in the index or NULL */
+};
+
+/* the mapped ranges of all memblocks, sorted on the start address */
+struct range {
+	const void *start;
+	const void *end;
+	struct memblock *block;
 };
 
-static struct spa_list _memblocks = SPA_LIST_INIT(&_memblocks);
+static pthread_mutex_t _ranges_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct pw_array _ranges = PW_ARRAY_INIT(64 * sizeof(struct range));
+
+/* index of the first range that starts after ptr, call with the lock */
+static uint32_t ranges_upper_bound(const void *ptr)
+{
+	struct range *r = _ranges.data;
+	uint32_t lo = 0, hi = pw_array_get_len(&_ranges, struct range), mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (r[mid].start <= ptr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static void index_block(struct memblock *m)
+{
+	struct range *r;
+	uint32_t idx, len;
+
+	if (m->indexed || m->mem.ptr == NULL || m->mem.size == 0)
+		return;
+
+	pthread_mutex_lock(&_ranges_lock);
+	idx = ranges_upper_bound(m->mem.ptr);
+	len = pw_array_get_len(&_ranges, struct range);
+	if (pw_array_add(&_ranges, sizeof(struct range)) != NULL) {
+		r = _ranges.data;
+		memmove(&r[idx + 1], &r[idx], (len - idx) * sizeof(struct range));
+		r[idx].start = m->mem.ptr;
+		r[idx].end = SPA_MEMBER(m->mem.ptr, m->mem.size, void);
+		r[idx].block = m;
+		m->indexed = m->mem.ptr;
+	}
+	pthread_mutex_unlock(&_ranges_lock);
+}
+
+static void unindex_block(struct memblock *m)
+{
+	struct range *r;
+	uint32_t idx, len;
+
+	if (m->indexed == NULL)
+		return;
+
+	pthread_mutex_lock(&_ranges_lock);
+	r = _ranges.data;
+	len = pw_array_get_len(&_ranges, struct range);
+	/* ranges with the same start are next to each other */
+	for (idx = ranges_upper_bound(m->indexed); idx > 0; idx--) {
+		if (r[idx - 1].block == m) {
+			memmove(&r[idx - 1], &r[idx], (len - idx) * sizeof(struct range));
+			_ranges.size -= sizeof(struct range);
+			break;
+		}
+		if (r[idx - 1].start != m->indexed)
+			break;
+	}
+	m->indexed = NULL;
+	pthread_mutex_unlock(&_ranges_lock);
+}
 
 #define USE_MEMFD
 
-/** Map a memblock
- * \param mem a memblock
- * \return 0 on success, < 0 on error
- * \memberof pw_memblock
- */
-int pw_memblock_map(struct pw_memblock *mem)
+static int map_block(struct pw_memblock *mem)
 {
 	if (mem->ptr != NULL)
 		return 0;
@@ -142,6 +215,72 @@ int pw_memblock_map(struct pw_memblock *mem)
 	return 0;
 }
 
+/** Map a memblock
+ * \param mem a memblock
+ * \return 0 on success, < 0 on error
+ * \memberof pw_memblock
+ */
+int pw_memblock_map(struct pw_memblock *mem)
+{
+	int res;
+
+	if ((res = map_block(mem)) < 0)
+		return res;
+
+	index_block((struct memblock *) mem);
+	return 0;
+}
+
+/* make the fd of \a m and map it */
+static int alloc_fd(struct pw_memblock *m, unsigned int mfd_flags)
+{
+	int res;
+
+#ifdef USE_MEMFD
+	m->fd = memfd_create("pipewire-memfd", MFD_CLOEXEC | MFD_ALLOW_SEALING | mfd_flags);
+	if (m->fd == -1) {
+		res = -errno;
+		if (mfd_flags == 0)
+			pw_log_error("Failed to create memfd: %s\n", strerror(errno));
+		return res;
+	}
+#else
+	char filename[] = "/dev/shm/pipewire-tmpfile.XXXXXX";
+
+	if (mfd_flags != 0)
+		return -ENOTSUP;
+
+	m->fd = mkostemp(filename, O_CLOEXEC);
+	if (m->fd == -1) {
+		res = -errno;
+		pw_log_error("Failed to create temporary file: %s\n", strerror(errno));
+		return res;
+	}
+	unlink(filename);
+#endif
+
+	if (ftruncate(m->fd, m->size) < 0) {
+		res = -errno;
+		pw_log_warn("Failed to truncate temporary file: %s", strerror(errno));
+		close(m->fd);
+		return res;
+	}
+#ifdef USE_MEMFD
+	if (m->flags & PW_MEMBLOCK_FLAG_SEAL) {
+		unsigned int seals = F_SEAL_GROW | F_SEAL_SHRINK | F_SEAL_SEAL;
+		if (fcntl(m->fd, F_ADD_SEALS, seals) == -1) {
+			pw_log_warn("Failed to add seals: %s", strerror(errno));
+		}
+	}
+#endif
+	if (map_block(m) != 0) {
+		close(m->fd);
+		m->ptr = NULL;
+		return -ENOMEM;
+	}
+	return 0;
+}
+
 /** Create a new memblock
  * \param flags memblock flags
  * \param size size to allocate
@@ -167,37 +306,26 @@ int pw_memblock_alloc(enum pw_memblock_flags flags, size_t size, struct pw_membl
 	use_fd = ! !(flags & (PW_MEMBLOCK_FLAG_MAP_TWICE | PW_MEMBLOCK_FLAG_WITH_FD));
 
 	if (use_fd) {
-#ifdef USE_MEMFD
-		m->fd = memfd_create("pipewire-memfd", MFD_CLOEXEC | MFD_ALLOW_SEALING);
-		if (m->fd == -1) {
-			pw_log_error("Failed to create memfd: %s\n", strerror(errno));
-			return -errno;
-		}
-#else
-		char filename[] = "/dev/shm/pipewire-tmpfile.XXXXXX";
-		m->fd = mkostemp(filename, O_CLOEXEC);
-		if (m->fd == -1) {
-			pw_log_error("Failed to create temporary file: %s\n", strerror(errno));
-			return -errno;
-		}
-		unlink(filename);
-#endif
-
-		if (ftruncate(m->fd, size) < 0) {
-			pw_log_warn("Failed to truncate temporary file: %s", strerror(errno));
-			close(m->fd);
-			return -errno;
-		}
-#ifdef USE_MEMFD
-		if (flags & PW_MEMBLOCK_FLAG_SEAL) {
-			unsigned int seals = F_SEAL_GROW | F_SEAL_SHRINK | F_SEAL_SEAL;
-			if (fcntl(m->fd, F_ADD_SEALS, seals) == -1) {
-				pw_log_warn("Failed to add seals: %s", strerror(errno));
+		int res = -ENOTSUP;
+
+		/* huge pages need to be reserved by the admin, without them we
+		 * try transparent huge pages */
+		if ((flags & PW_MEMBLOCK_FLAG_HUGEPAGES) &&
+		    !(flags & PW_MEMBLOCK_FLAG_MAP_TWICE)) {
+			m->size = SPA_ROUND_UP_N(size, HUGEPAGE_SIZE);
+			if ((res = alloc_fd(m, MFD_HUGETLB)) < 0) {
+				pw_log_debug("mem %p: no huge pages: %s", m, strerror(-res));
+				m->size = size;
 			}
 		}
+		if (res < 0) {
+			if ((res = alloc_fd(m, 0)) < 0)
+				return res;
+#ifdef MADV_HUGEPAGE
+			if ((flags & PW_MEMBLOCK_FLAG_HUGEPAGES) && m->ptr != NULL)
+				madvise(m->ptr, m->size, MADV_HUGEPAGE);
 #endif
-		if (pw_memblock_map(m) != 0)
-			goto mmap_failed;
+		}
 	} else {
 		if (size > 0) {
 			m->ptr = malloc(size);
@@ -212,16 +340,13 @@ int pw_memblock_alloc(enum pw_memblock_flags flags, size_t size, struct pw_membl
 	}
 
 	p = calloc(1, sizeof(struct memblock));
-	*p = tmp;
-	spa_list_append(&_memblocks, &p->link);
+	p->mem = tmp.mem;
+	index_block(p);
 	*mem = &p->mem;
 	pw_log_debug("mem %p: alloc", *mem);
 
 	return 0;
 
-      mmap_failed:
-	close(m->fd);
-	return -ENOMEM;
 }
 
 int
@@ -256,6 +381,10 @@ void pw_memblock_free(struct pw_memblock *mem)
 		return;
 
 	pw_log_debug("mem %p: free", mem);
+	/* remove the range before it is unmapped, the address can be reused
+	 * by another mapping right after */
+	unindex_block(m);
+
 	if (mem->flags & PW_MEMBLOCK_FLAG_WITH_FD) {
 		if (mem->ptr)
 			munmap(mem->ptr, mem->size);
@@ -264,17 +393,31 @@ void pw_memblock_free(struct pw_memblock *mem)
 	} else {
 		free(mem->ptr);
 	}
-	spa_list_remove(&m->link);
 	free(mem);
 }
 
+/** Find the memblock that contains \a ptr
+ * \param ptr a pointer in mapped memory
+ * \return the memblock or NULL when \a ptr is not in a memblock
+ *
+ * This can be called from any thread.
+ *
+ * \memberof pw_memblock
+ */
 struct pw_memblock * pw_memblock_find(const void *ptr)
 {
-	struct memblock *m;
-
-	spa_list_for_each(m, &_memblocks, link) {
-		if (ptr >= m->mem.ptr && ptr < m->mem.ptr + m->mem.size)
-			return &m->mem;
-	}
-	return NULL;
+	struct range *r;
+	struct pw_memblock *res = NULL;
+	uint32_t idx;
+
+	pthread_mutex_lock(&_ranges_lock);
+	r = _ranges.data;
+	/* the memblocks don't overlap, only the last range that starts
+	 * before ptr can contain it */
+	idx = ranges_upper_bound(ptr);
+	if (idx > 0 && ptr < r[idx - 1].end)
+		res = &r[idx - 1].block->mem;
+	pthread_mutex_unlock(&_ranges_lock);
+
+	return res;
 }
@@ -23,6 +23,7 @@
 #include <errno.h>
 
 #include <spa/clock/clock.h>
+#include <spa/param/props.h>
 #include <spa/pod/parser.h>
 
 #include "pipewire/pipewire.h"
@@ -188,6 +189,16 @@ static void update_port_map(struct pw_node *node, enum pw_direction direction,
 	}
 }
 
+void pw_node_invalidate_params(struct pw_node *node)
+{
+	struct pw_port *port;
+
+	spa_list_for_each(port, &node->input_ports, link)
+		port->enum_formats_valid = false;
+	spa_list_for_each(port, &node->output_ports, link)
+		port->enum_formats_valid = false;
+}
+
 int pw_node_update_ports(struct pw_node *node)
 {
 	uint32_t *input_port_ids, *output_port_ids;
@@ -228,6 +239,8 @@ int pw_node_update_ports(struct pw_node *node)
 	update_port_map(node, PW_DIRECTION_INPUT, &node->input_port_map, input_port_ids, n_input_ports);
 	update_port_map(node, PW_DIRECTION_OUTPUT, &node->output_port_map, output_port_ids, n_output_ports);
 
+	pw_node_invalidate_params(node);
+
 	return 0;
 }
 
@@ -369,10 +382,10 @@ int pw_node_register(struct pw_node *this,
 
 	spa_list_for_each(port, &this->input_ports, link)
 		pw_port_register(port, owner, this->global,
-				 pw_properties_copy(port->properties));
+				 pw_properties_freeze(port->properties));
 	spa_list_for_each(port, &this->output_ports, link)
 		pw_port_register(port, owner, this->global,
-				 pw_properties_copy(port->properties));
+				 pw_properties_freeze(port->properties));
 
 	pw_node_events_initialized(this);
 
@@ -478,12 +491,25 @@ int pw_node_update_properties(struct pw_node *node, const struct spa_dict *dict)
 {
 	struct pw_resource *resource;
 	uint32_t i;
+	bool latency_changed = false;
+
+	for (i = 0; i < dict->n_items; i++) {
+		const char *key = dict->items[i].key, *value = dict->items[i].value;
 
-	for (i = 0; i < dict->n_items; i++)
-		pw_properties_set(node->properties, dict->items[i].key, dict->items[i].value);
+		if (strcmp(key, PW_NODE_PROP_LATENCY) == 0) {
+			const char *old = pw_properties_get(node->properties, key);
+			latency_changed |= old == NULL || value == NULL ?
+				old != value : strcmp(old, value) != 0;
+		}
+		pw_properties_set(node->properties, key, value);
+	}
 
 	check_properties(node);
 
+	/* the linked devices follow the smallest latency that is requested */
+	if (latency_changed)
+		pw_node_update_quantum(node);
+
 	node->info.props = &node->properties->dict;
 
 	node->info.change_mask |= PW_NODE_CHANGE_MASK_PROPS;
@@ -617,6 +643,7 @@ void pw_node_destroy(struct pw_node *node)
 	if (node->registered) {
 		pw_loop_invoke(node->data_loop, do_node_remove, 1, NULL, 0, true, node);
 		spa_list_remove(&node->link);
+		node->registered = false;
 	}
 
 	pw_log_debug("node %p: unlink ports", node);
@@ -711,6 +738,82 @@ int pw_node_for_each_param(struct pw_node *node,
 	return res;
 }
 
+static void add_linked_nodes(struct pw_array *nodes, struct pw_node *node)
+{
+	struct pw_node **n;
+	struct pw_port *port;
+	struct pw_link *link;
+
+	pw_array_for_each(n, nodes)
+		if (*n == node)
+			return;
+
+	pw_array_add_ptr(nodes, node);
+
+	spa_list_for_each(port, &node->input_ports, link)
+		spa_list_for_each(link, &port->links, input_link)
+			add_linked_nodes(nodes, link->output->node);
+	spa_list_for_each(port, &node->output_ports, link)
+		spa_list_for_each(link, &port->links, output_link)
+			add_linked_nodes(nodes, link->input->node);
+}
+
+static int check_quantum_prop(void *data, uint32_t id, uint32_t index, uint32_t next,
+			      struct spa_pod *param)
+{
+	struct pw_node *node = data;
+	struct pw_type *t = &node->core->type;
+	uint32_t prop_id;
+
+	if (spa_pod_object_parse(param, ":", t->param.propId, "I", &prop_id, NULL) < 0)
+		return 0;
+
+	return prop_id == spa_type_map_get_id(t->map, SPA_TYPE_PROPS__quantum) ? 1 : 0;
+}
+
+void pw_node_update_quantum(struct pw_node *node)
+{
+	struct pw_type *t = &node->core->type;
+	struct pw_array nodes;
+	struct pw_node **n;
+	uint8_t buf[256];
+	struct spa_pod_builder b = { 0 };
+	struct spa_pod *props;
+	const char *str;
+	int32_t quantum = 0, q;
+
+	if (!node->registered)
+		return;
+
+	pw_array_init(&nodes, 16 * sizeof(struct pw_node *));
+	add_linked_nodes(&nodes, node);
+
+	pw_array_for_each(n, &nodes) {
+		if ((*n)->registered &&
+		    (str = pw_properties_get((*n)->properties, PW_NODE_PROP_LATENCY)) != NULL &&
+		    (q = atoi(str)) > 0)
+			quantum = quantum == 0 ? q : SPA_MIN(quantum, q);
+	}
+
+	pw_log_debug("node %p: quantum %d for %zd nodes", node, quantum,
+			pw_array_get_len(&nodes, struct pw_node *));
+
+	/* the devices are the nodes with a quantum property, when no node
+	 * wants a latency they go back to their default */
+	pw_array_for_each(n, &nodes) {
+		if (!(*n)->registered ||
+		    pw_node_for_each_param(*n, t->param.idPropInfo, 0, 0, NULL,
+					   check_quantum_prop, *n) != 1)
+			continue;
+
+		spa_pod_builder_init(&b, buf, sizeof(buf));
+		props = spa_pod_builder_object(&b, t->param.idProps, t->spa_props,
+				":", spa_type_map_get_id(t->map, SPA_TYPE_PROPS__quantum), "i", quantum);
+		spa_node_set_param((*n)->node, t->param.idProps, 0, props);
+	}
+	pw_array_clear(&nodes);
+}
+
 struct pw_port *
 pw_node_find_port(struct pw_node *node, enum pw_direction direction, uint32_t port_id)
 {
@@ -104,6 +104,9 @@ struct pw_node_events {
 #define PW_NODE_PROP_AUTOCONNECT	"pipewire.autoconnect"
 /** Try to connect the node to this node id */
 #define PW_NODE_PROP_TARGET_NODE	"pipewire.target.node"
+/** The latency the node wants in samples, the devices it is linked to
+ * run with the lowest latency of their nodes, int */
+#define PW_NODE_PROP_LATENCY		"pipewire.latency"
 
 /** Create a new node \memberof pw_node */
 struct pw_node *
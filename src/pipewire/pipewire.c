@@ -273,8 +273,12 @@ void pw_init(int *argc, char **argv[])
 
 	if (open_support(str, "support/libspa-support", info)) {
 		iface = load_interface(info, "mapper", SPA_TYPE__TypeMap);
-		if (iface != NULL)
+		if (iface != NULL) {
 			info->support[info->n_support++] = SPA_SUPPORT_INIT(SPA_TYPE__TypeMap, iface->iface);
+			/* register the static types first so that they get the same
+			 * ids in every process */
+			pw_type_init_static(iface->iface);
+		}
 
 		iface = load_interface(info, "logger", SPA_TYPE__Log);
 		if (iface != NULL) {
@@ -22,14 +22,49 @@
 #include <errno.h>
 
 #include <spa/pod/parser.h>
+#include <spa/param/audio/format-utils.h>
 
 #include "pipewire/pipewire.h"
 #include "pipewire/private.h"
 #include "pipewire/port.h"
 
+#include "mix-ops.h"
+
 /** \cond */
+#define MAX_MIX_BUFFERS		64
+#define MAX_MIX_INPUTS		64
+#define MAX_TEE_BUFFERS		64
+#define MAX_TEE_LINKS		64
+
+struct type {
+	struct spa_type_media_type media_type;
+	struct spa_type_media_subtype media_subtype;
+	struct spa_type_format_audio format_audio;
+	struct spa_type_audio_format audio_format;
+};
+
+static inline void init_type(struct type *type, struct spa_type_map *map)
+{
+	spa_type_media_type_map(map, &type->media_type);
+	spa_type_media_subtype_map(map, &type->media_subtype);
+	spa_type_format_audio_map(map, &type->format_audio);
+	spa_type_audio_format_map(map, &type->audio_format);
+}
+
 struct impl {
 	struct pw_port this;
+
+	struct type type;
+
+	struct spa_audiomixer_ops ops;
+	int mix_fmt;			/**< FMT_ of the format or -1 when it can't be mixed */
+
+	/* data only accessed from the data thread */
+	bool mixing;			/**< if the links are mixed into mix_allocation */
+	bool mix_used[MAX_MIX_BUFFERS];	/**< mix buffers that are with the node */
+	uint64_t mix_held;		/**< buffers of the first link that are with the node */
+	uint64_t tee_lent;		/**< tee buffers that are with the links */
+	uint64_t tee_holders[MAX_TEE_BUFFERS];	/**< the links that hold a tee buffer */
 };
 
 struct resource_data {
@@ -49,17 +84,67 @@ static void port_update_state(struct pw_port *port, enum pw_port_state state)
 	}
 }
 
+/* give a buffer back to the node of the port */
+static void tee_recycle(struct pw_port *this, uint32_t buffer_id)
+{
+	struct spa_graph_port *pp;
+
+	if ((pp = this->rt.mix_port.peer) != NULL) {
+		pw_log_trace("tee %p: recycle buffer %d", &this->rt.mix_node, buffer_id);
+		spa_node_port_reuse_buffer(pp->node->implementation, pp->port_id, buffer_id);
+	}
+}
+
+/* the link with \a port_id is done with \a buffer_id, returns true when the
+ * buffer can go back to the node */
+static bool tee_release(struct impl *impl, uint32_t port_id, uint32_t buffer_id)
+{
+	uint64_t mask;
+
+	/* buffers that were not counted go back right away */
+	if (buffer_id >= MAX_TEE_BUFFERS || !(impl->tee_lent & (1ULL << buffer_id)))
+		return true;
+	if (port_id >= MAX_TEE_LINKS)
+		return false;
+
+	mask = 1ULL << port_id;
+	if (!(impl->tee_holders[buffer_id] & mask))
+		return false;
+
+	impl->tee_holders[buffer_id] &= ~mask;
+	if (impl->tee_holders[buffer_id] != 0)
+		return false;
+
+	impl->tee_lent &= ~(1ULL << buffer_id);
+	return true;
+}
+
 static int schedule_tee_input(struct spa_node *data)
 {
 	struct pw_port *this = SPA_CONTAINER_OF(data, struct pw_port, mix_node);
+	struct impl *impl = SPA_CONTAINER_OF(this, struct impl, this);
 	struct spa_graph_node *node = &this->rt.mix_node;
 	struct spa_graph_port *p;
 	struct spa_io_buffers *io = this->rt.mix_port.io;
+	uint64_t holders = 0;
 
 	if (!spa_list_is_empty(&node->ports[SPA_DIRECTION_OUTPUT])) {
 		pw_log_trace("node %p: tee input %d %d", node, io->status, io->buffer_id);
-		spa_list_for_each(p, &node->ports[SPA_DIRECTION_OUTPUT], link)
+		spa_list_for_each(p, &node->ports[SPA_DIRECTION_OUTPUT], link) {
+			/* a link that did not take its last buffer gives it up now */
+			if (p->io->buffer_id != SPA_ID_INVALID &&
+			    tee_release(impl, p->port_id, p->io->buffer_id))
+				tee_recycle(this, p->io->buffer_id);
+
 			*p->io = *io;
+			if (p->port_id < MAX_TEE_LINKS)
+				holders |= 1ULL << p->port_id;
+		}
+		/* the buffer goes back when all links released it */
+		if (io->buffer_id < MAX_TEE_BUFFERS && holders != 0) {
+			impl->tee_holders[io->buffer_id] = holders;
+			impl->tee_lent |= 1ULL << io->buffer_id;
+		}
 		io->buffer_id = SPA_ID_INVALID;
 	}
 	else
@@ -70,12 +155,32 @@ static int schedule_tee_input(struct spa_node *data)
 static int schedule_tee_output(struct spa_node *data)
 {
 	struct pw_port *this = SPA_CONTAINER_OF(data, struct pw_port, mix_node);
+	struct impl *impl = SPA_CONTAINER_OF(this, struct impl, this);
 	struct spa_graph_node *node = &this->rt.mix_node;
 	struct spa_graph_port *p;
 	struct spa_io_buffers *io = this->rt.mix_port.io;
+	uint32_t buffer_id = SPA_ID_INVALID, id;
+
+	spa_list_for_each(p, &node->ports[SPA_DIRECTION_OUTPUT], link) {
+		io->status = p->io->status;
+
+		/* a buffer in the io area of a link that does not have a
+		 * new buffer is returned by the link */
+		if (p->io->status == SPA_STATUS_HAVE_BUFFER ||
+		    (id = p->io->buffer_id) == SPA_ID_INVALID)
+			continue;
+
+		p->io->buffer_id = SPA_ID_INVALID;
+		if (!tee_release(impl, p->port_id, id))
+			continue;
+
+		if (buffer_id == SPA_ID_INVALID)
+			buffer_id = id;
+		else
+			tee_recycle(this, id);
+	}
+	io->buffer_id = buffer_id;
 
-	spa_list_for_each(p, &node->ports[SPA_DIRECTION_OUTPUT], link)
-		*io = *p->io;
 	pw_log_trace("node %p: tee output %d %d", node, io->status, io->buffer_id);
 	return io->status;
 }
@@ -83,16 +188,28 @@ static int schedule_tee_output(struct spa_node *data)
 static int schedule_tee_reuse_buffer(struct spa_node *data, uint32_t port_id, uint32_t buffer_id)
 {
 	struct pw_port *this = SPA_CONTAINER_OF(data, struct pw_port, mix_node);
+	struct impl *impl = SPA_CONTAINER_OF(this, struct impl, this);
 	struct spa_graph_node *node = &this->rt.mix_node;
-	struct spa_graph_port *p = &this->rt.mix_port, *pp;
 
-	if ((pp = p->peer) != NULL) {
-		pw_log_trace("node %p: tee reuse buffer %d %d", node, port_id, buffer_id);
-		spa_node_port_reuse_buffer(pp->node->implementation, port_id, buffer_id);
-	}
+	pw_log_trace("node %p: tee reuse buffer %d %d", node, port_id, buffer_id);
+	if (tee_release(impl, port_id, buffer_id))
+		tee_recycle(this, buffer_id);
+
 	return 0;
 }
 
+void pw_port_release_link_buffers(struct pw_port *port, uint32_t port_id)
+{
+	struct impl *impl = SPA_CONTAINER_OF(port, struct impl, this);
+	uint32_t i;
+
+	for (i = 0; i < MAX_TEE_BUFFERS; i++) {
+		if ((impl->tee_lent & (1ULL << i)) &&
+		    tee_release(impl, port_id, i))
+			tee_recycle(port, i);
+	}
+}
+
 static const struct spa_node schedule_tee_node = {
 	SPA_VERSION_NODE,
 	NULL,
@@ -101,18 +218,137 @@ static const struct spa_node schedule_tee_node = {
 	.port_reuse_buffer = schedule_tee_reuse_buffer,
 };
 
+static const double mix_scale[MAX_MIX_INPUTS] = {
+	[0 ... MAX_MIX_INPUTS - 1] = 1.0,
+};
+
+static struct spa_buffer *get_link_buffer(struct spa_graph_port *p)
+{
+	struct pw_link *link = SPA_CONTAINER_OF(p, struct pw_link, rt.in_port);
+	struct allocation *allocation = &link->output->allocation;
+
+	if (p->io->buffer_id >= allocation->n_buffers)
+		return NULL;
+	return allocation->buffers[p->io->buffer_id];
+}
+
+/* sum the buffers of all links into a free buffer of the port */
+static int mix_links(struct impl *impl)
+{
+	struct pw_port *this = &impl->this;
+	struct spa_graph_node *node = &this->rt.mix_node;
+	struct spa_graph_port *p, *pp, *ports[MAX_MIX_INPUTS];
+	struct spa_io_buffers *io = this->rt.mix_port.io;
+	struct allocation *allocation = &this->mix_allocation;
+	const void *src[MAX_MIX_INPUTS];
+	uint32_t sizes[MAX_MIX_INPUTS];
+	uint32_t i, n_src = 0, min_size = UINT32_MAX, max_size = 0;
+	int32_t stride = 0;
+	struct spa_buffer *out;
+	struct spa_data *od;
+	uint8_t *dst;
+
+	/* the node did not consume the last mix yet */
+	if (io->status == SPA_STATUS_HAVE_BUFFER && io->buffer_id < allocation->n_buffers)
+		return io->status;
+
+	for (i = 0; i < allocation->n_buffers; i++)
+		if (!impl->mix_used[i])
+			break;
+	if (i == allocation->n_buffers) {
+		pw_log_trace("mix %p: out of buffers", node);
+		io->status = SPA_STATUS_NEED_BUFFER;
+		return io->status;
+	}
+	out = allocation->buffers[i];
+	od = &out->datas[0];
+	dst = od->data;
+
+	spa_list_for_each(p, &node->ports[SPA_DIRECTION_INPUT], link) {
+		struct spa_buffer *b;
+		struct spa_data *d;
+		uint32_t offset, size;
+
+		if (n_src == MAX_MIX_INPUTS)
+			break;
+		if ((b = get_link_buffer(p)) == NULL)
+			continue;
+
+		d = &b->datas[0];
+		ports[n_src] = p;
+
+		offset = SPA_MIN(d->chunk->offset, d->maxsize);
+		size = SPA_MIN(d->chunk->size, d->maxsize - offset);
+		size = SPA_MIN(size, od->maxsize);
+		if (d->data == NULL)
+			size = 0;
+
+		pw_log_trace("mix %p: input %p %d size %d", node, p, p->io->buffer_id, size);
+
+		src[n_src] = SPA_MEMBER(d->data, offset, void);
+		sizes[n_src] = size;
+		min_size = SPA_MIN(min_size, size);
+		max_size = SPA_MAX(max_size, size);
+		if (n_src == 0)
+			stride = d->chunk->stride;
+		n_src++;
+	}
+	if (n_src == 0) {
+		io->status = SPA_STATUS_NEED_BUFFER;
+		return io->status;
+	}
+
+	impl->ops.mix_n[impl->mix_fmt](dst, src, mix_scale, n_src, min_size);
+	if (max_size > min_size) {
+		impl->ops.clear[impl->mix_fmt](dst + min_size, max_size - min_size);
+		for (i = 0; i < n_src; i++) {
+			if (sizes[i] > min_size)
+				impl->ops.add[impl->mix_fmt](dst + min_size,
+						SPA_MEMBER(src[i], min_size, void),
+						sizes[i] - min_size);
+		}
+	}
+
+	/* the links can reuse their buffers right away */
+	for (i = 0; i < n_src; i++) {
+		p = ports[i];
+		if ((pp = p->peer) != NULL)
+			spa_node_port_reuse_buffer(pp->node->implementation,
+					pp->port_id, p->io->buffer_id);
+		p->io->buffer_id = SPA_ID_INVALID;
+	}
+
+	od->chunk->offset = 0;
+	od->chunk->size = max_size;
+	od->chunk->stride = stride;
+
+	impl->mix_used[out->id] = true;
+	io->buffer_id = out->id;
+	io->status = SPA_STATUS_HAVE_BUFFER;
+
+	pw_log_trace("mix %p: mixed %d inputs in %d size %d", node, n_src, out->id, max_size);
+
+	return io->status;
+}
+
 static int schedule_mix_input(struct spa_node *data)
 {
 	struct pw_port *this = SPA_CONTAINER_OF(data, struct pw_port, mix_node);
+	struct impl *impl = SPA_CONTAINER_OF(this, struct impl, this);
 	struct spa_graph_node *node = &this->rt.mix_node;
 	struct spa_graph_port *p;
 	struct spa_io_buffers *io = this->rt.mix_port.io;
 
+	if (impl->mixing)
+		return mix_links(impl);
+
 	spa_list_for_each(p, &node->ports[SPA_DIRECTION_INPUT], link) {
 		pw_log_trace("mix %p: input %p %p->%p %d %d", node,
 				p, p->io, io, p->io->status, p->io->buffer_id);
 		*io = *p->io;
 		p->io->buffer_id = SPA_ID_INVALID;
+		if (io->status == SPA_STATUS_HAVE_BUFFER && io->buffer_id < MAX_MIX_BUFFERS)
+			impl->mix_held |= 1ULL << io->buffer_id;
 		break;
 	}
 	return io->status;
@@ -121,13 +357,32 @@ static int schedule_mix_input(struct spa_node *data)
 static int schedule_mix_output(struct spa_node *data)
 {
 	struct pw_port *this = SPA_CONTAINER_OF(data, struct pw_port, mix_node);
+	struct impl *impl = SPA_CONTAINER_OF(this, struct impl, this);
 	struct spa_graph_node *node = &this->rt.mix_node;
 	struct spa_graph_port *p;
 	struct spa_io_buffers *io = this->rt.mix_port.io;
 
-	if (!spa_list_is_empty(&node->ports[SPA_DIRECTION_INPUT])) {
-		spa_list_for_each(p, &node->ports[SPA_DIRECTION_INPUT], link)
-			*p->io = *io;
+	if (impl->mixing) {
+		/* the buffers of the links were reused after mixing, only
+		 * the mix buffer comes back */
+		if (io->status != SPA_STATUS_HAVE_BUFFER &&
+		    io->buffer_id < this->mix_allocation.n_buffers) {
+			impl->mix_used[io->buffer_id] = false;
+			io->buffer_id = SPA_ID_INVALID;
+		}
+		spa_list_for_each(p, &node->ports[SPA_DIRECTION_INPUT], link) {
+			p->io->status = io->status;
+			p->io->buffer_id = SPA_ID_INVALID;
+		}
+	}
+	else if (!spa_list_is_empty(&node->ports[SPA_DIRECTION_INPUT])) {
+		/* only the first link gave a buffer, it gets it back */
+		if (io->buffer_id < MAX_MIX_BUFFERS)
+			impl->mix_held &= ~(1ULL << io->buffer_id);
+		p = spa_list_first(&node->ports[SPA_DIRECTION_INPUT], struct spa_graph_port, link);
+		*p->io = *io;
+		spa_list_for_each_next(p, &node->ports[SPA_DIRECTION_INPUT], &p->link, link)
+			p->io->status = io->status;
 	}
 	else {
 		io->status = SPA_STATUS_HAVE_BUFFER;
@@ -140,14 +395,26 @@ static int schedule_mix_output(struct spa_node *data)
 static int schedule_mix_reuse_buffer(struct spa_node *data, uint32_t port_id, uint32_t buffer_id)
 {
 	struct pw_port *this = SPA_CONTAINER_OF(data, struct pw_port, mix_node);
+	struct impl *impl = SPA_CONTAINER_OF(this, struct impl, this);
 	struct spa_graph_node *node = &this->rt.mix_node;
 	struct spa_graph_port *p, *pp;
 
+	if (impl->mixing) {
+		pw_log_trace("mix %p: reuse mix buffer %d", node, buffer_id);
+		if (buffer_id < this->mix_allocation.n_buffers)
+			impl->mix_used[buffer_id] = false;
+		return 0;
+	}
+
+	/* the buffer came from the first link */
+	if (buffer_id < MAX_MIX_BUFFERS)
+		impl->mix_held &= ~(1ULL << buffer_id);
 	spa_list_for_each(p, &node->ports[SPA_DIRECTION_INPUT], link) {
 		if ((pp = p->peer) != NULL) {
 			pw_log_trace("mix %p: reuse buffer %d %d", node, port_id, buffer_id);
-			spa_node_port_reuse_buffer(pp->node->implementation, port_id, buffer_id);
+			spa_node_port_reuse_buffer(pp->node->implementation, pp->port_id, buffer_id);
 		}
+		break;
 	}
 	return 0;
 }
@@ -187,6 +454,8 @@ struct pw_port *pw_port_new(enum pw_direction direction,
 	this->state = PW_PORT_STATE_INIT;
 	this->io = SPA_IO_BUFFERS_INIT;
 
+	impl->mix_fmt = -1;
+
         if (user_data_size > 0)
 		this->user_data = SPA_MEMBER(impl, sizeof(struct impl), void);
 
@@ -212,6 +481,7 @@ struct pw_port *pw_port_new(enum pw_direction direction,
 				schedule_tee_node;
 	spa_graph_node_set_implementation(&this->rt.mix_node, &this->mix_node);
 	pw_map_init(&this->mix_port_map, 64, 64);
+	pw_array_init(&this->enum_formats, 1024);
 
 	spa_graph_port_init(&this->rt.mix_port,
 			    pw_direction_reverse(this->direction),
@@ -410,6 +680,7 @@ int pw_port_register(struct pw_port *port,
 
 int pw_port_add(struct pw_port *port, struct pw_node *node)
 {
+	struct impl *impl = SPA_CONTAINER_OF(port, struct impl, this);
 	uint32_t port_id = port->port_id;
 	struct pw_core *core = node->core;
 	struct pw_type *t = &core->type;
@@ -438,6 +709,9 @@ int pw_port_add(struct pw_port *port, struct pw_node *node)
 
 	pw_log_debug("port %p: add to node %p %08x", port, node, port->spa_info->flags);
 	if (port->direction == PW_DIRECTION_INPUT) {
+		init_type(&impl->type, t->map);
+		spa_audiomixer_get_ops(&impl->ops);
+
 		spa_list_append(&node->input_ports, &port->link);
 		pw_map_insert_at(&node->input_port_map, port_id, port);
 		node->info.n_input_ports++;
@@ -461,7 +735,7 @@ int pw_port_add(struct pw_port *port, struct pw_node *node)
 
 	if (node->global)
 		pw_port_register(port, node->global->owner, node->global,
-				pw_properties_copy(port->properties));
+				pw_properties_freeze(port->properties));
 
 	port->rt.graph = node->rt.graph;
 	pw_loop_invoke(node->data_loop, do_add_port, SPA_ID_INVALID, NULL, 0, false, port);
@@ -557,8 +831,10 @@ void pw_port_destroy(struct pw_port *port)
 	pw_port_events_free(port);
 
 	free_allocation(&port->allocation);
+	free_allocation(&port->mix_allocation);
 
 	pw_map_clear(&port->mix_port_map);
+	pw_array_clear(&port->enum_formats);
 
 	if (port->properties)
 		pw_properties_free(port->properties);
@@ -653,6 +929,203 @@ int pw_port_for_each_filtered_param(struct pw_port *in_port,
 	return res;
 }
 
+int pw_port_get_enum_formats(struct pw_port *port, struct pw_array **formats)
+{
+	struct pw_node *node = port->node;
+	struct pw_core *core = node->core;
+	struct pw_type *t = &core->type;
+	uint32_t index = 0, n_formats = 0;
+	int res;
+
+	*formats = &port->enum_formats;
+
+	if (port->enum_formats_valid) {
+		struct spa_pod *p;
+
+		core->format_cache.hits++;
+		SPA_POD_FOREACH(port->enum_formats.data, port->enum_formats.size, p)
+			n_formats++;
+		return n_formats;
+	}
+	core->format_cache.misses++;
+
+	port->enum_formats.size = 0;
+	while (true) {
+		struct spa_pod_builder b = { 0 };
+		uint8_t buffer[4096];
+		struct spa_pod *format;
+		size_t size;
+		void *p;
+
+		spa_pod_builder_init(&b, buffer, sizeof(buffer));
+		if ((res = spa_node_port_enum_params(node->node,
+						     port->direction, port->port_id,
+						     t->param.idEnumFormat, &index,
+						     NULL, &format, &b)) <= 0)
+			break;
+
+		size = SPA_ROUND_UP_N(SPA_POD_SIZE(format), 8);
+		if ((p = pw_array_add(&port->enum_formats, size)) == NULL) {
+			res = -ENOMEM;
+			n_formats = 0;
+			break;
+		}
+		memcpy(p, format, size);
+		n_formats++;
+	}
+	if (res < 0 && n_formats == 0) {
+		port->enum_formats.size = 0;
+		return res;
+	}
+	port->enum_formats_valid = true;
+
+	pw_log_debug("port %p: cached %u formats", port, n_formats);
+
+	return n_formats;
+}
+
+/* the node uses the mix buffers now, the buffers that it held came from the
+ * first link, give them back and start mixing */
+static int
+do_start_mix(struct spa_loop *loop,
+	     bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct impl *impl = user_data;
+	struct pw_port *this = &impl->this;
+	struct spa_io_buffers *io = &this->io;
+	struct spa_graph_port *p, *pp = NULL;
+	uint32_t i;
+
+	if (!impl->mixing) {
+		spa_list_for_each(p, &this->rt.mix_node.ports[SPA_DIRECTION_INPUT], link) {
+			pp = p->peer;
+			break;
+		}
+		for (i = 0; pp && i < MAX_MIX_BUFFERS; i++) {
+			if (!(impl->mix_held & (1ULL << i)))
+				continue;
+			pw_log_trace("port %p: give back buffer %d", this, i);
+			spa_node_port_reuse_buffer(pp->node->implementation, pp->port_id, i);
+		}
+	}
+	impl->mix_held = 0;
+	io->status = SPA_STATUS_NEED_BUFFER;
+	io->buffer_id = SPA_ID_INVALID;
+
+	memset(impl->mix_used, 0, sizeof(impl->mix_used));
+	impl->mixing = true;
+
+	return 0;
+}
+
+static int
+do_clear_mix(struct spa_loop *loop,
+	     bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct impl *impl = user_data;
+	impl->mixing = false;
+	impl->mix_held = 0;
+	return 0;
+}
+
+static void stop_mix(struct pw_port *port)
+{
+	struct impl *impl = SPA_CONTAINER_OF(port, struct impl, this);
+
+	if (port->mix_allocation.n_buffers == 0)
+		return;
+
+	pw_log_debug("port %p: stop mixing", port);
+	pw_loop_invoke(port->node->data_loop, do_clear_mix, SPA_ID_INVALID, NULL, 0, true, impl);
+	free_allocation(&port->mix_allocation);
+}
+
+/* the buffers of the node changed, the held buffers are gone too */
+static void clear_mix(struct pw_port *port)
+{
+	struct impl *impl = SPA_CONTAINER_OF(port, struct impl, this);
+
+	if (port->mix_allocation.n_buffers > 0)
+		stop_mix(port);
+	else if (port->direction == PW_DIRECTION_INPUT)
+		pw_loop_invoke(port->node->data_loop, do_clear_mix, SPA_ID_INVALID, NULL, 0, true, impl);
+}
+
+/* the port takes ownership of the allocation. The mix buffers replace the
+ * buffers of the node, used when a link is added to an input port that
+ * already has buffers. When the node completes asynchronously, the caller
+ * must call pw_port_start_mix() with the result. */
+int pw_port_use_mix_buffers(struct pw_port *port, struct allocation *allocation)
+{
+	struct pw_node *node = port->node;
+	struct impl *impl = SPA_CONTAINER_OF(port, struct impl, this);
+	int res;
+
+	if (port->mix == NULL || impl->mix_fmt < 0)
+		return -ENOTSUP;
+
+	if (allocation->n_buffers > MAX_MIX_BUFFERS)
+		allocation->n_buffers = MAX_MIX_BUFFERS;
+
+	stop_mix(port);
+	move_allocation(allocation, &port->mix_allocation);
+
+	res = spa_node_port_use_buffers(node->node, port->direction, port->port_id,
+					port->mix_allocation.buffers,
+					port->mix_allocation.n_buffers);
+	pw_log_debug("port %p: mix %d buffers: %d (%s)", port,
+			port->mix_allocation.n_buffers, res, spa_strerror(res));
+
+	if (!SPA_RESULT_IS_ASYNC(res))
+		pw_port_start_mix(port, res);
+
+	return res;
+}
+
+int pw_port_start_mix(struct pw_port *port, int res)
+{
+	struct impl *impl = SPA_CONTAINER_OF(port, struct impl, this);
+
+	/* the buffers changed again while the node was busy */
+	if (port->mix_allocation.n_buffers == 0)
+		return 0;
+
+	if (res < 0) {
+		free_allocation(&port->mix_allocation);
+		return res;
+	}
+	return pw_loop_invoke(port->node->data_loop, do_start_mix, SPA_ID_INVALID, NULL, 0,
+			      true, impl);
+}
+
+static void update_mix_format(struct pw_port *port, const struct spa_pod *format)
+{
+	struct impl *impl = SPA_CONTAINER_OF(port, struct impl, this);
+	struct type *t = &impl->type;
+	struct spa_audio_info_raw info = { 0 };
+	uint32_t media_type, media_subtype;
+
+	impl->mix_fmt = -1;
+
+	if (format != NULL &&
+	    spa_pod_object_parse(format,
+			"I", &media_type,
+			"I", &media_subtype) >= 0 &&
+	    media_type == t->media_type.audio &&
+	    media_subtype == t->media_subtype.raw &&
+	    spa_format_audio_raw_parse(format, &info, &t->format_audio) >= 0 &&
+	    info.layout == SPA_AUDIO_LAYOUT_INTERLEAVED) {
+		if (info.format == t->audio_format.S16)
+			impl->mix_fmt = FMT_S16;
+		else if (info.format == t->audio_format.F32)
+			impl->mix_fmt = FMT_F32;
+	}
+	/* with a mix, more than one link can be made to the port */
+	port->mix = impl->mix_fmt >= 0 ? &port->mix_node : NULL;
+
+	pw_log_debug("port %p: mix format %d", port, impl->mix_fmt);
+}
+
 int pw_port_set_param(struct pw_port *port, uint32_t id, uint32_t flags,
 		      const struct spa_pod *param)
 {
@@ -665,7 +1138,15 @@ int pw_port_set_param(struct pw_port *port, uint32_t id, uint32_t flags,
 	pw_log_debug("port %p: set param %s: %d (%s)", port,
 			spa_type_map_get_type(t->map, id), res, spa_strerror(res));
 
+	/* the formats of the ports of a node can depend on the params of
+	 * the other ports */
+	pw_node_invalidate_params(node);
+
 	if (id == t->param.idFormat) {
+		if (port->direction == PW_DIRECTION_INPUT) {
+			clear_mix(port);
+			update_mix_format(port, res < 0 ? NULL : param);
+		}
 		if (param == NULL || res < 0) {
 			free_allocation(&port->allocation);
 			port->allocated = false;
@@ -692,6 +1173,8 @@ int pw_port_use_buffers(struct pw_port *port, struct spa_buffer **buffers, uint3
 	res = spa_node_port_use_buffers(node->node, port->direction, port->port_id, buffers, n_buffers);
 	pw_log_debug("port %p: use %d buffers: %d (%s)", port, n_buffers, res, spa_strerror(res));
 
+	clear_mix(port);
+
 	port->allocated = false;
 
 	free_allocation(&port->allocation);
@@ -724,6 +1207,8 @@ int pw_port_alloc_buffers(struct pw_port *port,
 					  buffers, n_buffers);
 	pw_log_debug("port %p: alloc %d buffers: %d (%s)", port, *n_buffers, res, spa_strerror(res));
 
+	clear_mix(port);
+
 	free_allocation(&port->allocation);
 
 	if (res < 0) {
@@ -106,6 +106,7 @@ struct pw_client {
 
 	struct pw_map objects;		/**< list of resource objects */
 	uint32_t n_types;		/**< number of client types */
+	uint32_t n_identity_types;	/**< number of client types with the same id as ours */
 	struct pw_map types;		/**< map of client types */
 
 	struct spa_list resource_list;	/**< The list of resources of this client */
@@ -152,6 +153,7 @@ struct pw_global {
 #define pw_core_events_info_changed(c,i)	pw_core_events_emit(c, info_changed, 0, i)
 #define pw_core_events_global_added(c,g)	pw_core_events_emit(c, global_added, 0, g)
 #define pw_core_events_global_removed(c,g)	pw_core_events_emit(c, global_removed, 0, g)
+#define pw_core_events_data_loop_added(c,l)	pw_core_events_emit(c, data_loop_added, 1, l)
 
 struct pw_core {
 	struct pw_global *global;	/**< the global of the core */
@@ -192,6 +194,18 @@ struct pw_core {
 
 	long sc_pagesize;
 
+	struct {
+		uint64_t hits;		/**< formats of a port found in the cache */
+		uint64_t misses;	/**< formats of a port enumerated from the node */
+	} format_cache;
+
+	struct {
+		struct pw_array blocks;	/**< array of struct mem_cache_entry */
+		uint32_t n_idle;	/**< number of blocks not in use */
+		uint64_t hits;		/**< buffer memory reused from the cache */
+		uint64_t misses;	/**< buffer memory newly allocated */
+	} mem_cache;
+
 	struct {
 		struct spa_graph graph;
 	} rt;
@@ -227,8 +241,12 @@ struct allocation {
 	struct pw_memblock *mem;	/**< allocated buffer memory */
 	struct spa_buffer **buffers;	/**< port buffers */
 	uint32_t n_buffers;		/**< number of port buffers */
+	struct pw_core *core;		/**< core that caches \a mem or NULL */
 };
 
+/** Give memory from \ref pw_core_alloc_memblock() back to the cache */
+void pw_core_release_memblock(struct pw_core *core, struct pw_memblock *mem);
+
 static inline void move_allocation(struct allocation *alloc, struct allocation *dest)
 {
 	*dest = *alloc;
@@ -238,7 +256,10 @@ static inline void move_allocation(struct allocation *alloc, struct allocation *
 static inline void free_allocation(struct allocation *alloc)
 {
 	if (alloc->mem) {
-		pw_memblock_free(alloc->mem);
+		if (alloc->core)
+			pw_core_release_memblock(alloc->core, alloc->mem);
+		else
+			pw_memblock_free(alloc->mem);
 		free(alloc->buffers);
 	}
 	alloc->mem = NULL;
@@ -404,9 +425,13 @@ struct pw_port {
 
 	struct spa_hook_list listener_list;
 
+	struct pw_array enum_formats;	/**< cached EnumFormat params, packed pods */
+	bool enum_formats_valid;	/**< if enum_formats is up to date */
+
 	struct spa_node *mix;		/**< optional port buffer mix/split */
 	struct spa_node mix_node;	/**< mix node implementation */
 	struct pw_map mix_port_map;	/**< map from port_id from mixer */
+	struct allocation mix_allocation;	/**< buffers the links are mixed into */
 
 	struct {
 		struct spa_graph *graph;
@@ -478,6 +503,7 @@ struct pw_remote {
         struct pw_core_info *info;		/**< info about the remote core */
 
 	uint32_t n_types;			/**< number of client types */
+	uint32_t n_identity_types;		/**< number of client types with the same id as ours */
 	struct pw_map types;			/**< client types */
 
 	struct spa_list proxy_list;		/**< list of \ref pw_proxy objects */
@@ -595,6 +621,21 @@ pw_core_find_port(struct pw_core *core,
 		  struct spa_pod **format_filters,
 		  char **error);
 
+/** Get shared memory of \a size with \a flags for the buffers of \a owner.
+ * Memory that \a owner released before is reused when it is compatible. */
+int pw_core_alloc_memblock(struct pw_core *core, const void *owner,
+			   enum pw_memblock_flags flags, size_t size,
+			   struct pw_memblock **mem);
+
+/** Free the cached memory of \a owner, memory in use is freed when released */
+void pw_core_clear_memblocks(struct pw_core *core, const void *owner);
+
+/** Announce a global on a registry resource when it passes the filter */
+void pw_core_registry_global(struct pw_resource *registry, struct pw_global *global);
+
+/** Announce the removal of a global on a registry resource */
+void pw_core_registry_global_remove(struct pw_resource *registry, struct pw_global *global);
+
 /** Create a new port \memberof pw_port
  * \return a newly allocated port */
 struct pw_port *
@@ -620,6 +661,15 @@ void pw_port_unlink(struct pw_port *port);
 /** Destroy a port \memberof pw_port */
 void pw_port_destroy(struct pw_port *port);
 
+/** Get the EnumFormat params of a port. The params are enumerated once
+ * and cached in \a port until they are invalidated. \a formats contains
+ * the packed pods.
+ * \return the number of formats or < 0 on error */
+int pw_port_get_enum_formats(struct pw_port *port, struct pw_array **formats);
+
+/** Invalidate the cached params of all ports of \a node */
+void pw_node_invalidate_params(struct pw_node *node);
+
 /** Iterate the params of the given port. The callback should return
  * 1 to fetch the next item, 0 to stop iteration or <0 on error.
  * The function returns 0 on success or the error returned by the callback. */
@@ -653,6 +703,15 @@ int pw_port_alloc_buffers(struct pw_port *port,
 			  struct spa_pod **params, uint32_t n_params,
 			  struct spa_buffer **buffers, uint32_t *n_buffers);
 
+/** Mix the links of an input port into the buffers of \a allocation \memberof pw_port */
+int pw_port_use_mix_buffers(struct pw_port *port, struct allocation *allocation);
+/** Start mixing after the node used the mix buffers with result \a res \memberof pw_port */
+int pw_port_start_mix(struct pw_port *port, int res);
+
+/** Release the buffers that the link with \a port_id still holds on an
+ * output port, called from the data thread when the link is removed */
+void pw_port_release_link_buffers(struct pw_port *port, uint32_t port_id);
+
 /** Send a command to a port */
 int pw_port_send_command(struct pw_port *port, bool block, const struct spa_command *command);
 
@@ -664,6 +723,10 @@ void pw_node_update_state(struct pw_node *node, enum pw_node_state state, char *
 
 int pw_node_update_ports(struct pw_node *node);
 
+/** Give the nodes that are linked to \a node the lowest latency that any
+ * of the linked nodes wants, called when links are added or removed */
+void pw_node_update_quantum(struct pw_node *node);
+
 /** Activate a link \memberof pw_link
   * Starts the negotiation of formats and buffers on \a link and then
   * starts data streaming */
@@ -17,30 +17,100 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#include <errno.h>
 #include <stdio.h>
 
 #include "pipewire/pipewire.h"
 #include "pipewire/properties.h"
 
 /** \cond */
+/* use a hash table to find keys when there are more items than this */
+#define INDEX_MIN_ITEMS	8
+
 struct properties {
 	struct pw_properties this;
 
 	struct pw_array items;
+	struct pw_array hashes;		/* uint32_t hash of the key of each item */
+	uint32_t *index;		/* open addressing table of item index + 1 */
+	uint32_t index_mask;
+
+	bool frozen;			/* read-only, items are sorted on key */
+	int refcount;
 };
 /** \endcond */
 
+/* FNV-1a */
+static inline uint32_t hash_key(const char *key)
+{
+	uint32_t hash = 2166136261u;
+
+	for (; *key; key++)
+		hash = (hash ^ (uint8_t) *key) * 16777619u;
+	return hash;
+}
+
+static inline uint32_t *get_hashes(struct properties *impl)
+{
+	return impl->hashes.data;
+}
+
+static void index_insert(struct properties *impl, uint32_t hash, int idx)
+{
+	uint32_t i;
+
+	for (i = hash & impl->index_mask; impl->index[i]; i = (i + 1) & impl->index_mask);
+	impl->index[i] = idx + 1;
+}
+
+static int build_index(struct properties *impl)
+{
+	int i, len = pw_array_get_len(&impl->items, struct spa_dict_item);
+	uint32_t size;
+
+	free(impl->index);
+	impl->index = NULL;
+	impl->index_mask = 0;
+
+	if (len <= INDEX_MIN_ITEMS)
+		return 0;
+
+	/* keep the table at most half full */
+	for (size = 32; size < (uint32_t) len * 2; size <<= 1);
+
+	if ((impl->index = calloc(size, sizeof(uint32_t))) == NULL)
+		return -ENOMEM;
+	impl->index_mask = size - 1;
+
+	for (i = 0; i < len; i++)
+		index_insert(impl, get_hashes(impl)[i], i);
+
+	return 0;
+}
+
 static int add_func(struct pw_properties *this, char *key, char *value)
 {
 	struct spa_dict_item *item;
 	struct properties *impl = SPA_CONTAINER_OF(this, struct properties, this);
+	uint32_t *hash;
+	int idx;
 
 	item = pw_array_add(&impl->items, sizeof(struct spa_dict_item));
 	item->key = key;
 	item->value = value;
 
+	hash = pw_array_add(&impl->hashes, sizeof(uint32_t));
+	*hash = hash_key(key);
+
 	this->dict.items = impl->items.data;
 	this->dict.n_items = pw_array_get_len(&impl->items, struct spa_dict_item);
+
+	idx = this->dict.n_items - 1;
+	if (impl->index != NULL && (uint32_t) this->dict.n_items * 2 <= impl->index_mask + 1)
+		index_insert(impl, *hash, idx);
+	else if (this->dict.n_items > INDEX_MIN_ITEMS)
+		build_index(impl);
+
 	return 0;
 }
 
@@ -50,15 +120,43 @@ static void clear_item(struct spa_dict_item *item)
 	free((char *) item->value);
 }
 
+static int compare_items(const void *a, const void *b)
+{
+	const struct spa_dict_item *ia = a, *ib = b;
+	return strcmp(ia->key, ib->key);
+}
+
 static int find_index(const struct pw_properties *this, const char *key)
 {
 	struct properties *impl = SPA_CONTAINER_OF(this, struct properties, this);
 	int i, len = pw_array_get_len(&impl->items, struct spa_dict_item);
+	uint32_t hash, idx;
+
+	if (impl->frozen) {
+		struct spa_dict_item k = { key, NULL }, *item;
+
+		item = bsearch(&k, impl->items.data, len, sizeof(struct spa_dict_item),
+			       compare_items);
+		return item ? item - (struct spa_dict_item *) impl->items.data : -1;
+	}
+
+	hash = hash_key(key);
+
+	if (impl->index != NULL) {
+		for (i = hash & impl->index_mask; (idx = impl->index[i]) != 0;
+		     i = (i + 1) & impl->index_mask) {
+			struct spa_dict_item *item =
+			    pw_array_get_unchecked(&impl->items, idx - 1, struct spa_dict_item);
+			if (get_hashes(impl)[idx - 1] == hash && strcmp(item->key, key) == 0)
+				return idx - 1;
+		}
+		return -1;
+	}
 
 	for (i = 0; i < len; i++) {
 		struct spa_dict_item *item =
 		    pw_array_get_unchecked(&impl->items, i, struct spa_dict_item);
-		if (strcmp(item->key, key) == 0)
+		if (get_hashes(impl)[i] == hash && strcmp(item->key, key) == 0)
 			return i;
 	}
 	return -1;
@@ -73,6 +171,7 @@ static struct properties *properties_new(int prealloc)
 		return NULL;
 
 	pw_array_init(&impl->items, prealloc);
+	pw_array_init(&impl->hashes, prealloc);
 
 	return impl;
 }
@@ -240,34 +339,59 @@ void pw_properties_free(struct pw_properties *properties)
 	struct properties *impl = SPA_CONTAINER_OF(properties, struct properties, this);
 	struct spa_dict_item *item;
 
+	/* frozen properties are one allocation */
+	if (impl->frozen) {
+		if (--impl->refcount == 0)
+			free(impl);
+		return;
+	}
+
 	pw_array_for_each(item, &impl->items)
 	    clear_item(item);
 
 	pw_array_clear(&impl->items);
+	pw_array_clear(&impl->hashes);
+	free(impl->index);
 	free(impl);
 }
 
 static int do_replace(struct pw_properties *properties, const char *key, char *value)
 {
 	struct properties *impl = SPA_CONTAINER_OF(properties, struct properties, this);
-	int index = find_index(properties, key);
+	int index;
+
+	if (impl->frozen) {
+		free(value);
+		return -EPERM;
+	}
+
+	index = find_index(properties, key);
 
 	if (index == -1) {
-		add_func(properties, strdup(key), value);
+		if (value != NULL)
+			add_func(properties, strdup(key), value);
 	} else {
 		struct spa_dict_item *item =
 		    pw_array_get_unchecked(&impl->items, index, struct spa_dict_item);
 
-		clear_item(item);
 		if (value == NULL) {
+			int last = pw_array_get_len(&impl->items, struct spa_dict_item) - 1;
 			struct spa_dict_item *other = pw_array_get_unchecked(&impl->items,
-						     pw_array_get_len(&impl->items, struct spa_dict_item) - 1,
-						     struct spa_dict_item);
+						     last, struct spa_dict_item);
+
+			clear_item(item);
 			item->key = other->key;
 			item->value = other->value;
+			get_hashes(impl)[index] = get_hashes(impl)[last];
 			impl->items.size -= sizeof(struct spa_dict_item);
+			impl->hashes.size -= sizeof(uint32_t);
+			properties->dict.n_items--;
+
+			/* the last item moved, removing is rare so just rebuild */
+			if (impl->index != NULL)
+				build_index(impl);
 		} else {
-			item->key = strdup(key);
+			free((char *) item->value);
 			item->value = value;
 		}
 	}
@@ -336,6 +460,71 @@ const char *pw_properties_get(const struct pw_properties *properties, const char
 	return pw_array_get_unchecked(&impl->items, index, struct spa_dict_item)->value;
 }
 
+/** Make a frozen copy of properties
+ *
+ * \param properties properties to freeze
+ * \return a read-only properties object
+ *
+ * The keys and values are copied into one allocation with the items
+ * sorted on key. The frozen properties can't be changed,
+ * pw_properties_set() returns -EPERM. Freezing frozen properties returns
+ * the same object with an extra reference, so one copy can be shared.
+ * Each reference is released with pw_properties_free().
+ *
+ * \memberof pw_properties
+ */
+struct pw_properties *pw_properties_freeze(const struct pw_properties *properties)
+{
+	struct properties *impl = SPA_CONTAINER_OF(properties, struct properties, this);
+	struct properties *frozen;
+	struct spa_dict_item *items;
+	uint32_t i, n_items = properties->dict.n_items;
+	size_t size = 0, len;
+	char *p;
+
+	if (impl->frozen) {
+		impl->refcount++;
+		return &impl->this;
+	}
+
+	for (i = 0; i < n_items; i++) {
+		size += strlen(properties->dict.items[i].key) + 1;
+		if (properties->dict.items[i].value)
+			size += strlen(properties->dict.items[i].value) + 1;
+	}
+
+	frozen = calloc(1, sizeof(struct properties) +
+			   n_items * sizeof(struct spa_dict_item) + size);
+	if (frozen == NULL)
+		return NULL;
+
+	items = SPA_MEMBER(frozen, sizeof(struct properties), struct spa_dict_item);
+	p = SPA_MEMBER(items, n_items * sizeof(struct spa_dict_item), char);
+
+	memcpy(items, properties->dict.items, n_items * sizeof(struct spa_dict_item));
+	qsort(items, n_items, sizeof(struct spa_dict_item), compare_items);
+
+	for (i = 0; i < n_items; i++) {
+		len = strlen(items[i].key) + 1;
+		items[i].key = memcpy(p, items[i].key, len);
+		p += len;
+		if (items[i].value) {
+			len = strlen(items[i].value) + 1;
+			items[i].value = memcpy(p, items[i].value, len);
+			p += len;
+		}
+	}
+
+	frozen->items.data = items;
+	frozen->items.size = frozen->items.alloc = n_items * sizeof(struct spa_dict_item);
+	frozen->this.dict.items = items;
+	frozen->this.dict.n_items = n_items;
+	frozen->frozen = true;
+	frozen->refcount = 1;
+
+	return &frozen->this;
+}
+
 /** Iterate property values
  *
  * \param properties a \ref pw_properties
@@ -55,6 +55,9 @@ struct pw_properties *
 pw_properties_merge(const struct pw_properties *oldprops,
 		    struct pw_properties *newprops);
 
+struct pw_properties *
+pw_properties_freeze(const struct pw_properties *properties);
+
 void
 pw_properties_free(struct pw_properties *properties);
 
@@ -23,6 +23,7 @@
 #include <sys/un.h>
 #include <errno.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <spa/pod/parser.h>
 
@@ -50,6 +51,8 @@ struct mem_id {
 	int fd;
 	uint32_t flags;
 	uint32_t ref;
+	dev_t dev;		/**< device and inode of fd, to detect the same memory */
+	ino_t ino;
 	struct pw_map_range map;
 	void *ptr;
 };
@@ -197,6 +200,8 @@ core_event_update_types(void *data, uint32_t first_id, const char **types, uint3
 		uint32_t this_id = spa_type_map_get_id(this->core->type.map, types[i]);
 		if (!pw_map_insert_at(&this->types, first_id, PW_MAP_ID_TO_PTR(this_id)))
 			pw_log_error("can't add type for client");
+		else if (first_id == this->n_identity_types && this_id == first_id)
+			this->n_identity_types++;
 	}
 }
 
@@ -450,6 +455,7 @@ int pw_remote_disconnect(struct pw_remote *remote)
 	pw_map_clear(&remote->objects);
 	pw_map_clear(&remote->types);
 	remote->n_types = 0;
+	remote->n_identity_types = 0;
 
 	if (remote->info) {
 		pw_core_info_free (remote->info);
@@ -544,11 +550,13 @@ on_rtsocket_condition(void *user_data, int fd, enum spa_io mask)
 			pw_log_warn("proxy %p: %ld messages", proxy, cmd);
 
 
-		while (pw_client_node_transport_next_message(data->trans, &message) == 1) {
-			struct pw_client_node_message *msg = alloca(SPA_POD_SIZE(&message));
-			pw_client_node_transport_parse_message(data->trans, msg);
-			handle_rtnode_message(proxy, msg);
-		}
+		do {
+			while (pw_client_node_transport_next_message(data->trans, &message) == 1) {
+				struct pw_client_node_message *msg = alloca(SPA_POD_SIZE(&message));
+				pw_client_node_transport_parse_message(data->trans, msg);
+				handle_rtnode_message(proxy, msg);
+			}
+		} while (pw_client_node_transport_idle(data->trans));
 	}
 }
 
@@ -563,10 +571,17 @@ static struct mem_id *find_mem(struct pw_array *mem_ids, uint32_t id)
 	return NULL;
 }
 
+/* map the complete memory once, all users of the memory take their
+ * pointer from this mapping */
 static void *mem_map(struct node_data *data, struct mem_id *mid, uint32_t offset, uint32_t size)
 {
 	if (mid->ptr == NULL) {
-		pw_map_range_init(&mid->map, offset, size, data->core->sc_pagesize);
+		struct stat st;
+
+		if (fstat(mid->fd, &st) == 0 && st.st_size >= (off_t) offset + size)
+			pw_map_range_init(&mid->map, 0, st.st_size, data->core->sc_pagesize);
+		else
+			pw_map_range_init(&mid->map, offset, size, data->core->sc_pagesize);
 
 		mid->ptr = mmap(NULL, mid->map.size, PROT_READ|PROT_WRITE,
 				MAP_SHARED, mid->fd, mid->map.offset);
@@ -576,8 +591,19 @@ static void *mem_map(struct node_data *data, struct mem_id *mid, uint32_t offset
 			mid->ptr = NULL;
 			return NULL;
 		}
+		if (mlock(mid->ptr, mid->map.size) < 0)
+			pw_log_warn("Failed to mlock memory %u %u: %m",
+					mid->map.offset, mid->map.size);
+
+		pw_log_debug("mem %u mapped %u %u", mid->id, mid->map.offset, mid->map.size);
 	}
-	return SPA_MEMBER(mid->ptr, mid->map.start, void);
+	if (offset < mid->map.offset ||
+	    (uint64_t) offset + size > (uint64_t) mid->map.offset + mid->map.size) {
+		pw_log_error("range %u %u outside of mem %u", offset, size, mid->id);
+		errno = EINVAL;
+		return NULL;
+	}
+	return SPA_MEMBER(mid->ptr, offset - mid->map.offset, void);
 }
 static void mem_unmap(struct node_data *data, struct mem_id *mid)
 {
@@ -672,21 +698,40 @@ static void client_node_add_mem(void *object,
 	struct pw_proxy *proxy = object;
 	struct node_data *data = proxy->user_data;
 	struct mem_id *m;
+	struct stat st;
+
+	if (fstat(memfd, &st) < 0)
+		st.st_dev = st.st_ino = 0;
 
 	m = find_mem(&data->mem_ids, mem_id);
-	if (m) {
-		pw_log_warn("duplicate mem %u, fd %d, flags %d",
-			     mem_id, memfd, flags);
+	if (m && st.st_ino != 0 && m->dev == st.st_dev && m->ino == st.st_ino) {
+		/* same memory, keep the mapping */
+		pw_log_debug("reuse mem %u, fd %d, flags %d", mem_id, memfd, flags);
+		close(memfd);
+		m->flags = flags;
 		return;
 	}
-
-	m = pw_array_add(&data->mem_ids, sizeof(struct mem_id));
-	pw_log_debug("add mem %u, fd %d, flags %d", mem_id, memfd, flags);
+	if (m) {
+		if (m->ref > 0) {
+			pw_log_warn("duplicate mem %u, fd %d, flags %d",
+				     mem_id, memfd, flags);
+			close(memfd);
+			return;
+		}
+		pw_log_debug("update mem %u, fd %d, flags %d", mem_id, memfd, flags);
+		clear_memid(data, m);
+	}
+	else {
+		m = pw_array_add(&data->mem_ids, sizeof(struct mem_id));
+		pw_log_debug("add mem %u, fd %d, flags %d", mem_id, memfd, flags);
+	}
 
 	m->id = mem_id;
 	m->fd = memfd;
 	m->flags = flags;
 	m->ref = 0;
+	m->dev = st.st_dev;
+	m->ino = st.st_ino;
 	m->map = PW_MAP_RANGE_INIT;
 	m->ptr = NULL;
 }
@@ -841,19 +886,17 @@ static void client_node_event(void *object, const struct spa_event *event)
 static void node_need_input(void *data)
 {
 	struct node_data *d = data;
-        uint64_t cmd = 1;
 	pw_client_node_transport_add_message(d->trans,
 				&PW_CLIENT_NODE_MESSAGE_INIT(PW_CLIENT_NODE_MESSAGE_NEED_INPUT));
-        write(d->rtwritefd, &cmd, 8);
+	pw_client_node_transport_signal(d->trans, d->rtwritefd);
 }
 
 static void node_have_output(void *data)
 {
 	struct node_data *d = data;
-        uint64_t cmd = 1;
-        pw_client_node_transport_add_message(d->trans,
-                               &PW_CLIENT_NODE_MESSAGE_INIT(PW_CLIENT_NODE_MESSAGE_HAVE_OUTPUT));
-        write(d->rtwritefd, &cmd, 8);
+	pw_client_node_transport_add_message(d->trans,
+			       &PW_CLIENT_NODE_MESSAGE_INIT(PW_CLIENT_NODE_MESSAGE_HAVE_OUTPUT));
+	pw_client_node_transport_signal(d->trans, d->rtwritefd);
 }
 
 static void client_node_command(void *object, uint32_t seq, const struct spa_command *command)
@@ -967,15 +1010,11 @@ static void clear_buffers(struct node_data *data, struct port *port)
 	pw_port_use_buffers(port->port, NULL, 0);
 
         pw_array_for_each(bid, &port->buffer_ids) {
-		if (bid->ptr != NULL) {
-			if (munmap(bid->ptr, bid->map.size) < 0)
-				pw_log_warn("failed to unmap: %m");
-		}
+		/* the memory stays mapped until it is removed or replaced, so
+		 * that it can be reused for the next buffers */
 		if (bid->mem != NULL) {
-			for (i = 0; i < bid->n_mem; i++) {
-				if (--bid->mem[i]->ref == 0)
-					clear_memid(data, bid->mem[i]);
-			}
+			for (i = 0; i < bid->n_mem; i++)
+				bid->mem[i]->ref--;
 			bid->mem = NULL;
 			bid->n_mem = 0;
 		}
@@ -1000,7 +1039,7 @@ client_node_port_use_buffers(void *object,
 	struct port *port;
 	struct pw_core *core = proxy->remote->core;
 	struct pw_type *t = &core->type;
-	int res, prot;
+	int res;
 
 	port = find_port(data, direction, port_id);
 	if (port == NULL) {
@@ -1008,8 +1047,6 @@ client_node_port_use_buffers(void *object,
 		goto done;
 	}
 
-	prot = PROT_READ | (direction == SPA_DIRECTION_OUTPUT ? PROT_WRITE : 0);
-
 	/* clear previous buffers */
 	clear_buffers(data, port);
 
@@ -1028,19 +1065,20 @@ client_node_port_use_buffers(void *object,
 		len = pw_array_get_len(&port->buffer_ids, struct buffer_id);
 		bid = pw_array_add(&port->buffer_ids, sizeof(struct buffer_id));
 
-		pw_map_range_init(&bid->map, buffers[i].offset, buffers[i].size, core->sc_pagesize);
+		bid->map = PW_MAP_RANGE_INIT;
+		bid->map.offset = buffers[i].offset;
+		bid->map.size = buffers[i].size;
+		bid->mem = NULL;
+		bid->n_mem = 0;
+		bid->buf = NULL;
 
-		bid->ptr = mmap(NULL, bid->map.size, prot, MAP_SHARED, mid->fd, bid->map.offset);
-		if (bid->ptr == MAP_FAILED) {
-			bid->ptr = NULL;
+		bid->ptr = mem_map(data, mid, buffers[i].offset, buffers[i].size);
+		if (bid->ptr == NULL) {
 			pw_log_error("Failed to mmap memory %u %u %u %d: %m",
 				bid->map.offset, bid->map.size, buffers[i].mem_id, mid->fd);
 			res = -errno;
 			goto cleanup;
 		}
-		if (mlock(bid->ptr, bid->map.size) < 0)
-			pw_log_warn("Failed to mlock memory %u %u: %m",
-					bid->map.offset, bid->map.size);
 
 		b = buffers[i].buffer;
 
@@ -21,6 +21,7 @@
 #include <sys/socket.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <errno.h>
 #include <time.h>
 
@@ -30,6 +31,7 @@
 #include "pipewire/private.h"
 #include "pipewire/interfaces.h"
 #include "pipewire/array.h"
+#include "pipewire/data-loop.h"
 #include "pipewire/stream.h"
 #include "pipewire/utils.h"
 #include "extensions/client-node.h"
@@ -47,8 +49,11 @@ struct mem {
 	int fd;
 	uint32_t flags;
 	uint32_t ref;
+	dev_t dev;		/**< device and inode of fd, to detect the same memory */
+	ino_t ino;
 	struct pw_map_range map;
 	void *ptr;
+	int prot;		/**< protection of the mapping */
 };
 
 struct buffer {
@@ -90,6 +95,9 @@ struct stream {
 
 	enum pw_stream_flags flags;
 
+	struct pw_data_loop *data_loop_impl;	/**< our own data thread, with RT_THREAD */
+	struct pw_loop *data_loop;
+
 	int rtwritefd;
 	struct spa_source *rtsocket_source;
 
@@ -105,6 +113,7 @@ struct stream {
 	struct pw_array mem_ids;
 
 	struct spa_io_buffers *io;
+	struct mem *io_mem;
 
 	bool client_reuse;
 	struct queue dequeue;
@@ -130,21 +139,44 @@ static struct mem *find_mem(struct pw_stream *stream, uint32_t id)
 	return NULL;
 }
 
-static void *mem_map(struct pw_stream *stream, struct mem *m, uint32_t offset, uint32_t size)
+/* map the complete memory once, all users of the memory take their
+ * pointer from this mapping */
+static void *mem_map(struct pw_stream *stream, struct mem *m, uint32_t offset, uint32_t size,
+		int prot)
 {
+	if (m->ptr != NULL && (m->prot & prot) != prot) {
+		pw_log_error("stream %p: mem %u is mapped with prot %d, need %d",
+				stream, m->id, m->prot, prot);
+		errno = EACCES;
+		return NULL;
+	}
 	if (m->ptr == NULL) {
-		pw_map_range_init(&m->map, offset, size, stream->remote->core->sc_pagesize);
+		struct stat st;
+
+		if (fstat(m->fd, &st) == 0 && st.st_size >= (off_t) offset + size)
+			pw_map_range_init(&m->map, 0, st.st_size, stream->remote->core->sc_pagesize);
+		else
+			pw_map_range_init(&m->map, offset, size, stream->remote->core->sc_pagesize);
 
-		m->ptr = mmap(NULL, m->map.size, PROT_READ|PROT_WRITE,
-				MAP_SHARED, m->fd, m->map.offset);
+		m->ptr = mmap(NULL, m->map.size, prot, MAP_SHARED, m->fd, m->map.offset);
+		m->prot = prot;
 
 		if (m->ptr == MAP_FAILED) {
 			pw_log_error("stream %p: Failed to mmap memory %d %p: %m", stream, size, m);
 			m->ptr = NULL;
 			return NULL;
 		}
+		pw_log_debug("stream %p: mem %u mapped %u %u", stream, m->id,
+				m->map.offset, m->map.size);
+	}
+	if (offset < m->map.offset ||
+	    (uint64_t) offset + size > (uint64_t) m->map.offset + m->map.size) {
+		pw_log_error("stream %p: range %u %u outside of mem %u", stream,
+				offset, size, m->id);
+		errno = EINVAL;
+		return NULL;
 	}
-	return SPA_MEMBER(m->ptr, m->map.start, void);
+	return SPA_MEMBER(m->ptr, offset - m->map.offset, void);
 }
 
 static void mem_unmap(struct stream *impl, struct mem *m)
@@ -179,6 +211,14 @@ static void clear_mem(struct stream *impl, struct mem *m)
 	}
 }
 
+/* the memory is unmapped and closed when the last user is gone, the
+ * server sends it again for new buffers */
+static void mem_unref(struct stream *impl, struct mem *m)
+{
+	if (m->ref > 0 && --m->ref == 0)
+		clear_mem(impl, m);
+}
+
 static void clear_mems(struct pw_stream *stream)
 {
 	struct stream *impl = SPA_CONTAINER_OF(stream, struct stream, this);
@@ -187,6 +227,7 @@ static void clear_mems(struct pw_stream *stream)
 	pw_array_for_each(m, &impl->mem_ids)
 		clear_mem(impl, m);
 	impl->mem_ids.size = 0;
+	impl->io_mem = NULL;
 }
 
 static int map_data(struct stream *impl, struct spa_data *data, int prot)
@@ -239,15 +280,17 @@ static void clear_buffers(struct pw_stream *stream)
 		if (SPA_FLAG_CHECK(b->flags, BUFFER_FLAG_MAPPED)) {
 			for (j = 0; j < b->buffer.buffer->n_datas; j++) {
 				struct spa_data *d = &b->buffer.buffer->datas[j];
+				if (d->type != stream->remote->core->type.data.DmaBuf)
+					continue;
 				pw_log_debug("stream %p: clear buffer %d mem",
 						stream, b->id);
 				unmap_data(impl, d);
 			}
 		}
 
-		if (b->ptr != NULL)
-			if (munmap(b->ptr, b->map.size) < 0)
-				pw_log_warn("failed to unmap buffer: %m");
+		for (j = 0; j < b->n_mem; j++)
+			mem_unref(impl, b->mem[j]);
+		b->n_mem = 0;
 		b->ptr = NULL;
 		free(b->buffer.buffer);
 		b->buffer.buffer = NULL;
@@ -340,7 +383,7 @@ do_call_process(struct spa_loop *loop,
 
 static void call_process(struct stream *impl)
 {
-	if (SPA_FLAG_CHECK(impl->flags, PW_STREAM_FLAG_RT_PROCESS)) {
+	if (impl->flags & (PW_STREAM_FLAG_RT_PROCESS | PW_STREAM_FLAG_RT_THREAD)) {
 		do_call_process(NULL, false, 1, NULL, 0, impl);
 	}
 	else {
@@ -397,6 +440,7 @@ struct pw_stream *pw_stream_new(struct pw_remote *remote,
 	this->remote = remote;
 	this->name = strdup(name);
 	impl->type_client_node = spa_type_map_get_id(remote->core->type.map, PW_TYPE_INTERFACE__ClientNode);
+	impl->data_loop = remote->core->data_loop;
 	impl->rtwritefd = -1;
 
 	str = pw_properties_get(props, "pipewire.client.reuse");
@@ -460,10 +504,9 @@ do_remove_sources(struct spa_loop *loop,
                   bool async, uint32_t seq, const void *data, size_t size, void *user_data)
 {
 	struct stream *impl = user_data;
-	struct pw_stream *stream = &impl->this;
 
 	if (impl->rtsocket_source) {
-		pw_loop_destroy_source(stream->remote->core->data_loop, impl->rtsocket_source);
+		pw_loop_destroy_source(impl->data_loop, impl->rtsocket_source);
 		impl->rtsocket_source = NULL;
 	}
 	if (impl->rtwritefd != -1) {
@@ -481,7 +524,7 @@ static void unhandle_socket(struct pw_stream *stream)
 		pw_loop_destroy_source(stream->remote->core->main_loop, impl->timeout_source);
 		impl->timeout_source = NULL;
 	}
-        pw_loop_invoke(stream->remote->core->data_loop,
+        pw_loop_invoke(impl->data_loop,
                        do_remove_sources, 1, NULL, 0, true, impl);
 }
 
@@ -536,6 +579,9 @@ void pw_stream_destroy(struct pw_stream *stream)
 
 	pw_stream_disconnect(stream);
 
+	if (impl->data_loop_impl)
+		pw_data_loop_destroy(impl->data_loop_impl);
+
 	spa_list_remove(&stream->link);
 
 	pw_array_clear(&impl->mem_ids);
@@ -600,34 +646,31 @@ static void add_port_update(struct pw_stream *stream, uint32_t change_mask)
 static inline void send_need_input(struct pw_stream *stream)
 {
 	struct stream *impl = SPA_CONTAINER_OF(stream, struct stream, this);
-	uint64_t cmd = 1;
 
 	pw_log_trace("send");
 	pw_client_node_transport_add_message(impl->trans,
 			       &PW_CLIENT_NODE_MESSAGE_INIT(PW_CLIENT_NODE_MESSAGE_NEED_INPUT));
-	write(impl->rtwritefd, &cmd, 8);
+	pw_client_node_transport_signal(impl->trans, impl->rtwritefd);
 }
 
 static inline void send_have_output(struct pw_stream *stream)
 {
 	struct stream *impl = SPA_CONTAINER_OF(stream, struct stream, this);
-	uint64_t cmd = 1;
 
 	pw_log_trace("send");
 	pw_client_node_transport_add_message(impl->trans,
 			       &PW_CLIENT_NODE_MESSAGE_INIT(PW_CLIENT_NODE_MESSAGE_HAVE_OUTPUT));
-	write(impl->rtwritefd, &cmd, 8);
+	pw_client_node_transport_signal(impl->trans, impl->rtwritefd);
 }
 
 static inline void send_reuse_buffer(struct pw_stream *stream, uint32_t id)
 {
 	struct stream *impl = SPA_CONTAINER_OF(stream, struct stream, this);
-	uint64_t cmd = 1;
 
 	pw_log_trace("send");
 	pw_client_node_transport_add_message(impl->trans, (struct pw_client_node_message*)
 			       &PW_CLIENT_NODE_MESSAGE_PORT_REUSE_BUFFER_INIT(impl->port_id, id));
-	write(impl->rtwritefd, &cmd, 8);
+	pw_client_node_transport_signal(impl->trans, impl->rtwritefd);
 }
 
 static void add_async_complete(struct pw_stream *stream, uint32_t seq, int res)
@@ -809,7 +852,7 @@ on_rtsocket_condition(void *data, int fd, enum spa_io mask)
 
 	if (mask & (SPA_IO_ERR | SPA_IO_HUP)) {
 		pw_log_warn("got error");
-		do_remove_sources(stream->remote->core->data_loop->loop, false, 0, NULL, 0, impl);
+		do_remove_sources(impl->data_loop->loop, false, 0, NULL, 0, impl);
 		return;
 	}
 
@@ -820,11 +863,13 @@ on_rtsocket_condition(void *data, int fd, enum spa_io mask)
 		if (read(fd, &cmd, sizeof(uint64_t)) != sizeof(uint64_t))
 			pw_log_warn("stream %p: read failed %m", impl);
 
-		while (pw_client_node_transport_next_message(impl->trans, &message) == 1) {
-			struct pw_client_node_message *msg = alloca(SPA_POD_SIZE(&message));
-			pw_client_node_transport_parse_message(impl->trans, msg);
-			handle_rtnode_message(stream, msg);
-		}
+		do {
+			while (pw_client_node_transport_next_message(impl->trans, &message) == 1) {
+				struct pw_client_node_message *msg = alloca(SPA_POD_SIZE(&message));
+				pw_client_node_transport_parse_message(impl->trans, msg);
+				handle_rtnode_message(stream, msg);
+			}
+		} while (pw_client_node_transport_idle(impl->trans));
 	}
 }
 
@@ -834,7 +879,7 @@ static void handle_socket(struct pw_stream *stream, int rtreadfd, int rtwritefd)
 	struct timespec interval;
 
 	impl->rtwritefd = rtwritefd;
-	impl->rtsocket_source = pw_loop_add_io(stream->remote->core->data_loop,
+	impl->rtsocket_source = pw_loop_add_io(impl->data_loop,
 					       rtreadfd,
 					       SPA_IO_ERR | SPA_IO_HUP,
 					       true, on_rtsocket_condition, stream);
@@ -871,7 +916,7 @@ static void client_node_command(void *data, uint32_t seq, const struct spa_comma
 		if (stream->state == PW_STREAM_STATE_STREAMING) {
 			pw_log_debug("stream %p: pause %d", stream, seq);
 
-			pw_loop_update_io(stream->remote->core->data_loop,
+			pw_loop_update_io(impl->data_loop,
 					  impl->rtsocket_source, SPA_IO_ERR | SPA_IO_HUP);
 
 			stream_set_state(stream, PW_STREAM_STATE_PAUSED, NULL);
@@ -884,7 +929,7 @@ static void client_node_command(void *data, uint32_t seq, const struct spa_comma
 
 			pw_log_debug("stream %p: start %d %d", stream, seq, impl->direction);
 
-			pw_loop_update_io(stream->remote->core->data_loop,
+			pw_loop_update_io(impl->data_loop,
 					  impl->rtsocket_source,
 					  SPA_IO_IN | SPA_IO_ERR | SPA_IO_HUP);
 
@@ -982,8 +1027,21 @@ client_node_add_mem(void *data,
 	struct stream *impl = data;
 	struct pw_stream *stream = &impl->this;
 	struct mem *m;
+	struct stat st;
+
+	if (fstat(memfd, &st) < 0)
+		st.st_dev = st.st_ino = 0;
 
 	m = find_mem(stream, mem_id);
+	if (m && m->ptr != NULL && st.st_ino != 0 &&
+	    m->dev == st.st_dev && m->ino == st.st_ino) {
+		/* same memory, keep the mapping */
+		pw_log_debug("reuse mem %u, fd %d, flags %d",
+			     mem_id, memfd, flags);
+		close(memfd);
+		m->flags = flags;
+		return;
+	}
 	if (m) {
 		pw_log_debug("update mem %u, fd %d, flags %d",
 			     mem_id, memfd, flags);
@@ -996,6 +1054,9 @@ client_node_add_mem(void *data,
 	m->id = mem_id;
 	m->fd = memfd;
 	m->flags = flags;
+	m->ref = 0;
+	m->dev = st.st_dev;
+	m->ino = st.st_ino;
 	m->map = PW_MAP_RANGE_INIT;
 	m->ptr = NULL;
 }
@@ -1034,13 +1095,13 @@ client_node_port_use_buffers(void *data,
 		bid->flags = 0;
 		b = buffers[i].buffer;
 
-		pw_map_range_init(&bid->map, buffers[i].offset, buffers[i].size,
-				core->sc_pagesize);
+		bid->map = PW_MAP_RANGE_INIT;
+		bid->map.offset = buffers[i].offset;
+		bid->map.size = buffers[i].size;
 
-		bid->ptr = mmap(NULL, bid->map.size, prot, MAP_SHARED, m->fd, bid->map.offset);
-		if (bid->ptr == MAP_FAILED) {
-			bid->ptr = NULL;
-			pw_log_warn("Failed to mmap memory %d %p: %s", bid->map.size, m,
+		bid->ptr = mem_map(stream, m, buffers[i].offset, buffers[i].size, prot);
+		if (bid->ptr == NULL) {
+			pw_log_warn("Failed to map memory %d %p: %s", buffers[i].size, m,
 				    strerror(errno));
 			continue;
 		}
@@ -1099,7 +1160,13 @@ client_node_port_use_buffers(void *data,
 				pw_log_debug(" data %d %u -> fd %d", j, bm->id, bm->fd);
 
 				if (SPA_FLAG_CHECK(impl->flags, PW_STREAM_FLAG_MAP_BUFFERS)) {
-					if (map_data(impl, d, prot) < 0)
+					if (d->type == t->data.MemFd) {
+						d->data = mem_map(stream, bm, d->mapoffset,
+								  d->maxsize, prot);
+						if (d->data == NULL)
+							return;
+					}
+					else if (map_data(impl, d, prot) < 0)
 						return;
 					SPA_FLAG_SET(bid->flags, BUFFER_FLAG_MAPPED);
 				}
@@ -1125,10 +1192,8 @@ client_node_port_use_buffers(void *data,
 
 	if (n_buffers)
 		stream_set_state(stream, PW_STREAM_STATE_PAUSED, NULL);
-	else {
-		clear_mems(stream);
+	else
 		stream_set_state(stream, PW_STREAM_STATE_READY, NULL);
-	}
 }
 
 static void
@@ -1173,7 +1238,7 @@ static void client_node_port_set_io(void *data,
 	struct pw_stream *stream = &impl->this;
 	struct pw_core *core = stream->remote->core;
 	struct pw_type *t = &core->type;
-	struct mem *m;
+	struct mem *m = NULL;
 	void *ptr;
 	int res;
 
@@ -1188,13 +1253,18 @@ static void client_node_port_set_io(void *data,
 			res = -EINVAL;
 			goto exit;
 		}
-		if ((ptr = mem_map(stream, m, offset, size)) == NULL) {
+		if ((ptr = mem_map(stream, m, offset, size, PROT_READ | PROT_WRITE)) == NULL) {
 			res = -errno;
 			goto exit;
 		}
 	}
 
 	if (id == t->io.Buffers) {
+		if (m)
+			m->ref++;
+		if (impl->io_mem)
+			mem_unref(impl, impl->io_mem);
+		impl->io_mem = m;
 		impl->io = ptr;
 		pw_log_debug("stream %p: set io id %u %p", stream, id, ptr);
 	}
@@ -1267,6 +1337,21 @@ pw_stream_connect(struct pw_stream *stream,
 	impl->port_id = 0;
 	impl->flags = flags;
 
+	if (SPA_FLAG_CHECK(flags, PW_STREAM_FLAG_RT_THREAD) && impl->data_loop_impl == NULL) {
+		int res;
+
+		if ((impl->data_loop_impl = pw_data_loop_new(NULL)) == NULL)
+			return -ENOMEM;
+
+		if ((res = pw_data_loop_start(impl->data_loop_impl)) < 0) {
+			pw_data_loop_destroy(impl->data_loop_impl);
+			impl->data_loop_impl = NULL;
+			return res;
+		}
+		impl->data_loop = pw_data_loop_get_loop(impl->data_loop_impl);
+		pw_core_events_data_loop_added(stream->remote->core, impl->data_loop);
+	}
+
 	set_init_params(stream, n_params, params);
 
 	stream_set_state(stream, PW_STREAM_STATE_CONNECTING, NULL);
@@ -1319,10 +1404,8 @@ pw_stream_finish_format(struct pw_stream *stream,
 	if (SPA_RESULT_IS_OK(res)) {
 		add_port_update(stream, PW_CLIENT_NODE_PORT_UPDATE_PARAMS);
 
-		if (!impl->format) {
+		if (!impl->format)
 			clear_buffers(stream);
-			clear_mems(stream);
-		}
 	}
 	add_async_complete(stream, impl->pending_seq, res);
 
@@ -215,6 +215,9 @@ enum pw_stream_flags {
 	PW_STREAM_FLAG_NO_CONVERT	= (1 << 5),	/**< don't convert format */
 	PW_STREAM_FLAG_EXCLUSIVE	= (1 << 6),	/**< require exclusive access to the
 							  *  device */
+	PW_STREAM_FLAG_RT_THREAD	= (1 << 7),	/**< use a realtime thread of the stream
+							  *  for the data and call process
+							  *  from it */
 };
 
 /** Create a new unconneced \ref pw_stream \memberof pw_stream
@@ -25,20 +25,17 @@
 #include <spa/param/format.h>
 #include <spa/param/props.h>
 #include <spa/monitor/monitor.h>
+#include <spa/param/format-utils.h>
+#include <spa/param/audio/format-utils.h>
+#include <spa/param/video/format-utils.h>
 
 #include "pipewire/pipewire.h"
 #include "pipewire/type.h"
 #include "pipewire/module.h"
 
 
-/** Initializes the type system
- * \param type a type structure
- * \memberof pw_type
- */
-int pw_type_init(struct pw_type *type)
+static void type_register(struct pw_type *type)
 {
-	type->map = pw_get_support_interface(SPA_TYPE__TypeMap);
-
 	type->core = spa_type_map_get_id(type->map, PW_TYPE_INTERFACE__Core);
 	type->registry = spa_type_map_get_id(type->map, PW_TYPE_INTERFACE__Registry);
 	type->node = spa_type_map_get_id(type->map, PW_TYPE_INTERFACE__Node);
@@ -65,5 +62,98 @@ int pw_type_init(struct pw_type *type)
 	spa_type_param_buffers_map(type->map, &type->param_buffers);
 	spa_type_param_meta_map(type->map, &type->param_meta);
 	spa_type_param_io_map(type->map, &type->param_io);
+}
+
+static uint32_t n_static_types;
+
+/** Register the static types
+ * \param map the type map
+ * \return the number of static types
+ *
+ * This is called on the type map before anything else is registered in
+ * it so that the well-known types get the same ids in all processes.
+ * Messages that only use these types don't need to be remapped.
+ *
+ * The order of the types is part of the protocol, the table ends with
+ * \ref PW_TYPE__StaticTypes that contains the version.
+ *
+ * \memberof pw_type
+ */
+uint32_t pw_type_init_static(struct spa_type_map *map)
+{
+	static const char * const props[] = {
+		SPA_TYPE_PROPS__device,
+		SPA_TYPE_PROPS__deviceName,
+		SPA_TYPE_PROPS__deviceFd,
+		SPA_TYPE_PROPS__card,
+		SPA_TYPE_PROPS__cardName,
+		SPA_TYPE_PROPS__minLatency,
+		SPA_TYPE_PROPS__maxLatency,
+		SPA_TYPE_PROPS__periods,
+		SPA_TYPE_PROPS__periodSize,
+		SPA_TYPE_PROPS__periodEvent,
+		SPA_TYPE_PROPS__live,
+		SPA_TYPE_PROPS__waveType,
+		SPA_TYPE_PROPS__frequency,
+		SPA_TYPE_PROPS__volume,
+		SPA_TYPE_PROPS__mute,
+		SPA_TYPE_PROPS__channelVolumes,
+		SPA_TYPE_PROPS__patternType,
+		SPA_TYPE_PROPS__brightness,
+		SPA_TYPE_PROPS__contrast,
+		SPA_TYPE_PROPS__saturation,
+		SPA_TYPE_PROPS__hue,
+		SPA_TYPE_PROPS__gamma,
+		SPA_TYPE_PROPS__exposure,
+		SPA_TYPE_PROPS__gain,
+		SPA_TYPE_PROPS__sharpness,
+		/* version 2 */
+		SPA_TYPE_PROPS__quantum,
+	};
+	struct pw_type type = { map, };
+	struct spa_type_media_type media_type = { 0, };
+	struct spa_type_media_subtype media_subtype = { 0, };
+	struct spa_type_media_subtype_audio media_subtype_audio = { 0, };
+	struct spa_type_media_subtype_video media_subtype_video = { 0, };
+	struct spa_type_format_audio format_audio = { 0, };
+	struct spa_type_format_video format_video = { 0, };
+	struct spa_type_audio_format audio_format = { 0, };
+	struct spa_type_video_format video_format = { 0, };
+	uint32_t i;
+
+	if (n_static_types > 0)
+		return n_static_types;
+
+	type_register(&type);
+
+	spa_type_media_type_map(map, &media_type);
+	spa_type_media_subtype_map(map, &media_subtype);
+	spa_type_media_subtype_audio_map(map, &media_subtype_audio);
+	spa_type_media_subtype_video_map(map, &media_subtype_video);
+	spa_type_format_audio_map(map, &format_audio);
+	spa_type_format_video_map(map, &format_video);
+	spa_type_audio_format_map(map, &audio_format);
+	spa_type_video_format_map(map, &video_format);
+
+	for (i = 0; i < SPA_N_ELEMENTS(props); i++)
+		spa_type_map_get_id(map, props[i]);
+
+	/* the last static type has the version, a peer with another table
+	 * has another string at this id */
+	spa_type_map_get_id(map, PW_TYPE__StaticTypes);
+
+	n_static_types = spa_type_map_get_size(map);
+
+	return n_static_types;
+}
+
+/** Initializes the type system
+ * \param type a type structure
+ * \memberof pw_type
+ */
+int pw_type_init(struct pw_type *type)
+{
+	type->map = pw_get_support_interface(SPA_TYPE__TypeMap);
+	type_register(type);
 	return 0;
 }
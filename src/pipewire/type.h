@@ -81,6 +81,14 @@ struct pw_type {
 
 int pw_type_init(struct pw_type *type);
 
+/** Version of the table of static types, increment when the table changes
+ * and only append new types */
+#define PW_TYPE_STATIC_VERSION	2
+#define PW_TYPE__StaticTypes	PW_TYPE_BASE "StaticTypes:" SPA_STRINGIFY(PW_TYPE_STATIC_VERSION)
+
+/** Register the static types in \a map, returns the number of static types */
+uint32_t pw_type_init_static(struct spa_type_map *map);
+
 #ifdef __cplusplus
 }
 #endif